@@ -85,12 +85,18 @@ static inline void cpymo_backend_audio_prepare_buffer(ndspWaveBuf *buf, size_t c
 
 static LightEvent audio_event;
 static LightLock audio_lock;
+static LightLock decoder_lock;
 static void cpymo_backend_audio_thread(void *_) 
 {
     static unsigned double_buffering[CPYMO_AUDIO_MAX_CHANNELS] = {0};
 
     while(audio_enabled) {
         LightEvent_Wait(&audio_event);
+
+        // decode before taking audio_lock, 
+        // engine takes decoder_lock first and then audio_lock.
+        cpymo_audio_decode(&engine.audio);
+
         LightLock_Lock(&audio_lock);
         for(size_t cid = 0; cid < CPYMO_AUDIO_MAX_CHANNELS; ++cid) {
             cpymo_backend_update_volume(cid);
@@ -161,6 +167,7 @@ void cpymo_backend_audio_init()
     ndspSetCallback(&cpymo_backend_audio_callback, NULL);
 
     LightLock_Init(&audio_lock);
+    LightLock_Init(&decoder_lock);
     LightLock_Lock(&audio_lock);
     LightEvent_Init(&audio_event, RESET_ONESHOT);
 
@@ -190,3 +197,18 @@ void cpymo_backend_audio_unlock()
     LightLock_Unlock(&audio_lock);
 }
 
+void cpymo_backend_audio_decoder_lock(void)
+{
+    if (audio_enabled) LightLock_Lock(&decoder_lock);
+}
+
+void cpymo_backend_audio_decoder_unlock(void)
+{
+    if (audio_enabled) LightLock_Unlock(&decoder_lock);
+}
+
+void cpymo_backend_audio_decoder_wake(void)
+{
+    LightEvent_Signal(&audio_event);
+}
+
@@ -1,5 +1,6 @@
 ﻿#include "../../cpymo/cpymo_prelude.h"
 #include "../../cpymo/cpymo_utils.h"
+#include "../../cpymo/cpymo_atomic.h"
 #include "../include/cpymo_backend_movie.h"
 #include "utils.h"
 #include <assert.h>
@@ -211,3 +212,53 @@ void cpymo_backend_movie_draw_surface()
 		&tint);
 }
 
+static Thread decoder_thread = NULL;
+static LightEvent decoder_event;
+static volatile bool decoder_running = false;
+static void (*decoder_decode)(void *) = NULL;
+static void *decoder_userdata = NULL;
+
+static void cpymo_backend_movie_decoder_thread(void *_)
+{
+	while (cpymo_atomic_bool_load(&decoder_running)) {
+		decoder_decode(decoder_userdata);
+		LightEvent_WaitTimeout(&decoder_event, 10 * 1000 * 1000);
+	}
+}
+
+// Movies are only played on New 3DS, decoder runs on its extra core,
+// main thread would be starved if it shared the core.
+bool cpymo_backend_movie_decoder_start(void (*decode)(void *), void *userdata)
+{
+	LightEvent_Init(&decoder_event, RESET_ONESHOT);
+	decoder_decode = decode;
+	decoder_userdata = userdata;
+	decoder_running = true;
+
+	decoder_thread = threadCreate(
+		&cpymo_backend_movie_decoder_thread, NULL, 0x10000, 0x18, 2, false);
+
+	if (decoder_thread == NULL) {
+		decoder_running = false;
+		return false;
+	}
+
+	return true;
+}
+
+void cpymo_backend_movie_decoder_stop(void)
+{
+	if (decoder_thread) {
+		cpymo_atomic_bool_store(&decoder_running, false);
+		LightEvent_Signal(&decoder_event);
+		threadJoin(decoder_thread, U64_MAX);
+		threadFree(decoder_thread);
+		decoder_thread = NULL;
+	}
+}
+
+void cpymo_backend_movie_decoder_wake(void)
+{
+	if (decoder_thread) LightEvent_Signal(&decoder_event);
+}
+
@@ -158,3 +158,4 @@ void cpymo_backend_text_draw(cpymo_backend_text t, float x, float y, cpymo_color
         x_scale, y_scale, color);
 }
 
+#include "../include/cpymo_backend_text_run_generic.h"
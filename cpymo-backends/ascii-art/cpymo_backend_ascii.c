@@ -3,8 +3,8 @@
 #include "../../cpymo/cpymo_color.h"
 #include "../../cpymo/cpymo_utils.h"
 #include "../software/cpymo_backend_software.h"
-#include "../../stb/stb_ds.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -17,33 +17,147 @@ const static char ascii_table[] = ASCII_TABLE;
 
 const static size_t ascii_table_length = CPYMO_ARR_COUNT(ascii_table) - 1;
 
-static char *framebuffer_ascii = NULL;
+// Only cells changed since last frame are written,
+// so a still frame costs nothing and typing text costs a few bytes.
+typedef struct {
+    uint32_t color;
+    char ch;
+} cpymo_backend_ascii_cell;
 
-static error_t cpymo_backend_ascii_write_string(const char *str)
-{
-    while (*str) {
-        arrput(framebuffer_ascii, *str);
-        str++;
-    }
+static cpymo_backend_ascii_cell *prev_cells = NULL;
+static size_t prev_w = 0, prev_h = 0;
 
-	return CPYMO_ERR_SUCC;
-}
+static char *out_buf = NULL;
+static size_t out_len = 0;
+
+// worst case of a cell: cursor move, color and character.
+#define ASCII_CELL_MAX_BYTES 48
 
 void cpymo_backend_ascii_clean(void)
 {
-    arrfree(framebuffer_ascii);
+    if (prev_cells) free(prev_cells);
+    if (out_buf) free(out_buf);
+    prev_cells = NULL;
+    out_buf = NULL;
+    prev_w = 0;
+    prev_h = 0;
 }
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
+static inline void cpymo_backend_ascii_write_string(const char *str)
+{
+    size_t len = strlen(str);
+    memcpy(out_buf + out_len, str, len);
+    out_len += len;
+}
+
+static inline void cpymo_backend_ascii_write_uint(unsigned v)
+{
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+
+    while (n) out_buf[out_len++] = digits[--n];
+}
+
+#ifdef ASCII_ART_COLOR_256
+static inline unsigned cpymo_backend_ascii_cube_level(uint8_t v)
+{
+    if (v < 48) return 0;
+    if (v < 115) return 1;
+    return (unsigned)(v - 35) / 40;
+}
+
+static inline unsigned cpymo_backend_ascii_dist2(
+    int r1, int g1, int b1, int r2, int g2, int b2)
+{
+    return (unsigned)(
+        (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2));
+}
+
+// nearest xterm 256 color, from 6x6x6 cube or grayscale ramp.
+static uint32_t cpymo_backend_ascii_quantize(cpymo_color col)
+{
+    static const uint8_t cube_levels[6] = { 0, 95, 135, 175, 215, 255 };
+
+    unsigned cr = cpymo_backend_ascii_cube_level(col.r);
+    unsigned cg = cpymo_backend_ascii_cube_level(col.g);
+    unsigned cb = cpymo_backend_ascii_cube_level(col.b);
+    unsigned cube_dist = cpymo_backend_ascii_dist2(
+        col.r, col.g, col.b,
+        cube_levels[cr], cube_levels[cg], cube_levels[cb]);
+
+    int avg = (col.r + col.g + col.b) / 3;
+    int gray = avg > 238 ? 23 : (avg < 8 ? 0 : (avg - 8) / 10);
+    int gray_v = 8 + gray * 10;
+    unsigned gray_dist = cpymo_backend_ascii_dist2(
+        col.r, col.g, col.b, gray_v, gray_v, gray_v);
+
+    if (gray_dist < cube_dist) return (uint32_t)(232 + gray);
+    return (uint32_t)(16 + 36 * cr + 6 * cg + cb);
+}
+
+static void cpymo_backend_ascii_write_color(uint32_t color)
+{
+    cpymo_backend_ascii_write_string("\033[38;5;");
+    cpymo_backend_ascii_write_uint(color);
+    out_buf[out_len++] = 'm';
+}
+#else
+static void cpymo_backend_ascii_write_color(uint32_t color)
+{
+    cpymo_backend_ascii_write_string("\033[38;2;");
+    cpymo_backend_ascii_write_uint((color >> 16) & 0xFF);
+    out_buf[out_len++] = ';';
+    cpymo_backend_ascii_write_uint((color >> 8) & 0xFF);
+    out_buf[out_len++] = ';';
+    cpymo_backend_ascii_write_uint(color & 0xFF);
+    out_buf[out_len++] = 'm';
+}
+#endif
+
+static error_t cpymo_backend_ascii_resize(size_t w, size_t h)
+{
+    cpymo_backend_ascii_clean();
+
+    prev_cells = (cpymo_backend_ascii_cell *)malloc(
+        sizeof(cpymo_backend_ascii_cell) * w * h);
+    if (prev_cells == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    out_buf = (char *)malloc(w * h * ASCII_CELL_MAX_BYTES + 64);
+    if (out_buf == NULL) {
+        cpymo_backend_ascii_clean();
+        return CPYMO_ERR_OUT_OF_MEM;
+    }
+
+    prev_w = w;
+    prev_h = h;
+    return CPYMO_ERR_SUCC;
+}
+
 void cpymo_backend_ascii_submit_framebuffer(
     const cpymo_backend_software_image *framebuffer)
 {
-    arrsetlen(framebuffer_ascii, 0);
-    
-    char buf[32];
+    bool full_redraw = false;
+    if (prev_cells == NULL || prev_w != framebuffer->w || prev_h != framebuffer->h) {
+        if (cpymo_backend_ascii_resize(framebuffer->w, framebuffer->h) != CPYMO_ERR_SUCC)
+            return;
+        full_redraw = true;
+    }
+
+    out_len = 0;
+    if (full_redraw) cpymo_backend_ascii_write_string("\033[0m\033[2J");
+
+    // cursor position after last write, SIZE_MAX if unknown.
+    size_t cursor_x = SIZE_MAX, cursor_y = SIZE_MAX;
+    bool color_valid = false;
+    uint32_t cur_color = 0;
 
     for (size_t y = 0; y < framebuffer->h; ++y) {
         for (size_t x = 0; x < framebuffer->w; ++x) {
@@ -58,35 +172,58 @@ void cpymo_backend_ascii_submit_framebuffer(
                 (float)col.b / 255.0f * 0.0722f;
             brightness = cpymo_utils_clampf(brightness, 0.0f, 1.0f);
 
-            char ascii = 
-                ascii_table[(size_t)(brightness * (ascii_table_length - 1))];
-
-            sprintf(buf, "\033[38;2;%u;%u;%um%c\033[0m", 
-                col.r, col.g, col.b, ascii);
-            cpymo_backend_ascii_write_string(buf);
+            cpymo_backend_ascii_cell cell;
+            cell.ch = ascii_table[(size_t)(brightness * (ascii_table_length - 1))];
+
+            #ifdef ASCII_ART_COLOR_256
+            cell.color = cpymo_backend_ascii_quantize(col);
+            #else
+            cell.color = ((uint32_t)col.r << 16) | ((uint32_t)col.g << 8) | col.b;
+            #endif
+
+            // blank cells look the same in any color.
+            if (cell.ch == ' ') cell.color = 0;
+
+            cpymo_backend_ascii_cell *prev = prev_cells + y * framebuffer->w + x;
+            if (!full_redraw && prev->ch == cell.ch && prev->color == cell.color)
+                continue;
+            *prev = cell;
+
+            if (cursor_x != x || cursor_y != y) {
+                cpymo_backend_ascii_write_string("\033[");
+                cpymo_backend_ascii_write_uint((unsigned)y + 1);
+                out_buf[out_len++] = ';';
+                cpymo_backend_ascii_write_uint((unsigned)x + 1);
+                out_buf[out_len++] = 'H';
+            }
+
+            if (cell.ch != ' ' && (!color_valid || cur_color != cell.color)) {
+                cpymo_backend_ascii_write_color(cell.color);
+                cur_color = cell.color;
+                color_valid = true;
+            }
+
+            out_buf[out_len++] = cell.ch;
+
+            // cursor stays at last column with a pending wrap.
+            cursor_x = x + 1 < framebuffer->w ? x + 1 : SIZE_MAX;
+            cursor_y = y;
         }
-
-        if (y != framebuffer->h - 1)
-            cpymo_backend_ascii_write_string("\n");
     }
 
-    sprintf(buf, "\033[%dA\033[%dD", 
-        (int)framebuffer->w,
-        (int)framebuffer->h);
-    cpymo_backend_ascii_write_string(buf);
-
-    arrput(framebuffer_ascii, '\0');
+    if (out_len == 0) return;
+    if (color_valid) cpymo_backend_ascii_write_string("\033[0m");
 
     #ifdef _WIN32
     WriteConsoleA(
-        GetStdHandle(STD_OUTPUT_HANDLE), 
-        framebuffer_ascii, 
-        arrlenu(framebuffer_ascii) - 1, 
-        NULL, 
+        GetStdHandle(STD_OUTPUT_HANDLE),
+        out_buf,
+        (DWORD)out_len,
+        NULL,
         NULL);
 
     #else
-    printf("%s", framebuffer_ascii);
+    fwrite(out_buf, 1, out_len, stdout);
+    fflush(stdout);
     #endif
 }
-
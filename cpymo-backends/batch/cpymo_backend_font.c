@@ -0,0 +1 @@
+#include "../sdl2/cpymo_backend_font.c"
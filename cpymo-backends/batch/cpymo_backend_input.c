@@ -0,0 +1,17 @@
+﻿#include "../../cpymo/cpymo_prelude.h"
+#include "../../cpymo/cpymo_atomic.h"
+#include "../include/cpymo_backend_input.h"
+#include "cpymo_batch.h"
+
+// Each worker thread drives its own engine.
+static CPYMO_THREAD_LOCAL cpymo_input cpymo_batch_input;
+
+void cpymo_batch_input_set(cpymo_input input)
+{
+    cpymo_batch_input = input;
+}
+
+cpymo_input cpymo_input_snapshot()
+{
+    return cpymo_batch_input;
+}
@@ -0,0 +1,41 @@
+﻿#include "../../cpymo/cpymo_prelude.h"
+#include "../../cpymo/cpymo_atomic.h"
+#include "../include/cpymo_backend_save.h"
+#include "cpymo_batch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Playthroughs start without save data and leave none behind,
+// so they do not depend on each other or on earlier runs.
+// Only trace.json and profiler.csv are written to save directory,
+// named after the run on current thread, such as profiler.3.csv,
+// as runs of the same game may write them at the same time.
+
+static CPYMO_THREAD_LOCAL size_t cpymo_batch_save_index;
+
+void cpymo_batch_save_set_index(size_t index)
+{
+    cpymo_batch_save_index = index;
+}
+
+FILE *cpymo_backend_read_save(const char *gamedir, const char *name)
+{
+    return NULL;
+}
+
+FILE *cpymo_backend_write_save(const char *gamedir, const char *name)
+{
+    if (strcmp(name, "trace.json") && strcmp(name, "profiler.csv"))
+        return tmpfile();
+
+    char *path = (char *)malloc(strlen(gamedir) + strlen(name) + 32);
+    if (path == NULL) return NULL;
+
+    const char *ext = strrchr(name, '.');
+    sprintf(path, "%s/save/%.*s.%u%s",
+        gamedir, (int)(ext - name), name, (unsigned)cpymo_batch_save_index, ext);
+    FILE *file = fopen(path, "wb");
+    free(path);
+    return file;
+}
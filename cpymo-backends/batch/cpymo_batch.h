@@ -0,0 +1,89 @@
+#ifndef INCLUDE_CPYMO_BATCH
+#define INCLUDE_CPYMO_BATCH
+
+#include "../../cpymo/cpymo_engine.h"
+#include "../../cpymo/cpymo_memory.h"
+#include "../software/cpymo_backend_software.h"
+#include <stdio.h>
+
+// One headless playthrough per worker thread.
+// Every playthrough runs with a fixed timestep, holds skip and presses OK
+// every other frame, and picks selections from its choice path,
+// unless it replays a recording.
+
+typedef struct {
+    size_t max_frames;
+    float delta_time;
+    float scale;
+    bool draw;
+
+    // Hash framebuffer after every frame.
+    bool hash;
+
+    // #rand seed of every playthrough not replaying a recording.
+    uint32_t seed;
+
+    // Directories for <index>.cpymorep recordings
+    // and <index>.csv frame times and hashes, NULL to skip.
+    const char *record_dir;
+    const char *frames_csv_dir;
+
+    // Used by games without system/default.ttf, may be NULL.
+    const stbtt_fontinfo *fallback_font;
+} cpymo_batch_options;
+
+enum cpymo_batch_result {
+    cpymo_batch_result_not_run,
+    cpymo_batch_result_finished,
+    cpymo_batch_result_frame_limit,
+    cpymo_batch_result_error,
+};
+
+typedef struct {
+    size_t index;
+    char *gamedir;
+
+    // Recording to replay instead of choices, may be NULL.
+    char *replay;
+
+    // stb_ds arrays, the nth selection shown takes choices[n],
+    // once choices run out the first one is taken.
+    int *choices;
+    int *choices_taken;
+
+    enum cpymo_batch_result result;
+    error_t error;
+    const char *error_stage;
+
+    size_t frames;
+    double simulated_seconds, wall_seconds;
+    double update_ms_total, update_ms_max;
+    double draw_ms_total, draw_ms_max;
+    size_t draws;
+
+    // Hash of hashes of every frame, equal runs draw equal frames.
+    uint64_t framebuffer_hash;
+
+    cpymo_engine_stats stats;
+    size_t memory_peak[cpymo_memory_category_count];
+} cpymo_batch_run;
+
+void cpymo_batch_run_free(cpymo_batch_run *run);
+void cpymo_batch_run_execute(cpymo_batch_run *run, const cpymo_batch_options *o);
+
+const char *cpymo_batch_result_name(enum cpymo_batch_result r);
+
+error_t cpymo_batch_report_write(
+    const char *path,
+    const cpymo_batch_run *runs, size_t count,
+    const cpymo_batch_options *o, size_t workers, double wall_seconds);
+
+// Input seen by cpymo_input_snapshot() on current thread.
+void cpymo_batch_input_set(cpymo_input input);
+
+// Run index in names of files written to save directory on current thread.
+void cpymo_batch_save_set_index(size_t index);
+
+double cpymo_batch_now(void);
+
+#endif
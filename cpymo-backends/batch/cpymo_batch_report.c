@@ -0,0 +1,116 @@
+﻿#include "../../cpymo/cpymo_prelude.h"
+#include "../../stb/stb_ds.h"
+#include "cpymo_batch.h"
+
+static void cpymo_batch_report_string(FILE *f, const char *s)
+{
+    fputc('\"', f);
+    for (; *s; ++s) {
+        const unsigned char ch = (unsigned char)*s;
+        if (ch == '\"' || ch == '\\') fprintf(f, "\\%c", ch);
+        else if (ch < 0x20) fprintf(f, "\\u%04x", (unsigned)ch);
+        else fputc(ch, f);
+    }
+    fputc('\"', f);
+}
+
+static void cpymo_batch_report_ints(FILE *f, const int *arr)
+{
+    fputc('[', f);
+    for (size_t i = 0; i < arrlenu(arr); ++i)
+        fprintf(f, i ? ",%d" : "%d", arr[i]);
+    fputc(']', f);
+}
+
+static void cpymo_batch_report_run(
+    FILE *f, const cpymo_batch_run *r, const cpymo_batch_options *o)
+{
+    fputs("    {\"gamedir\":", f);
+    cpymo_batch_report_string(f, r->gamedir);
+
+    if (r->replay) {
+        fputs(",\"replay\":", f);
+        cpymo_batch_report_string(f, r->replay);
+    }
+    else {
+        fputs(",\"choices\":", f);
+        cpymo_batch_report_ints(f, r->choices);
+    }
+
+    fprintf(f, ",\"result\":\"%s\"", cpymo_batch_result_name(r->result));
+    if (r->result == cpymo_batch_result_error)
+        fprintf(f, ",\"error\":\"%s: %s\"",
+            r->error_stage, cpymo_error_message(r->error));
+
+    fprintf(f,
+        ",\n     \"frames\":%lu,\"simulated_seconds\":%.3f,\"wall_seconds\":%.3f,"
+        "\"update_ms_avg\":%.4f,\"update_ms_max\":%.4f,"
+        "\"draws\":%lu,\"draw_ms_avg\":%.4f,\"draw_ms_max\":%.4f",
+        (unsigned long)r->frames, r->simulated_seconds, r->wall_seconds,
+        r->frames ? r->update_ms_total / r->frames : 0.0, r->update_ms_max,
+        (unsigned long)r->draws,
+        r->draws ? r->draw_ms_total / r->draws : 0.0, r->draw_ms_max);
+
+    if (o->hash || o->frames_csv_dir)
+        fprintf(f, ",\"framebuffer_hash\":\"%016llx\"",
+            (unsigned long long)r->framebuffer_hash);
+
+    fprintf(f,
+        ",\n     \"commands\":%lu,\"script_errors\":%lu,"
+        "\"missing_assets\":%lu,\"missing_labels\":%lu",
+        (unsigned long)r->stats.commands,
+        (unsigned long)r->stats.script_errors,
+        (unsigned long)r->stats.missing_assets,
+        (unsigned long)r->stats.missing_labels);
+
+    fputs(",\n     \"choices_taken\":", f);
+    cpymo_batch_report_ints(f, r->choices_taken);
+
+    // Categories peak at different times, their sum is an upper bound.
+    size_t peak_sum = 0;
+    fputs(",\n     \"memory_peak\":{", f);
+    for (size_t i = 0; i < cpymo_memory_category_count; ++i) {
+        fprintf(f, "%s\"%s\":%lu", i ? "," : "",
+            cpymo_memory_category_name((enum cpymo_memory_category)i),
+            (unsigned long)r->memory_peak[i]);
+        peak_sum += r->memory_peak[i];
+    }
+    fprintf(f, "},\"memory_peak_sum\":%lu}", (unsigned long)peak_sum);
+}
+
+error_t cpymo_batch_report_write(
+    const char *path,
+    const cpymo_batch_run *runs, size_t count,
+    const cpymo_batch_options *o, size_t workers, double wall_seconds)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+
+    size_t results[cpymo_batch_result_error + 1] = { 0 };
+    for (size_t i = 0; i < count; ++i) results[runs[i].result]++;
+
+    fprintf(f,
+        "{\n  \"workers\":%lu,\"wall_seconds\":%.3f,"
+        "\"delta_time\":%f,\"max_frames\":%lu,\"scale\":%f,\"draw\":%s,\"seed\":%lu,\n",
+        (unsigned long)workers, wall_seconds,
+        o->delta_time, (unsigned long)o->max_frames, o->scale,
+        o->draw ? "true" : "false", (unsigned long)o->seed);
+
+    fputs("  \"summary\":{", f);
+    for (size_t i = 0; i < CPYMO_ARR_COUNT(results); ++i)
+        fprintf(f, "%s\"%s\":%lu", i ? "," : "",
+            cpymo_batch_result_name((enum cpymo_batch_result)i),
+            (unsigned long)results[i]);
+    fputs("},\n  \"runs\":[\n", f);
+
+    for (size_t i = 0; i < count; ++i) {
+        cpymo_batch_report_run(f, runs + i, o);
+        fputs(i + 1 < count ? ",\n" : "\n", f);
+    }
+
+    fputs("  ]\n}\n", f);
+
+    bool failed = ferror(f) != 0;
+    failed |= fclose(f) != 0;
+    return failed ? CPYMO_ERR_UNKNOWN : CPYMO_ERR_SUCC;
+}
@@ -0,0 +1,348 @@
+﻿#include "../../cpymo/cpymo_prelude.h"
+#include "../../cpymo/cpymo_utils.h"
+#include "../../stb/stb_ds.h"
+#include "cpymo_batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+double cpymo_batch_now(void)
+{
+    #ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+    #endif
+}
+
+const char *cpymo_batch_result_name(enum cpymo_batch_result r)
+{
+    switch (r) {
+    case cpymo_batch_result_finished: return "finished";
+    case cpymo_batch_result_frame_limit: return "frame_limit";
+    case cpymo_batch_result_error: return "error";
+    default: return "not_run";
+    };
+}
+
+void cpymo_batch_run_free(cpymo_batch_run *run)
+{
+    free(run->gamedir);
+    free(run->replay);
+    arrfree(run->choices);
+    arrfree(run->choices_taken);
+}
+
+static error_t cpymo_batch_load_font(
+    stbtt_fontinfo *font, char **ttf_buffer, const char *gamedir)
+{
+    static const char *names[] = { "default.ttf", "default.otf" };
+
+    char *path = (char *)malloc(strlen(gamedir) + 24);
+    if (path == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    error_t err = CPYMO_ERR_CAN_NOT_OPEN_FILE;
+    for (size_t i = 0; i < CPYMO_ARR_COUNT(names); ++i) {
+        sprintf(path, "%s/system/%s", gamedir, names[i]);
+
+        size_t len;
+        err = cpymo_utils_loadfile(path, ttf_buffer, &len);
+        if (err != CPYMO_ERR_SUCC) continue;
+
+        const unsigned char *data = (const unsigned char *)*ttf_buffer;
+        if (stbtt_InitFont(font, data, stbtt_GetFontOffsetForIndex(data, 0)))
+            break;
+
+        free(*ttf_buffer);
+        *ttf_buffer = NULL;
+        err = CPYMO_ERR_BAD_FILE_FORMAT;
+    }
+
+    free(path);
+    return err;
+}
+
+static void cpymo_batch_run_fail(
+    cpymo_batch_run *run, const char *stage, error_t err)
+{
+    run->result = cpymo_batch_result_error;
+    run->error_stage = stage;
+    run->error = err;
+}
+
+static error_t cpymo_batch_run_choose(cpymo_batch_run *run, cpymo_engine *e, int *target)
+{
+    const size_t n = arrlenu(run->choices_taken);
+    const int nth = n < arrlenu(run->choices) ? run->choices[n] : 0;
+
+    *target = cpymo_select_img_nth_choosable(&e->select_img, nth < 0 ? 0 : (size_t)nth);
+
+    arrput(run->choices_taken, *target);
+    return run->choices_taken == NULL ? CPYMO_ERR_OUT_OF_MEM : CPYMO_ERR_SUCC;
+}
+
+static FILE *cpymo_batch_open_output(const char *dir, size_t index, const char *ext)
+{
+    if (dir == NULL) return NULL;
+
+    char *path = (char *)malloc(strlen(dir) + 32);
+    if (path == NULL) return NULL;
+
+    sprintf(path, "%s/%u.%s", dir, (unsigned)index, ext);
+    FILE *file = fopen(path, "wb");
+    free(path);
+    return file;
+}
+
+static error_t cpymo_batch_run_open_record(
+    cpymo_replay *replay, const cpymo_engine *e,
+    const cpymo_batch_run *run, const cpymo_batch_options *o)
+{
+    char *path = (char *)malloc(strlen(o->record_dir) + 32);
+    if (path == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    sprintf(path, "%s/%u.cpymorep", o->record_dir, (unsigned)run->index);
+    const cpymo_replay_config config = cpymo_engine_replay_config(e);
+    error_t err = cpymo_replay_open_record(replay, path, o->seed, &config);
+    free(path);
+    return err;
+}
+
+static uint64_t cpymo_batch_hash(uint64_t hash, const uint8_t *p, size_t len)
+{
+    // FNV-1a
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static void cpymo_batch_run_loop(
+    cpymo_batch_run *run, cpymo_engine *e,
+    cpymo_backend_software_image *render_target,
+    FILE *frames_csv,
+    const cpymo_batch_options *o)
+{
+    // A selection is identified by how many commands ran before it,
+    // no command runs while it waits for OK.
+    // Cursor is moved with down key, so recordings replay the same choices.
+    size_t chosen_at = (size_t)-1;
+    int target = -1;
+    bool ok = false;
+
+    const bool hash = o->hash || frames_csv;
+    uint64_t frame_hash = 0;
+    run->framebuffer_hash = 0xcbf29ce484222325ULL;
+
+    if (frames_csv) fputs("frame,delta_time,update_ms,draw_ms,hash\n", frames_csv);
+
+    run->result = cpymo_batch_result_frame_limit;
+
+    while (run->frames < o->max_frames) {
+        const bool even = run->frames % 2 == 0;
+        const bool selecting =
+            e->select_img.selections && chosen_at == e->stats.commands;
+
+        cpymo_input input;
+        memset(&input, 0, sizeof(input));
+        input.skip = true;
+        if (selecting && e->select_img.current_selection != target)
+            input.down = even;
+        else ok = even;
+        input.ok = ok;
+        cpymo_batch_input_set(input);
+
+        bool redraw = false;
+        const double update_begin = cpymo_batch_now();
+        error_t err = cpymo_engine_update(e, o->delta_time, &redraw);
+        const double update_ms = (cpymo_batch_now() - update_begin) * 1000.0;
+
+        const float delta_time =
+            e->replay && e->replay->mode == cpymo_replay_play ?
+            e->replay->prev_delta_time : o->delta_time;
+
+        run->frames++;
+        run->simulated_seconds += delta_time;
+        run->update_ms_total += update_ms;
+        if (update_ms > run->update_ms_max) run->update_ms_max = update_ms;
+
+        if (err == CPYMO_ERR_NO_MORE_CONTENT) {
+            run->result = cpymo_batch_result_finished;
+            return;
+        }
+        else if (err != CPYMO_ERR_SUCC) {
+            cpymo_batch_run_fail(run, "cpymo_engine_update", err);
+            return;
+        }
+
+        double draw_ms = 0;
+        if (o->draw && redraw) {
+            const double draw_begin = cpymo_batch_now();
+            memset(
+                render_target->pixels, 0,
+                render_target->line_stride * render_target->h);
+            cpymo_engine_draw(e);
+            draw_ms = (cpymo_batch_now() - draw_begin) * 1000.0;
+
+            run->draws++;
+            run->draw_ms_total += draw_ms;
+            if (draw_ms > run->draw_ms_max) run->draw_ms_max = draw_ms;
+
+            // Framebuffer only changes when it is drawn.
+            if (hash) {
+                frame_hash = cpymo_batch_hash(
+                    0xcbf29ce484222325ULL, render_target->pixels,
+                    render_target->line_stride * render_target->h);
+            }
+        }
+
+        if (hash) {
+            run->framebuffer_hash = cpymo_batch_hash(
+                run->framebuffer_hash, (const uint8_t *)&frame_hash, sizeof(frame_hash));
+        }
+
+        if (frames_csv) {
+            fprintf(frames_csv, "%u,%.6f,%.4f,%.4f,%016llx\n",
+                (unsigned)run->frames - 1, delta_time, update_ms, draw_ms,
+                (unsigned long long)frame_hash);
+        }
+
+        if (e->replay == NULL || e->replay->mode == cpymo_replay_record) {
+            if (e->select_img.selections && chosen_at != e->stats.commands) {
+                chosen_at = e->stats.commands;
+                err = cpymo_batch_run_choose(run, e, &target);
+                if (err != CPYMO_ERR_SUCC) {
+                    cpymo_batch_run_fail(run, "choose", err);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void cpymo_batch_run_execute(cpymo_batch_run *run, const cpymo_batch_options *o)
+{
+    const double begin = cpymo_batch_now();
+    cpymo_batch_save_set_index(run->index);
+
+    // Screen size is needed before engine loads any image.
+    cpymo_gameconfig gameconfig;
+    char *path = (char *)malloc(strlen(run->gamedir) + 16);
+    if (path == NULL) {
+        cpymo_batch_run_fail(run, "gameconfig", CPYMO_ERR_OUT_OF_MEM);
+        return;
+    }
+
+    sprintf(path, "%s/gameconfig.txt", run->gamedir);
+    error_t err = cpymo_gameconfig_parse_from_file(&gameconfig, path);
+    free(path);
+    if (err != CPYMO_ERR_SUCC) {
+        cpymo_batch_run_fail(run, "gameconfig", err);
+        return;
+    }
+
+    stbtt_fontinfo game_font;
+    char *ttf_buffer = NULL;
+    const stbtt_fontinfo *font = o->fallback_font;
+    if (cpymo_batch_load_font(&game_font, &ttf_buffer, run->gamedir) == CPYMO_ERR_SUCC)
+        font = &game_font;
+
+    if (font == NULL) {
+        cpymo_batch_run_fail(run, "font", CPYMO_ERR_CAN_NOT_OPEN_FILE);
+        return;
+    }
+
+    cpymo_backend_software_image render_target;
+    render_target.w = (size_t)(gameconfig.imagesize_w * o->scale);
+    render_target.h = (size_t)(gameconfig.imagesize_h * o->scale);
+    render_target.line_stride = render_target.w * 3;
+    render_target.pixel_stride = 3;
+    render_target.r_offset = 0;
+    render_target.g_offset = 1;
+    render_target.b_offset = 2;
+    render_target.has_alpha_channel = false;
+    render_target.pixels =
+        (uint8_t *)malloc(render_target.line_stride * render_target.h);
+
+    if (render_target.pixels == NULL) {
+        free(ttf_buffer);
+        cpymo_batch_run_fail(run, "render_target", CPYMO_ERR_OUT_OF_MEM);
+        return;
+    }
+
+    cpymo_backend_software_context context;
+    context.logical_screen_w = (float)gameconfig.imagesize_w;
+    context.logical_screen_h = (float)gameconfig.imagesize_h;
+    context.scale_on_load_image = o->scale != 1.0f;
+    context.scale_on_load_image_w_ratio = o->scale;
+    context.scale_on_load_image_h_ratio = o->scale;
+    context.render_target = &render_target;
+    context.font = (stbtt_fontinfo *)font;
+    cpymo_backend_software_set_context(&context);
+
+    cpymo_replay replay;
+    replay.file = NULL;
+    if (run->replay) {
+        err = cpymo_replay_open_play(&replay, run->replay);
+        if (err != CPYMO_ERR_SUCC) cpymo_batch_run_fail(run, "replay", err);
+    }
+
+    FILE *frames_csv = cpymo_batch_open_output(o->frames_csv_dir, run->index, "csv");
+
+    cpymo_engine *engine = NULL;
+    if (err == CPYMO_ERR_SUCC) {
+        engine = (cpymo_engine *)malloc(sizeof(cpymo_engine));
+        if (engine == NULL) err = CPYMO_ERR_OUT_OF_MEM;
+        else err = cpymo_engine_init(engine, run->gamedir);
+
+        if (err != CPYMO_ERR_SUCC) {
+            cpymo_batch_run_fail(run, "cpymo_engine_init", err);
+        }
+        else {
+            engine->memory.track_peaks = true;
+
+            // Replays bring their own seed and config.
+            // Scripted runs do not skip by read state, since that depends
+            // on save data, and their recordings keep the seed,
+            // so they draw the same #rand numbers as runs without recording.
+            if (replay.file) cpymo_engine_attach_replay(engine, &replay);
+            else {
+                engine->config_skip_already_read_only = false;
+                cpymo_engine_seed(engine, o->seed);
+                if (o->record_dir) {
+                    err = cpymo_batch_run_open_record(&replay, engine, run, o);
+                    if (err == CPYMO_ERR_SUCC) cpymo_engine_attach_replay(engine, &replay);
+                    else cpymo_batch_run_fail(run, "record", err);
+                }
+            }
+
+            if (err == CPYMO_ERR_SUCC)
+                cpymo_batch_run_loop(run, engine, &render_target, frames_csv, o);
+
+            run->stats = engine->stats;
+            memcpy(run->memory_peak, engine->memory.peak, sizeof(run->memory_peak));
+            cpymo_engine_free(engine);
+        }
+    }
+
+    free(engine);
+    if (frames_csv) fclose(frames_csv);
+    cpymo_replay_close(&replay);
+    cpymo_backend_software_set_context(NULL);
+    free(render_target.pixels);
+    free(ttf_buffer);
+
+    run->wall_seconds = cpymo_batch_now() - begin;
+}
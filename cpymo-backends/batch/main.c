@@ -0,0 +1,337 @@
+﻿#define STBI_NO_PSD
+#define STBI_NO_TGA
+#define STBI_NO_HDR
+#define STBI_NO_PIC
+#define STBI_NO_PNM
+
+#include "../../cpymo/cpymo_prelude.h"
+#include "../../cpymo/cpymo_atomic.h"
+#include "../../cpymo/cpymo_utils.h"
+#include "cpymo_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../../stb/stb_image.h"
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "../../stb/stb_image_resize.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../../stb/stb_image_write.h"
+
+#define STB_DS_IMPLEMENTATION
+#include "../../stb/stb_ds.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+static cpymo_batch_run *runs = NULL;
+static cpymo_batch_options options;
+static volatile long next_run = 0;
+
+static void help(void)
+{
+    printf("cpymo-batch\n");
+    printf("Runs headless playthroughs of PyMO games, one engine per worker thread.\n");
+    printf("\n");
+    printf("    cpymo-batch [options] <gamedir[@choices|@replay]...>\n");
+    printf("\n");
+    printf("choices is a comma separated list such as 0,1,0,\n");
+    printf("the nth selection shown takes the nth choice, or the first option when they run out.\n");
+    printf("replay is a .cpymorep file recorded by --record or cpymo, it replaces scripted input.\n");
+    printf("\n");
+    printf("    -j <workers>        Worker threads, number of CPUs by default.\n");
+    printf("    -f <file>           Read more playthroughs from file, one per line.\n");
+    printf("    -o <file>           JSON report, cpymo-batch.json by default.\n");
+    printf("    --frames <count>    Frames before a playthrough is stopped, 100000 by default.\n");
+    printf("    --dt <seconds>      Fixed timestep, 0.016667 by default.\n");
+    printf("    --scale <ratio>     Render target size relative to game screen, 1 by default.\n");
+    printf("    --no-draw           Only update engines, never draw.\n");
+    printf("    --font <file>       Font for games without system/default.ttf.\n");
+    printf("    --seed <number>     Seed of #rand in every playthrough, 1 by default.\n");
+    printf("    --record <dir>      Record input of every playthrough to <dir>/<index>.cpymorep.\n");
+    printf("    --hash              Hash framebuffer of every frame into report.\n");
+    printf("    --frames-csv <dir>  Write frame times and hashes to <dir>/<index>.csv.\n");
+    printf("\n");
+}
+
+static size_t cpu_count(void)
+{
+    #ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+    #else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+    #endif
+}
+
+static cpymo_str pop_until(cpymo_str *tail, char separator)
+{
+    cpymo_str head = { tail->begin, 0 };
+    while (head.len < tail->len && tail->begin[head.len] != separator)
+        head.len++;
+
+    const size_t skip = head.len < tail->len ? head.len + 1 : head.len;
+    tail->begin += skip;
+    tail->len -= skip;
+    return head;
+}
+
+static bool is_choices(cpymo_str s)
+{
+    for (size_t i = 0; i < s.len; ++i)
+        if (!strchr("0123456789-, \t", s.begin[i])) return false;
+    return true;
+}
+
+static error_t add_run(cpymo_str spec)
+{
+    cpymo_str_trim(&spec);
+    if (spec.len == 0 || spec.begin[0] == '#') return CPYMO_ERR_SUCC;
+
+    cpymo_batch_run run;
+    memset(&run, 0, sizeof(run));
+    run.index = (size_t)arrlen(runs);
+
+    size_t gamedir_len = spec.len;
+    for (size_t i = spec.len; i > 0; --i) {
+        if (spec.begin[i - 1] == '@') {
+            gamedir_len = i - 1;
+            break;
+        }
+    }
+
+    run.gamedir = (char *)malloc(gamedir_len + 1);
+    if (run.gamedir == NULL) return CPYMO_ERR_OUT_OF_MEM;
+    memcpy(run.gamedir, spec.begin, gamedir_len);
+    run.gamedir[gamedir_len] = '\0';
+
+    cpymo_str choices = { spec.begin + gamedir_len, 0 };
+    if (gamedir_len < spec.len) {
+        choices.begin++;
+        choices.len = spec.len - gamedir_len - 1;
+    }
+
+    if (!is_choices(choices)) {
+        run.replay = cpymo_str_copy_malloc(choices);
+        if (run.replay == NULL) {
+            cpymo_batch_run_free(&run);
+            return CPYMO_ERR_OUT_OF_MEM;
+        }
+    }
+    else {
+        while (choices.len) {
+            arrput(run.choices, cpymo_str_atoi(pop_until(&choices, ',')));
+            if (run.choices == NULL) {
+                cpymo_batch_run_free(&run);
+                return CPYMO_ERR_OUT_OF_MEM;
+            }
+        }
+    }
+
+    arrput(runs, run);
+    if (runs == NULL) {
+        cpymo_batch_run_free(&run);
+        return CPYMO_ERR_OUT_OF_MEM;
+    }
+
+    return CPYMO_ERR_SUCC;
+}
+
+static error_t add_runs_from_file(const char *path)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    error_t err = cpymo_utils_loadfile(path, &buf, &len);
+    CPYMO_THROW(err);
+
+    cpymo_str lines = { buf, len };
+    while (lines.len) {
+        err = add_run(pop_until(&lines, '\n'));
+        if (err != CPYMO_ERR_SUCC) break;
+    }
+
+    free(buf);
+    return err;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker(LPVOID unused)
+#else
+static void *worker(void *unused)
+#endif
+{
+    while (1) {
+        const long i = cpymo_atomic_long_increment(&next_run) - 1;
+        if (i >= (long)arrlen(runs)) break;
+
+        cpymo_batch_run_execute(runs + i, &options);
+
+        fprintf(stderr, "[%ld/%ld] %s: %s\n",
+            i + 1, (long)arrlen(runs), runs[i].gamedir,
+            cpymo_batch_result_name(runs[i].result));
+    }
+
+    // Frees glyph cache of this thread.
+    cpymo_backend_software_set_context(NULL);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    options.max_frames = 100000;
+    options.delta_time = 1.0f / 60.0f;
+    options.scale = 1.0f;
+    options.draw = true;
+    options.hash = false;
+    options.seed = 1;
+    options.record_dir = NULL;
+    options.frames_csv_dir = NULL;
+    options.fallback_font = NULL;
+
+    size_t workers = cpu_count();
+    const char *report = "cpymo-batch.json";
+    const char *font_path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        error_t err = CPYMO_ERR_SUCC;
+
+        if (!strcmp(argv[i], "-j") && has_value) {
+            workers = (size_t)atoi(argv[++i]);
+            if (workers == 0) workers = 1;
+        }
+        else if (!strcmp(argv[i], "-f") && has_value)
+            err = add_runs_from_file(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && has_value)
+            report = argv[++i];
+        else if (!strcmp(argv[i], "--frames") && has_value)
+            options.max_frames = (size_t)atol(argv[++i]);
+        else if (!strcmp(argv[i], "--dt") && has_value)
+            options.delta_time = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--scale") && has_value)
+            options.scale = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--no-draw"))
+            options.draw = false;
+        else if (!strcmp(argv[i], "--font") && has_value)
+            font_path = argv[++i];
+        else if (!strcmp(argv[i], "--seed") && has_value)
+            options.seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--record") && has_value)
+            options.record_dir = argv[++i];
+        else if (!strcmp(argv[i], "--hash"))
+            options.hash = true;
+        else if (!strcmp(argv[i], "--frames-csv") && has_value)
+            options.frames_csv_dir = argv[++i];
+        else if (argv[i][0] == '-') {
+            printf("[Error] Unknown arg \'%s\'.\n", argv[i]);
+            return -1;
+        }
+        else err = add_run(cpymo_str_pure(argv[i]));
+
+        if (err != CPYMO_ERR_SUCC) {
+            printf("[Error] %s: %s.\n", argv[i], cpymo_error_message(err));
+            return -1;
+        }
+    }
+
+    if (arrlen(runs) == 0 || options.delta_time <= 0 || options.scale <= 0) {
+        help();
+        return 0;
+    }
+
+    extern error_t cpymo_backend_font_init(const char *gamedir);
+    extern void cpymo_backend_font_free();
+    extern stbtt_fontinfo font;
+
+    char *ttf_buffer = NULL;
+    stbtt_fontinfo fallback_font;
+    if (font_path) {
+        size_t len;
+        error_t err = cpymo_utils_loadfile(font_path, &ttf_buffer, &len);
+        const unsigned char *data = (const unsigned char *)ttf_buffer;
+        if (err != CPYMO_ERR_SUCC
+            || !stbtt_InitFont(&fallback_font, data, stbtt_GetFontOffsetForIndex(data, 0))) {
+            printf("[Error] Can not load font %s.\n", font_path);
+            free(ttf_buffer);
+            return -1;
+        }
+
+        options.fallback_font = &fallback_font;
+    }
+    else if (cpymo_backend_font_init(NULL) == CPYMO_ERR_SUCC) {
+        options.fallback_font = &font;
+    }
+
+    if (workers > (size_t)arrlen(runs)) workers = (size_t)arrlen(runs);
+
+    const double begin = cpymo_batch_now();
+
+    #ifdef _WIN32
+    HANDLE *threads = (HANDLE *)malloc(sizeof(HANDLE) * workers);
+    #else
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+    #endif
+
+    size_t started = 0;
+    if (threads) {
+        for (; started < workers; ++started) {
+            #ifdef _WIN32
+            threads[started] = CreateThread(NULL, 0, &worker, NULL, 0, NULL);
+            if (threads[started] == NULL) break;
+            #else
+            if (pthread_create(threads + started, NULL, &worker, NULL)) break;
+            #endif
+        }
+    }
+
+    // Without any thread, runs go on main thread.
+    if (started == 0) worker(NULL);
+
+    for (size_t i = 0; i < started; ++i) {
+        #ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+        #else
+        pthread_join(threads[i], NULL);
+        #endif
+    }
+
+    free(threads);
+
+    const double wall_seconds = cpymo_batch_now() - begin;
+
+    int ret = 0;
+    error_t err = cpymo_batch_report_write(
+        report, runs, (size_t)arrlen(runs), &options,
+        started ? started : 1, wall_seconds);
+    if (err != CPYMO_ERR_SUCC) {
+        printf("[Error] Can not write %s: %s.\n", report, cpymo_error_message(err));
+        ret = -1;
+    }
+    else {
+        fprintf(stderr, "%ld playthroughs in %.2f seconds => %s\n",
+            (long)arrlen(runs), wall_seconds, report);
+    }
+
+    for (size_t i = 0; i < (size_t)arrlen(runs); ++i) {
+        if (runs[i].result != cpymo_batch_result_finished
+            && runs[i].result != cpymo_batch_result_frame_limit)
+            ret = -1;
+        cpymo_batch_run_free(runs + i);
+    }
+
+    arrfree(runs);
+    free(ttf_buffer);
+    cpymo_backend_font_free();
+
+    return ret;
+}
@@ -23,4 +23,12 @@ const cpymo_backend_audio_info *cpymo_backend_audio_get_info(void);
 void cpymo_backend_audio_lock(void);
 void cpymo_backend_audio_unlock(void);
 
+// Held while a channel's decoder is running or being replaced,
+// so the audio callback never waits for FFmpeg.
+void cpymo_backend_audio_decoder_lock(void);
+void cpymo_backend_audio_decoder_unlock(void);
+
+// Called from the audio callback when a PCM ring runs low.
+void cpymo_backend_audio_decoder_wake(void);
+
 #endif
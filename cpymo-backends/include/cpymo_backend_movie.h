@@ -3,6 +3,7 @@
 
 #include "../../cpymo/cpymo_error.h"
 #include <stddef.h>
+#include <stdbool.h>
 
 enum cpymo_backend_movie_how_to_play {
 	cpymo_backend_movie_how_to_play_unsupported,
@@ -31,5 +32,13 @@ void cpymo_backend_movie_update_yuyv_surface(const void *, size_t pitch);
 
 void cpymo_backend_movie_draw_surface();
 
+// Calls decode(userdata) on a backend thread until cpymo_backend_movie_decoder_stop,
+// waiting between calls for cpymo_backend_movie_decoder_wake or a short timeout.
+// Returns false if the backend has no thread for it, 
+// then the engine decodes on main thread.
+bool cpymo_backend_movie_decoder_start(void (*decode)(void *userdata), void *userdata);
+void cpymo_backend_movie_decoder_stop(void);
+void cpymo_backend_movie_decoder_wake(void);
+
 
 #endif
@@ -26,6 +26,33 @@ float cpymo_backend_text_width(
     cpymo_str,
     float single_character_size_in_logical_screen);
 
+// Characters positioned by caller and drawn together, such as a textbox page.
+// Only first visible_count characters are drawn.
+typedef void *cpymo_backend_text_run;
+
+error_t cpymo_backend_text_run_create(
+    cpymo_backend_text_run *out,
+    size_t max_characters,
+    float x, float y, float w, float h,
+    float single_character_size_in_logical_screen);
+
+void cpymo_backend_text_run_free(cpymo_backend_text_run);
+
+void cpymo_backend_text_run_clear(cpymo_backend_text_run);
+
+// utf8_character should be a single character.
+error_t cpymo_backend_text_run_append(
+    cpymo_backend_text_run,
+    float *out_width,
+    cpymo_str utf8_character,
+    float x, float y_baseline);
+
+void cpymo_backend_text_run_draw(
+    cpymo_backend_text_run,
+    size_t visible_count,
+    cpymo_color col, float alpha,
+    enum cpymo_backend_image_draw_type draw_type);
+
 #ifdef ENABLE_TEXT_EXTRACT
 void cpymo_backend_text_extract(const char *text);
 #else
@@ -0,0 +1,89 @@
+#ifndef INCLUDE_CPYMO_BACKEND_TEXT_RUN_GENERIC
+#define INCLUDE_CPYMO_BACKEND_TEXT_RUN_GENERIC
+
+// cpymo_backend_text_run built on cpymo_backend_text,
+// for backends which have no shared glyph atlas.
+// Include it in exactly one source file of the backend.
+
+#include "cpymo_backend_text.h"
+#include <stdlib.h>
+
+typedef struct {
+    size_t count, max_count;
+    float char_size;
+    cpymo_backend_text *texts;
+    float *xy;
+} cpymo_backend_text_run_generic;
+
+error_t cpymo_backend_text_run_create(
+    cpymo_backend_text_run *out,
+    size_t max_characters,
+    float x, float y, float w, float h,
+    float single_character_size_in_logical_screen)
+{
+    cpymo_backend_text_run_generic *r =
+        (cpymo_backend_text_run_generic *)malloc(
+            sizeof(cpymo_backend_text_run_generic)
+            + max_characters * (sizeof(cpymo_backend_text) + 2 * sizeof(float)));
+    if (r == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    r->count = 0;
+    r->max_count = max_characters;
+    r->char_size = single_character_size_in_logical_screen;
+    r->texts = (cpymo_backend_text *)(r + 1);
+    r->xy = (float *)(r->texts + max_characters);
+
+    *out = r;
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_text_run_clear(cpymo_backend_text_run run)
+{
+    cpymo_backend_text_run_generic *r = (cpymo_backend_text_run_generic *)run;
+    for (size_t i = 0; i < r->count; ++i)
+        cpymo_backend_text_free(r->texts[i]);
+    r->count = 0;
+}
+
+void cpymo_backend_text_run_free(cpymo_backend_text_run run)
+{
+    cpymo_backend_text_run_clear(run);
+    free(run);
+}
+
+error_t cpymo_backend_text_run_append(
+    cpymo_backend_text_run run,
+    float *out_width,
+    cpymo_str utf8_character,
+    float x, float y_baseline)
+{
+    cpymo_backend_text_run_generic *r = (cpymo_backend_text_run_generic *)run;
+    if (r->count >= r->max_count) return CPYMO_ERR_OUT_OF_MEM;
+
+    error_t err = cpymo_backend_text_create(
+        r->texts + r->count, out_width, utf8_character, r->char_size);
+    CPYMO_THROW(err);
+
+    r->xy[r->count * 2] = x;
+    r->xy[r->count * 2 + 1] = y_baseline;
+    r->count++;
+
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_text_run_draw(
+    cpymo_backend_text_run run,
+    size_t visible_count,
+    cpymo_color col, float alpha,
+    enum cpymo_backend_image_draw_type draw_type)
+{
+    cpymo_backend_text_run_generic *r = (cpymo_backend_text_run_generic *)run;
+    if (visible_count > r->count) visible_count = r->count;
+
+    for (size_t i = 0; i < visible_count; ++i)
+        cpymo_backend_text_draw(
+            r->texts[i], r->xy[i * 2], r->xy[i * 2 + 1],
+            col, alpha, draw_type);
+}
+
+#endif
@@ -29,6 +29,7 @@ static retro_video_refresh_t           video_cb;
 static retro_input_poll_t              input_poll_cb;
 static retro_input_state_t             input_state_cb;
 static retro_audio_sample_batch_t      audio_batch_cb;
+static struct retro_perf_callback      perf_cb;
 static retro_environment_t             environ_cb;
 static cpymo_engine                    engine;
 static cpymo_backend_software_image    soft_image;
@@ -54,6 +55,19 @@ void cpymo_backend_audio_unlock()
 {
 }
 
+// No decoder thread, retro_run decodes right before mixing.
+void cpymo_backend_audio_decoder_lock(void)
+{
+}
+
+void cpymo_backend_audio_decoder_unlock(void)
+{
+}
+
+void cpymo_backend_audio_decoder_wake(void)
+{
+}
+
 const cpymo_backend_audio_info *cpymo_backend_audio_get_info(void)
 {
     static const cpymo_backend_audio_info audio_info = {
@@ -155,6 +169,9 @@ void retro_init(void)
     };
     environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &pixfmt);
     environ_cb(RETRO_ENVIRONMENT_SET_FRAME_TIME_CALLBACK, &frametime);
+
+    if (!environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf_cb))
+        perf_cb.get_time_usec = NULL;
 }
 
 
@@ -288,7 +305,16 @@ void retro_run(void)
         cpymo_engine_draw(&engine);
     video_cb(soft_image.pixels, soft_image.w, soft_image.h, soft_image.line_stride);
 
-    cpymo_audio_copy_mixed_samples(audio_buffer, samples * 4, &engine.audio);
+    retro_time_t begin = perf_cb.get_time_usec ? perf_cb.get_time_usec() : 0;
+    cpymo_audio_decode(&engine.audio);
+    bool complete = cpymo_audio_copy_mixed_samples(audio_buffer, samples * 4, &engine.audio);
+    if (perf_cb.get_time_usec) {
+        cpymo_audio_telemetry_callback(
+            &engine.audio,
+            (double)(perf_cb.get_time_usec() - begin) / 1000000.0,
+            (double)samples / 44100.0,
+            complete);
+    }
     audio_batch_cb(audio_buffer, samples);
 }
 
@@ -1,5 +1,6 @@
 ﻿#include "../../cpymo/cpymo_prelude.h"
 #include "../../cpymo/cpymo_engine.h"
+#include "../../cpymo/cpymo_atomic.h"
 #ifndef DISABLE_FFMPEG_AUDIO
 
 #include <SDL/SDL.h>
@@ -28,20 +29,72 @@ const cpymo_backend_audio_info *cpymo_backend_audio_get_info(void)
 
 static void cpymo_backend_audio_callback(void *userdata, Uint8 *stream, int len)
 {
-    memset(stream, 0, (size_t)len);
-	
-	for (size_t cid = 0; cid < CPYMO_AUDIO_MAX_CHANNELS; ++cid) {
-		void *samples = NULL;
-		size_t szlen = (size_t)len;
-		size_t written = 0;
-		float volume = cpymo_audio_get_channel_volume(cid, &engine.audio);
-
-		while (cpymo_audio_channel_get_samples(&samples, &szlen, cid, &engine.audio) && szlen) {
-			SDL_MixAudio(stream + written, (Uint8 *)samples, (Uint32)szlen, (int)(volume * SDL_MIX_MAXVOLUME));
-			written += szlen;
-			szlen = (size_t)len - written;
-		}
-	}
+    cpymo_audio_copy_mixed_samples(stream, (size_t)len, &engine.audio);
+}
+
+static SDL_Thread *decoder_thread = NULL;
+static SDL_mutex *decoder_mutex = NULL;
+static SDL_sem *decoder_sem = NULL;
+static volatile bool decoder_running = false;
+
+static int cpymo_backend_audio_decoder_thread(void *userdata)
+{
+    while (cpymo_atomic_bool_load(&decoder_running)) {
+        cpymo_audio_decode(&engine.audio);
+        SDL_SemWaitTimeout(decoder_sem, 10);
+    }
+
+    return 0;
+}
+
+static void cpymo_backend_audio_decoder_stop(void)
+{
+    if (decoder_thread) {
+        cpymo_atomic_bool_store(&decoder_running, false);
+        SDL_SemPost(decoder_sem);
+        SDL_WaitThread(decoder_thread, NULL);
+        decoder_thread = NULL;
+    }
+
+    if (decoder_sem) SDL_DestroySemaphore(decoder_sem);
+    if (decoder_mutex) SDL_DestroyMutex(decoder_mutex);
+    decoder_sem = NULL;
+    decoder_mutex = NULL;
+}
+
+static bool cpymo_backend_audio_decoder_start(void)
+{
+    decoder_mutex = SDL_CreateMutex();
+    decoder_sem = SDL_CreateSemaphore(0);
+    if (decoder_mutex == NULL || decoder_sem == NULL) {
+        cpymo_backend_audio_decoder_stop();
+        return false;
+    }
+
+    decoder_running = true;
+    decoder_thread = SDL_CreateThread(&cpymo_backend_audio_decoder_thread, NULL);
+    if (decoder_thread == NULL) {
+        cpymo_backend_audio_decoder_stop();
+        return false;
+    }
+
+    return true;
+}
+
+void cpymo_backend_audio_decoder_lock(void)
+{
+    if (decoder_mutex) SDL_LockMutex(decoder_mutex);
+}
+
+void cpymo_backend_audio_decoder_unlock(void)
+{
+    if (decoder_mutex) SDL_UnlockMutex(decoder_mutex);
+}
+
+void cpymo_backend_audio_decoder_wake(void)
+{
+    if (decoder_sem && SDL_SemValue(decoder_sem) == 0)
+        SDL_SemPost(decoder_sem);
 }
 
 static inline bool cpymo_backend_audio_supported(const SDL_AudioSpec *spec)
@@ -81,6 +134,11 @@ void cpymo_backend_audio_init(void)
     return;
 
 SUCCESS:
+    if (!cpymo_backend_audio_decoder_start()) {
+        SDL_CloseAudio();
+        return;
+    }
+
     enabled = true;
     info.channels = got.channels;
     info.freq = got.freq;
@@ -92,6 +150,8 @@ void cpymo_backend_audio_free(void)
 {
     if (enabled)
         SDL_CloseAudio();
+
+    cpymo_backend_audio_decoder_stop();
 }
 
 void cpymo_backend_audio_lock(void)
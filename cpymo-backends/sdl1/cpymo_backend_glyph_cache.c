@@ -0,0 +1,3 @@
+#ifndef ENABLE_SDL_TTF
+#include "../software/cpymo_backend_glyph_cache.c"
+#endif
@@ -1,6 +1,7 @@
 ﻿#include "../../cpymo/cpymo_prelude.h"
 #ifndef DISABLE_MOVIE
 #include "../include/cpymo_backend_movie.h"
+#include "../../cpymo/cpymo_atomic.h"
 #include <SDL/SDL.h>
 #include <stdbool.h>
 #include <libswscale/swscale.h>
@@ -144,4 +145,56 @@ void cpymo_backend_movie_draw_surface()
     SDL_DisplayYUVOverlay(overlay, &video_rect);
 }
 
+static SDL_Thread *decoder_thread = NULL;
+static SDL_sem *decoder_sem = NULL;
+static volatile bool decoder_running = false;
+static void (*decoder_decode)(void *) = NULL;
+static void *decoder_userdata = NULL;
+
+static int cpymo_backend_movie_decoder_thread(void *userdata)
+{
+    while (cpymo_atomic_bool_load(&decoder_running)) {
+        decoder_decode(decoder_userdata);
+        SDL_SemWaitTimeout(decoder_sem, 10);
+    }
+
+    return 0;
+}
+
+void cpymo_backend_movie_decoder_stop(void)
+{
+    if (decoder_thread) {
+        cpymo_atomic_bool_store(&decoder_running, false);
+        SDL_SemPost(decoder_sem);
+        SDL_WaitThread(decoder_thread, NULL);
+        decoder_thread = NULL;
+    }
+
+    if (decoder_sem) SDL_DestroySemaphore(decoder_sem);
+    decoder_sem = NULL;
+}
+
+bool cpymo_backend_movie_decoder_start(void (*decode)(void *), void *userdata)
+{
+    decoder_sem = SDL_CreateSemaphore(0);
+    if (decoder_sem == NULL) return false;
+
+    decoder_decode = decode;
+    decoder_userdata = userdata;
+    decoder_running = true;
+    decoder_thread = SDL_CreateThread(&cpymo_backend_movie_decoder_thread, NULL);
+    if (decoder_thread == NULL) {
+        cpymo_backend_movie_decoder_stop();
+        return false;
+    }
+
+    return true;
+}
+
+void cpymo_backend_movie_decoder_wake(void)
+{
+    if (decoder_sem && SDL_SemValue(decoder_sem) == 0)
+        SDL_SemPost(decoder_sem);
+}
+
 #endif
@@ -5,6 +5,7 @@
 #include "../../stb/stb_truetype.h"
 #include "../include/cpymo_backend_text.h"
 #include "../include/cpymo_backend_image.h"
+#include "../software/cpymo_backend_glyph_cache.h"
 #include "../../cpymo/cpymo_utils.h"
 #include "../../cpymo/cpymo_engine.h"
 
@@ -21,6 +22,11 @@ extern void cpymo_backend_font_render(
     void *out_or_null, int *w, int *h, 
     cpymo_str text, float scale, float baseline);
 
+extern int cpymo_backend_font_text_width(cpymo_str text, float scale);
+
+extern void cpymo_backend_font_compose_run(
+    cpymo_backend_glyph_run *run, size_t visible_count);
+
 typedef struct {
     float baseline;
     size_t w, h;
@@ -64,7 +70,7 @@ void cpymo_backend_text_free(cpymo_backend_text t_)
 }
 
 static void cpymo_backend_text_draw_internal(
-    cpymo_backend_text_impl *t, 
+    const uint8_t *px, int w, int h,
     float x_pos, float y_pos, 
     cpymo_color col, float alpha)
 {
@@ -81,14 +87,14 @@ static void cpymo_backend_text_draw_internal(
     int base_x = (int)x_pos + clip.x;
     int base_y = (int)y_pos + clip.y;
 
-    for (int y = 0; y < t->h; ++y) {
-        for (int x = 0; x < t->w; ++x) {
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
             int draw_x = x + base_x;
             int draw_y = y + base_y;
 
             if (draw_x < 0 || draw_x >= clip.x + clip.w || draw_y < 0 || draw_y >= clip.y + clip.h) continue;
 
-            const uint8_t fontsmp = t->px[y * t->w + x];
+            const uint8_t fontsmp = px[y * w + x];
 
 #if (FONT_RENDER_QUALITY == 0 || FONT_RENDER_QUALITY == 1)
             if (!fontsmp) continue;
@@ -127,9 +133,9 @@ void cpymo_backend_text_draw(
     if (SDL_LockSurface(framebuffer) == -1) return;
 
 #if (FONT_RENDER_QUALITY == 1 || FONT_RENDER_QUALITY == 3)
-    cpymo_backend_text_draw_internal(t, x + 1, y + 1, cpymo_color_inv(col), alpha);
+    cpymo_backend_text_draw_internal(t->px, (int)t->w, (int)t->h, x + 1, y + 1, cpymo_color_inv(col), alpha);
 #endif
-    cpymo_backend_text_draw_internal(t, x, y, col, alpha);
+    cpymo_backend_text_draw_internal(t->px, (int)t->w, (int)t->h, x, y, col, alpha);
 
     SDL_UnlockSurface(framebuffer);
 }
@@ -139,15 +145,93 @@ float cpymo_backend_text_width(
     float height)
 { 
     float scale = stbtt_ScaleForPixelHeight(&font, height);
+    return (float)cpymo_backend_font_text_width(s, scale);
+}
 
-    int ascent;
-    stbtt_GetFontVMetrics(&font, &ascent, NULL, NULL);
-    float baseline = scale * ascent;
+typedef struct {
+    float x, y;
+    cpymo_backend_glyph_run run;
+} cpymo_backend_text_run_impl;
+
+error_t cpymo_backend_text_run_create(
+    cpymo_backend_text_run *out,
+    size_t max_characters,
+    float x, float y, float w, float h,
+    float height)
+{
+    cpymo_backend_text_run_impl *r = malloc(sizeof(cpymo_backend_text_run_impl));
+    if (r == NULL) return CPYMO_ERR_OUT_OF_MEM;
 
-    int w, h;
-    cpymo_backend_font_render(NULL, &w, &h, s, scale, baseline);
+    r->x = x;
+    r->y = y;
 
-    return (float)w;
+    // one more line for descenders and shadow below the last baseline.
+    float scale = stbtt_ScaleForPixelHeight(&font, height);
+    error_t err = cpymo_backend_glyph_run_init(
+        &r->run, max_characters, (int)w + 1, (int)(h + height), scale);
+    if (err != CPYMO_ERR_SUCC) {
+        free(r);
+        return err;
+    }
+
+    *out = r;
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_text_run_free(cpymo_backend_text_run r_)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+    cpymo_backend_glyph_run_free(&r->run);
+    free(r);
+}
+
+void cpymo_backend_text_run_clear(cpymo_backend_text_run r_)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+    cpymo_backend_glyph_run_clear(&r->run);
+}
+
+error_t cpymo_backend_text_run_append(
+    cpymo_backend_text_run r_,
+    float *out_width,
+    cpymo_str s,
+    float x, float y_baseline)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+
+    cpymo_str tail = s;
+    uint32_t codepoint = cpymo_str_utf8_try_head_to_utf32(&tail);
+    if (codepoint == 0) return CPYMO_ERR_INVALID_ARG;
+
+    error_t err = cpymo_backend_glyph_run_append(
+        &r->run, codepoint, x - r->x, y_baseline - r->y);
+    CPYMO_THROW(err);
+
+    *out_width = (float)cpymo_backend_font_text_width(s, r->run.scale);
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_text_run_draw(
+    cpymo_backend_text_run r_,
+    size_t visible_count,
+    cpymo_color col, float alpha,
+    enum cpymo_backend_image_draw_type draw_type)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+
+    cpymo_backend_font_compose_run(&r->run, visible_count);
+    if (r->run.composed == 0) return;
+
+    if (SDL_LockSurface(framebuffer) == -1) return;
+
+#if (FONT_RENDER_QUALITY == 1 || FONT_RENDER_QUALITY == 3)
+    cpymo_backend_text_draw_internal(
+        r->run.px, r->run.w, r->run.h, r->x + 1, r->y + 1, cpymo_color_inv(col), alpha);
+#endif
+    cpymo_backend_text_draw_internal(
+        r->run.px, r->run.w, r->run.h, r->x, r->y, col, alpha);
+
+    SDL_UnlockSurface(framebuffer);
 }
 
 
@@ -1,5 +1,6 @@
 ﻿#include "../../cpymo/cpymo_prelude.h"
 #include "../../cpymo/cpymo_engine.h"
+#include "../../cpymo/cpymo_atomic.h"
 #include "../include/cpymo_backend_audio.h"
 #include "cpymo_import_sdl2.h"
 #include <stdbool.h>
@@ -15,7 +16,9 @@
 
 #ifndef DISABLE_SDL2_AUDIO_BACKEND
 static bool audio_enabled;
-extern cpymo_engine engine;
+
+// There is one SDL audio device, it mixes audio system of the engine which opened it.
+static cpymo_audio_system *audio_system = NULL;
 
 #ifndef SDL2_AUDIO_DEFAULT_FREQ
 #define SDL2_AUDIO_DEFAULT_FREQ 48000
@@ -43,22 +46,26 @@ static cpymo_backend_audio_info audio_info = {
 	SDL2_AUDIO_DEFULAT_CHANNELS
 };
 
+static double cpymo_backend_audio_seconds(Uint64 begin, Uint64 end)
+{
+	return (double)(end - begin) / (double)SDL_GetPerformanceFrequency();
+}
+
 static void cpymo_backend_audio_sdl_callback(void *userdata, Uint8 * stream, int len)
 {
-	memset(stream, 0, (size_t)len);
-	
-	for (size_t cid = 0; cid < CPYMO_AUDIO_MAX_CHANNELS; ++cid) {
-		void *samples = NULL;
-		size_t szlen = (size_t)len;
-		size_t written = 0;
-		float volume = cpymo_audio_get_channel_volume(cid, &engine.audio);
-
-		while (cpymo_audio_channel_get_samples(&samples, &szlen, cid, &engine.audio) && szlen) {
-			SDL_MixAudio(stream + written, (Uint8 *)samples, (Uint32)szlen, (int)(volume * SDL_MIX_MAXVOLUME));
-			written += szlen;
-			szlen = (size_t)len - written;
-		}
-	}
+	cpymo_audio_system *audio = (cpymo_audio_system *)userdata;
+
+	Uint64 begin = SDL_GetPerformanceCounter();
+	bool complete = cpymo_audio_copy_mixed_samples(stream, (size_t)len, audio);
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	const size_t frame_size = 
+		audio_info.channels * (audio_info.format == cpymo_backend_audio_s16 ? 2 : 4);
+	cpymo_audio_telemetry_callback(
+		audio,
+		cpymo_backend_audio_seconds(begin, end),
+		(double)len / (double)(frame_size * audio_info.freq),
+		complete);
 }
 
 const cpymo_backend_audio_info *cpymo_backend_audio_get_info(void)
@@ -66,6 +73,75 @@ const cpymo_backend_audio_info *cpymo_backend_audio_get_info(void)
 	return audio_enabled ? &audio_info : NULL;
 }
 
+static SDL_Thread *decoder_thread = NULL;
+static SDL_mutex *decoder_mutex = NULL;
+static SDL_sem *decoder_sem = NULL;
+static volatile bool decoder_running = false;
+
+static int cpymo_backend_audio_decoder_thread(void *userdata)
+{
+	cpymo_audio_system *audio = (cpymo_audio_system *)userdata;
+	while (cpymo_atomic_bool_load(&decoder_running)) {
+		cpymo_audio_decode(audio);
+		SDL_SemWaitTimeout(decoder_sem, 10);
+	}
+
+	return 0;
+}
+
+static void cpymo_backend_audio_decoder_stop(void)
+{
+	if (decoder_thread) {
+		cpymo_atomic_bool_store(&decoder_running, false);
+		SDL_SemPost(decoder_sem);
+		SDL_WaitThread(decoder_thread, NULL);
+		decoder_thread = NULL;
+	}
+
+	if (decoder_sem) SDL_DestroySemaphore(decoder_sem);
+	if (decoder_mutex) SDL_DestroyMutex(decoder_mutex);
+	decoder_sem = NULL;
+	decoder_mutex = NULL;
+}
+
+static bool cpymo_backend_audio_decoder_start(void)
+{
+	if (decoder_thread) return true;
+
+	decoder_mutex = SDL_CreateMutex();
+	decoder_sem = SDL_CreateSemaphore(0);
+	if (decoder_mutex == NULL || decoder_sem == NULL) {
+		cpymo_backend_audio_decoder_stop();
+		return false;
+	}
+
+	decoder_running = true;
+	decoder_thread = SDL_CreateThread(
+		&cpymo_backend_audio_decoder_thread, "cpymo audio decoder", audio_system);
+	if (decoder_thread == NULL) {
+		cpymo_backend_audio_decoder_stop();
+		return false;
+	}
+
+	return true;
+}
+
+void cpymo_backend_audio_decoder_lock(void)
+{
+	if (decoder_mutex) SDL_LockMutex(decoder_mutex);
+}
+
+void cpymo_backend_audio_decoder_unlock(void)
+{
+	if (decoder_mutex) SDL_UnlockMutex(decoder_mutex);
+}
+
+void cpymo_backend_audio_decoder_wake(void)
+{
+	if (decoder_sem && SDL_SemValue(decoder_sem) == 0) 
+		SDL_SemPost(decoder_sem);
+}
+
 static bool cpymo_backend_audio_supported(const SDL_AudioSpec *spec)
 {
 	return (spec->format == AUDIO_S16SYS
@@ -78,12 +154,14 @@ static SDL_AudioSpec have;
 
 static uint64_t current_audio_driver;
 
-void cpymo_backend_audio_init()
+void cpymo_backend_audio_init(cpymo_audio_system *audio)
 {
 	SDL_AudioSpec want;
+	audio_system = audio;
 	
 	SDL_memset(&want, 0, sizeof(want));
 	want.callback = &cpymo_backend_audio_sdl_callback;
+	want.userdata = audio;
 	want.channels = SDL2_AUDIO_DEFULAT_CHANNELS;
 	want.format = SDL2_AUDIO_DEFAULT_FORMAT_SDL;
 	want.freq = SDL2_AUDIO_DEFAULT_FREQ;
@@ -129,6 +207,11 @@ void cpymo_backend_audio_init()
 		return;
 	}
 
+	if (!cpymo_backend_audio_decoder_start()) {
+		SDL_CloseAudio();
+		goto FAIL;
+	}
+
 	SDL_LockAudio();
 	SDL_PauseAudio(0);
 
@@ -142,11 +225,16 @@ void cpymo_backend_audio_free()
 	if (audio_enabled) {
 		SDL_CloseAudio();
 	}
+
+	cpymo_backend_audio_decoder_stop();
 }
 
+static Uint64 lock_begin;
+
 void cpymo_backend_audio_lock(void)
 {
 	SDL_LockAudio();
+	lock_begin = SDL_GetPerformanceCounter();
 }
 
 void cpymo_backend_audio_reset()
@@ -161,6 +249,7 @@ void cpymo_backend_audio_reset()
 
 		SDL_CloseAudio();
 
+		have.userdata = audio_system;
 		if (SDL_OpenAudio(&have, NULL) != 0) {
 			printf("[Error] Failed to reset audio: %s\n", SDL_GetError());
 			audio_enabled = false;
@@ -172,18 +261,21 @@ void cpymo_backend_audio_reset()
 		current_audio_driver = current_audio_driver_hash;
 	}
 	else {
-		cpymo_backend_audio_init();
+		cpymo_backend_audio_init(audio_system);
 		SDL_UnlockAudio();
 	}
 }
 
 void cpymo_backend_audio_unlock(void)
 {
+	cpymo_audio_telemetry_lock_held(
+		audio_system,
+		cpymo_backend_audio_seconds(lock_begin, SDL_GetPerformanceCounter()));
 	SDL_UnlockAudio();
 }
 #else
 
-void cpymo_backend_audio_init() {}
+void cpymo_backend_audio_init(cpymo_audio_system *audio) {}
 void cpymo_backend_audio_free() {}
 void cpymo_backend_audio_reset() {}
 const cpymo_backend_audio_info *cpymo_backend_audio_get_info(void) 
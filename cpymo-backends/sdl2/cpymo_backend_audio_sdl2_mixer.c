@@ -290,6 +290,9 @@ void cpymo_audio_se_stop(struct cpymo_engine *e)
 	se_data = NULL;
 }
 
+error_t cpymo_audio_vo_prepare(struct cpymo_engine *e, cpymo_str voname)
+{ return CPYMO_ERR_SUCC; }
+
 error_t cpymo_audio_vo_play(struct cpymo_engine *e, cpymo_str voname)
 {
 	if (!enabled) return CPYMO_ERR_SUCC;
@@ -12,6 +12,7 @@
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "../../stb/stb_truetype.h"
+#include "../software/cpymo_backend_glyph_cache.h"
 
 #ifdef __UWP__
 #include <malloc.h>
@@ -26,6 +27,7 @@
 
 stbtt_fontinfo font;
 static unsigned char *ttf_buffer = NULL;
+static cpymo_backend_glyph_cache glyph_cache;
 
 
 static error_t cpymo_backend_font_try_load_font(const char *path)
@@ -46,6 +48,7 @@ static error_t cpymo_backend_font_try_load_font(const char *path)
 
 void cpymo_backend_font_free()
 {
+	cpymo_backend_glyph_cache_free(&glyph_cache);
 	if (ttf_buffer) free(ttf_buffer);
 	ttf_buffer = NULL;
 }
@@ -197,11 +200,7 @@ void cpymo_backend_font_render(void *out_or_null, int *w, int *h, cpymo_str text
 	float y_base = 0;
 	while (text.len > 0) {
 		uint32_t codepoint = cpymo_str_utf8_try_head_to_utf32(&text);
-		int x0, y0, x1, y1;
-
-		int advance_width, lsb;
 		float x_shift = xpos - (float)floor(xpos);
-		stbtt_GetCodepointHMetrics(&font, (int)codepoint, &advance_width, &lsb);
 
 		if (codepoint == '\n') {
 			xpos = 0;
@@ -211,26 +210,30 @@ void cpymo_backend_font_render(void *out_or_null, int *w, int *h, cpymo_str text
 			continue;
 		}
 
-		stbtt_GetCodepointBitmapBoxSubpixel(&font, (int)codepoint, scale, scale, x_shift, 0, &x0, &y0, &x1, &y1);
+		cpymo_backend_glyph glyph;
+		cpymo_backend_glyph_cache_get(
+			&glyph_cache, &font, codepoint, scale, x_shift, &glyph);
+
 		if (out_or_null) {
-			stbtt_MakeCodepointBitmapSubpixel(
-				&font,
-				(unsigned char *)out_or_null + (int)xpos + x0 + (int)(baseline + y0 + y_base) * *w,
-				x1 - x0, y1 - y0, *w, scale, scale, x_shift, 0, (int)codepoint);
+			cpymo_backend_glyph_blit(
+				&glyph, (uint8_t *)out_or_null, *w, *h,
+				(int)xpos + glyph.x0,
+				(int)(baseline + glyph.y0 + y_base));
 		}
 
-		xpos += (advance_width * scale);
+		xpos += (glyph.advance_width * scale);
 
 		cpymo_str text2 = text;
 		uint32_t next_char = cpymo_str_utf8_try_head_to_utf32(&text2);
 		if (next_char) {
-			xpos += scale * stbtt_GetCodepointKernAdvance(&font, codepoint, next_char);
+			xpos += scale * cpymo_backend_glyph_cache_get_kern_advance(
+				&glyph_cache, &font, codepoint, next_char);
 		}
 
 		int new_width = (int)ceil(xpos);
 		if (new_width > width) width = new_width;
 
-		int new_height = (int)((y1 - y0) + baseline + y_base);
+		int new_height = (int)(glyph.h + baseline + y_base);
 		if (new_height > height) height = new_height;
 	}
 
@@ -238,4 +241,14 @@ void cpymo_backend_font_render(void *out_or_null, int *w, int *h, cpymo_str text
 	*h = height;
 }
 
+int cpymo_backend_font_text_width(cpymo_str text, float scale)
+{
+	return cpymo_backend_glyph_cache_text_width(&glyph_cache, &font, text, scale);
+}
+
+void cpymo_backend_font_compose_run(cpymo_backend_glyph_run *run, size_t visible_count)
+{
+	cpymo_backend_glyph_run_compose(run, &glyph_cache, &font, visible_count);
+}
+
 #endif
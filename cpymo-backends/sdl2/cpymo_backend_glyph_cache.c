@@ -0,0 +1,4 @@
+#include "../../cpymo/cpymo_prelude.h"
+#ifndef DISABLE_STB_TRUETYPE
+#include "../software/cpymo_backend_glyph_cache.c"
+#endif
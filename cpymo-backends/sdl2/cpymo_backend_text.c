@@ -6,6 +6,7 @@
 #include "../../stb/stb_truetype.h"
 #include "../include/cpymo_backend_text.h"
 #include "../include/cpymo_backend_image.h"
+#include "../software/cpymo_backend_glyph_cache.h"
 #include "cpymo_import_sdl2.h"
 #include <stdlib.h>
 #include <memory.h>
@@ -13,6 +14,7 @@
 #include <assert.h>
 
 extern stbtt_fontinfo font;
+extern SDL_Renderer *renderer;
 
 typedef struct {
     float scale;
@@ -24,6 +26,8 @@ typedef struct {
 
 
 void cpymo_backend_font_render(void *out_or_null, int *w, int *h, cpymo_str text, float scale, float baseline);
+int cpymo_backend_font_text_width(cpymo_str text, float scale);
+void cpymo_backend_font_compose_run(cpymo_backend_glyph_run *run, size_t visible_count);
 
 error_t cpymo_backend_text_create(
     cpymo_backend_text *out,
@@ -133,14 +137,147 @@ void cpymo_backend_text_draw(
 float cpymo_backend_text_width(cpymo_str t, float single_character_size_in_logical_screen)
 {
     float scale = stbtt_ScaleForPixelHeight(&font, single_character_size_in_logical_screen);
-    int ascent;
-    stbtt_GetFontVMetrics(&font, &ascent, NULL, NULL);
-    float baseline = scale * ascent;
+    return (float)cpymo_backend_font_text_width(t, scale);
+}
+
+typedef struct {
+    float x, y;
+    SDL_Texture *tex;
+    cpymo_backend_glyph_run run;
+} cpymo_backend_text_run_internal;
+
+error_t cpymo_backend_text_run_create(
+    cpymo_backend_text_run *out,
+    size_t max_characters,
+    float x, float y, float w, float h,
+    float single_character_size_in_logical_screen)
+{
+    cpymo_backend_text_run_internal *r = 
+        (cpymo_backend_text_run_internal *)malloc(sizeof(cpymo_backend_text_run_internal));
+    if (r == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    r->x = x;
+    r->y = y;
+
+    // one more line for descenders and shadow below the last baseline.
+    int px_w = (int)ceilf(w) + 4;
+    int px_h = (int)ceilf(h + single_character_size_in_logical_screen);
+
+    float scale = stbtt_ScaleForPixelHeight(&font, single_character_size_in_logical_screen);
+    error_t err = cpymo_backend_glyph_run_init(&r->run, max_characters, px_w, px_h, scale);
+    if (err != CPYMO_ERR_SUCC) {
+        free(r);
+        return err;
+    }
 
-    int w, h;
-    cpymo_backend_font_render(NULL, &w, &h, t, scale, baseline);
+    r->tex = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_RGBA8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        px_w, px_h);
+
+    if (r->tex == NULL) {
+        SDL_Log("Warning: Can not create text run texture: %s", SDL_GetError());
+        cpymo_backend_glyph_run_free(&r->run);
+        free(r);
+        return CPYMO_ERR_UNKNOWN;
+    }
+
+    SDL_SetTextureBlendMode(r->tex, SDL_BLENDMODE_BLEND);
+
+    *out = r;
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_text_run_free(cpymo_backend_text_run run)
+{
+    cpymo_backend_text_run_internal *r = (cpymo_backend_text_run_internal *)run;
+    SDL_DestroyTexture(r->tex);
+    cpymo_backend_glyph_run_free(&r->run);
+    free(r);
+}
+
+void cpymo_backend_text_run_clear(cpymo_backend_text_run run)
+{
+    cpymo_backend_text_run_internal *r = (cpymo_backend_text_run_internal *)run;
+    cpymo_backend_glyph_run_clear(&r->run);
+}
 
-    return (float)w;
+error_t cpymo_backend_text_run_append(
+    cpymo_backend_text_run run,
+    float *out_width,
+    cpymo_str utf8_character,
+    float x, float y_baseline)
+{
+    cpymo_backend_text_run_internal *r = (cpymo_backend_text_run_internal *)run;
+
+    cpymo_str tail = utf8_character;
+    uint32_t codepoint = cpymo_str_utf8_try_head_to_utf32(&tail);
+    if (codepoint == 0) return CPYMO_ERR_INVALID_ARG;
+
+    error_t err = cpymo_backend_glyph_run_append(
+        &r->run, codepoint, x - r->x, y_baseline - r->y);
+    CPYMO_THROW(err);
+
+    *out_width = (float)cpymo_backend_font_text_width(utf8_character, r->run.scale);
+    return CPYMO_ERR_SUCC;
+}
+
+static void cpymo_backend_text_run_upload(cpymo_backend_text_run_internal *r)
+{
+    if (r->run.dirty_y0 >= r->run.dirty_y1) return;
+
+    SDL_Rect rect;
+    rect.x = 0;
+    rect.y = r->run.dirty_y0;
+    rect.w = r->run.w;
+    rect.h = r->run.dirty_y1 - r->run.dirty_y0;
+
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(r->tex, &rect, &pixels, &pitch) != 0)
+        return;
+
+    for (int y = 0; y < rect.h; ++y) {
+        Uint32 *dst = (Uint32 *)((Uint8 *)pixels + y * pitch);
+        const uint8_t *src = r->run.px + (size_t)(rect.y + y) * (size_t)r->run.w;
+        for (int x = 0; x < rect.w; ++x)
+            dst[x] = 0xFFFFFF00 | src[x];
+    }
+
+    SDL_UnlockTexture(r->tex);
+
+    r->run.dirty_y0 = 0;
+    r->run.dirty_y1 = 0;
+}
+
+void cpymo_backend_text_run_draw(
+    cpymo_backend_text_run run,
+    size_t visible_count,
+    cpymo_color col, float alpha,
+    enum cpymo_backend_image_draw_type draw_type)
+{
+    cpymo_backend_text_run_internal *r = (cpymo_backend_text_run_internal *)run;
+
+    cpymo_backend_font_compose_run(&r->run, visible_count);
+    cpymo_backend_text_run_upload(r);
+    if (r->run.composed == 0) return;
+
+    SDL_SetTextureColorMod(r->tex, 255 - col.r, 255 - col.g, 255 - col.b);
+    cpymo_backend_image_draw(
+        r->x + 1, r->y + 1,
+        (float)r->run.w, (float)r->run.h,
+        (cpymo_backend_image)r->tex,
+        0, 0, r->run.w, r->run.h,
+        alpha, draw_type);
+
+    SDL_SetTextureColorMod(r->tex, col.r, col.g, col.b);
+    cpymo_backend_image_draw(
+        r->x, r->y,
+        (float)r->run.w, (float)r->run.h,
+        (cpymo_backend_image)r->tex,
+        0, 0, r->run.w, r->run.h,
+        alpha, draw_type);
 }
 
 #endif
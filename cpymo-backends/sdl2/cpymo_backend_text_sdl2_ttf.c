@@ -190,4 +190,6 @@ float cpymo_backend_text_width(
 
     return (float)w;
 }
+
+#include "../include/cpymo_backend_text_run_generic.h"
 #endif
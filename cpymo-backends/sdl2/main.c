@@ -53,6 +53,12 @@
 #include <crtdbg.h>
 #endif
 
+// Longest sleep when engine waits only for input, 
+// events SDL does not report are still checked this often.
+#ifndef SDL2_IDLE_MAX_WAIT_MS
+#define SDL2_IDLE_MAX_WAIT_MS 1000
+#endif
+
 #ifdef __APPLE__
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -68,10 +74,14 @@ SDL_Window *window;
 SDL_Renderer *renderer;
 cpymo_engine engine;
 
+#ifndef USE_GAME_SELECTOR
+static cpymo_replay record;
+#endif
+
 extern error_t cpymo_backend_font_init(const char *gamedir);
 extern void cpymo_backend_font_free();
 
-extern void cpymo_backend_audio_init();
+extern void cpymo_backend_audio_init(cpymo_audio_system *audio);
 extern void cpymo_backend_audio_free();
 
 static void set_window_icon(const char *gamedir) 
@@ -410,11 +420,16 @@ START:
 
 #ifndef USE_GAME_SELECTOR
 	const char *gamedir = "./";
+	const char *record_path = NULL;
 
 #ifndef __EMSCRIPTEN__
-	if (argc == 2) {
+	if (argc == 2 || argc == 4) {
 		gamedir = argv[1];
 	}
+
+	if (argc == 4 && !strcmp(argv[2], "--record")) {
+		record_path = argv[3];
+	}
 #else
 	gamedir = EMSCRIPTEN_GAMEDIR;
 #endif
@@ -433,7 +448,7 @@ START:
 		return -1;
 	}
 
-	cpymo_backend_audio_init();
+	cpymo_backend_audio_init(&engine.audio);
 
 #ifndef USE_GAME_SELECTOR
 	error_t err = cpymo_engine_init(&engine, gamedir);
@@ -564,6 +579,16 @@ START:
 		return -1;
 	}
 
+#ifndef USE_GAME_SELECTOR
+	record.file = NULL;
+	if (record_path) {
+		const cpymo_replay_config config = cpymo_engine_replay_config(&engine);
+		err = cpymo_replay_open_record(&record, record_path, (uint32_t)time(NULL), &config);
+		if (err == CPYMO_ERR_SUCC) cpymo_engine_attach_replay(&engine, &record);
+		else SDL_Log("[Warning] Can not record input to %s: %s", record_path, cpymo_error_message(err));
+	}
+#endif
+
 	Uint32 prev_ticks = SDL_GetTicks();
 	SDL_Event event;
 
@@ -649,6 +674,12 @@ START:
 				#endif
 			}
 #endif
+#ifdef ENABLE_PROFILER
+			else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+				cpymo_profiler_toggle_overlay(engine.profiler);
+				cpymo_engine_request_redraw(&engine);
+			}
+#endif
 #ifdef ENABLE_ALT_ENTER_FULLSCREEN
 			else if (event.type == SDL_KEYDOWN) {
 				if (event.key.keysym.sym == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT)) {
@@ -719,13 +750,30 @@ START:
 			//fps_counter++;
 		}
 #ifndef DISABLE_VSYNC
+#ifdef __EMSCRIPTEN__
 		else SDL_Delay(16);
+#else
+		else {
+			// Sleep until input arrives or engine needs an update.
+			const float deadline = cpymo_engine_get_deadline(&engine);
+			if (deadline > 0.016f) {
+				Uint32 timeout = SDL2_IDLE_MAX_WAIT_MS;
+				if (deadline * 1000.0f < (float)timeout) timeout = (Uint32)(deadline * 1000.0f);
+				SDL_WaitEventTimeout(NULL, (int)timeout);
+			}
+			else SDL_Delay(16);
+		}
+#endif
 #endif
 	}
 
 EXIT:
 	cpymo_engine_free(&engine);
 
+#ifndef USE_GAME_SELECTOR
+	cpymo_replay_close(&record);
+#endif
+
 	extern void cpymo_input_free_joysticks();
 	cpymo_input_free_joysticks();
 
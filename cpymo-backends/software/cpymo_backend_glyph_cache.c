@@ -0,0 +1,507 @@
+#include "../../cpymo/cpymo_prelude.h"
+#include "cpymo_backend_glyph_cache.h"
+#include "../../stb/stb_ds.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct cpymo_backend_glyph_cache_slot {
+    uint64_t key;
+    int glyph_index;
+    int x0, y0, w, h;
+    int advance_width, left_side_bearing;
+    int prev, next;
+} cpymo_backend_glyph_cache_slot;
+
+typedef struct {
+    uint64_t key;
+    int value;
+} cpymo_backend_glyph_cache_index;
+
+typedef struct {
+    uint32_t key;
+    cpymo_backend_glyph_metrics value;
+} cpymo_backend_glyph_cache_metrics_index;
+
+#define CPYMO_BACKEND_GLYPH_CACHE_KERN_UNKNOWN INT16_MIN
+
+static inline uint64_t cpymo_backend_glyph_cache_key(
+    uint32_t codepoint, float scale, unsigned subpixel_bucket)
+{
+    uint32_t scale_bits;
+    memcpy(&scale_bits, &scale, sizeof(scale_bits));
+    return ((uint64_t)scale_bits << 32)
+        | ((uint64_t)codepoint << 8)
+        | (uint64_t)subpixel_bucket;
+}
+
+static inline uint8_t *cpymo_backend_glyph_cache_slot_px(
+    cpymo_backend_glyph_cache *c, int slot)
+{
+    size_t x = (size_t)(slot % CPYMO_BACKEND_GLYPH_CACHE_SLOTS_X);
+    size_t y = (size_t)(slot / CPYMO_BACKEND_GLYPH_CACHE_SLOTS_X);
+    return c->atlas
+        + y * CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE * CPYMO_BACKEND_GLYPH_CACHE_ATLAS_W
+        + x * CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE;
+}
+
+static void cpymo_backend_glyph_cache_lru_unlink(
+    cpymo_backend_glyph_cache *c, int slot)
+{
+    cpymo_backend_glyph_cache_slot *s = c->slots + slot;
+    if (s->prev >= 0) c->slots[s->prev].next = s->next;
+    else c->lru_head = s->next;
+
+    if (s->next >= 0) c->slots[s->next].prev = s->prev;
+    else c->lru_tail = s->prev;
+
+    s->prev = -1;
+    s->next = -1;
+}
+
+static void cpymo_backend_glyph_cache_lru_push_front(
+    cpymo_backend_glyph_cache *c, int slot)
+{
+    cpymo_backend_glyph_cache_slot *s = c->slots + slot;
+    s->prev = -1;
+    s->next = c->lru_head;
+    if (c->lru_head >= 0) c->slots[c->lru_head].prev = slot;
+    c->lru_head = slot;
+    if (c->lru_tail < 0) c->lru_tail = slot;
+}
+
+void cpymo_backend_glyph_cache_clear(cpymo_backend_glyph_cache *c)
+{
+    cpymo_backend_glyph_cache_index *index =
+        (cpymo_backend_glyph_cache_index *)c->index;
+    if (index) hmfree(index);
+    c->index = NULL;
+
+    cpymo_backend_glyph_cache_metrics_index *metrics =
+        (cpymo_backend_glyph_cache_metrics_index *)c->metrics;
+    if (metrics) hmfree(metrics);
+    c->metrics = NULL;
+
+    if (c->ascii_kern) free(c->ascii_kern);
+    c->ascii_kern = NULL;
+
+    for (size_t i = 0; i < 128; ++i)
+        c->ascii_metrics[i].cached = false;
+
+    c->lru_head = -1;
+    c->lru_tail = -1;
+    c->used_slots = 0;
+}
+
+void cpymo_backend_glyph_cache_free(cpymo_backend_glyph_cache *c)
+{
+    cpymo_backend_glyph_cache_clear(c);
+    if (c->atlas) free(c->atlas);
+    if (c->slots) free(c->slots);
+    cpymo_backend_glyph_cache_init(c);
+}
+
+static void cpymo_backend_glyph_cache_check_font(
+    cpymo_backend_glyph_cache *c, const stbtt_fontinfo *font)
+{
+    // font reloaded, such as switching game in game selector.
+    if (c->font != font || c->font_data != font->data) {
+        cpymo_backend_glyph_cache_clear(c);
+        c->font = font;
+        c->font_data = font->data;
+    }
+}
+
+static bool cpymo_backend_glyph_cache_alloc_atlas(cpymo_backend_glyph_cache *c)
+{
+    if (c->atlas) return true;
+
+    c->atlas = (uint8_t *)malloc(
+        CPYMO_BACKEND_GLYPH_CACHE_ATLAS_W * CPYMO_BACKEND_GLYPH_CACHE_ATLAS_H);
+    if (c->atlas == NULL) return false;
+
+    c->slots = (cpymo_backend_glyph_cache_slot *)malloc(
+        sizeof(cpymo_backend_glyph_cache_slot) * CPYMO_BACKEND_GLYPH_CACHE_SLOTS);
+    if (c->slots == NULL) {
+        free(c->atlas);
+        c->atlas = NULL;
+        return false;
+    }
+
+    c->lru_head = -1;
+    c->lru_tail = -1;
+    c->used_slots = 0;
+    return true;
+}
+
+cpymo_backend_glyph_metrics cpymo_backend_glyph_cache_get_metrics(
+    cpymo_backend_glyph_cache *c,
+    const stbtt_fontinfo *font,
+    uint32_t codepoint)
+{
+    cpymo_backend_glyph_cache_check_font(c, font);
+
+    if (codepoint < 128 && c->ascii_metrics[codepoint].cached)
+        return c->ascii_metrics[codepoint];
+
+    cpymo_backend_glyph_cache_metrics_index *metrics =
+        (cpymo_backend_glyph_cache_metrics_index *)c->metrics;
+
+    if (codepoint >= 128) {
+        cpymo_backend_glyph_cache_metrics_index *found =
+            hmgetp_null(metrics, codepoint);
+        c->metrics = (void *)metrics;
+        if (found) return found->value;
+    }
+
+    cpymo_backend_glyph_metrics m;
+    m.cached = true;
+    m.glyph_index = stbtt_FindGlyphIndex(font, (int)codepoint);
+    stbtt_GetGlyphHMetrics(
+        font, m.glyph_index, &m.advance_width, &m.left_side_bearing);
+
+    if (codepoint < 128) {
+        c->ascii_metrics[codepoint] = m;
+    }
+    else {
+        hmput(metrics, codepoint, m);
+        c->metrics = (void *)metrics;
+    }
+
+    return m;
+}
+
+int cpymo_backend_glyph_cache_get_kern_advance(
+    cpymo_backend_glyph_cache *c,
+    const stbtt_fontinfo *font,
+    uint32_t codepoint1,
+    uint32_t codepoint2)
+{
+    cpymo_backend_glyph_cache_check_font(c, font);
+
+    if (codepoint1 < 128 && codepoint2 < 128) {
+        if (c->ascii_kern == NULL) {
+            c->ascii_kern = (int16_t *)malloc(sizeof(int16_t) * 128 * 128);
+            if (c->ascii_kern)
+                for (size_t i = 0; i < 128 * 128; ++i)
+                    c->ascii_kern[i] = CPYMO_BACKEND_GLYPH_CACHE_KERN_UNKNOWN;
+        }
+
+        if (c->ascii_kern) {
+            int16_t *kern = c->ascii_kern + codepoint1 * 128 + codepoint2;
+            if (*kern == CPYMO_BACKEND_GLYPH_CACHE_KERN_UNKNOWN) {
+                cpymo_backend_glyph_metrics m1 =
+                    cpymo_backend_glyph_cache_get_metrics(c, font, codepoint1);
+                cpymo_backend_glyph_metrics m2 =
+                    cpymo_backend_glyph_cache_get_metrics(c, font, codepoint2);
+                *kern = (int16_t)stbtt_GetGlyphKernAdvance(
+                    font, m1.glyph_index, m2.glyph_index);
+            }
+            return *kern;
+        }
+    }
+
+    // glyph index lookup is the expensive part of kerning,
+    // so reuse the cached glyph indices.
+    cpymo_backend_glyph_metrics m1 =
+        cpymo_backend_glyph_cache_get_metrics(c, font, codepoint1);
+    cpymo_backend_glyph_metrics m2 =
+        cpymo_backend_glyph_cache_get_metrics(c, font, codepoint2);
+    return stbtt_GetGlyphKernAdvance(font, m1.glyph_index, m2.glyph_index);
+}
+
+int cpymo_backend_glyph_cache_text_width(
+    cpymo_backend_glyph_cache *c,
+    const stbtt_fontinfo *font,
+    cpymo_str text,
+    float scale)
+{
+    float xpos = 0;
+    int width = 0;
+
+    while (text.len > 0) {
+        uint32_t codepoint = cpymo_str_utf8_try_head_to_utf32(&text);
+
+        if (codepoint == '\n') {
+            xpos = 0;
+            continue;
+        }
+
+        cpymo_backend_glyph_metrics m =
+            cpymo_backend_glyph_cache_get_metrics(c, font, codepoint);
+        xpos += m.advance_width * scale;
+
+        cpymo_str text2 = text;
+        uint32_t next_char = cpymo_str_utf8_try_head_to_utf32(&text2);
+        if (next_char)
+            xpos += scale * cpymo_backend_glyph_cache_get_kern_advance(
+                c, font, codepoint, next_char);
+
+        int new_width = (int)ceil(xpos);
+        if (new_width > width) width = new_width;
+    }
+
+    return width;
+}
+
+static void cpymo_backend_glyph_cache_fill_uncached(
+    cpymo_backend_glyph_cache *c,
+    const stbtt_fontinfo *font,
+    uint32_t codepoint, float scale, float x_shift,
+    cpymo_backend_glyph *out)
+{
+    cpymo_backend_glyph_metrics m =
+        cpymo_backend_glyph_cache_get_metrics(c, font, codepoint);
+
+    int x1, y1;
+    stbtt_GetGlyphBitmapBoxSubpixel(
+        font, m.glyph_index, scale, scale, x_shift, 0,
+        &out->x0, &out->y0, &x1, &y1);
+    out->w = x1 - out->x0;
+    out->h = y1 - out->y0;
+
+    out->advance_width = m.advance_width;
+    out->left_side_bearing = m.left_side_bearing;
+
+    out->px = NULL;
+    out->stride = 0;
+    out->font = font;
+    out->glyph_index = m.glyph_index;
+    out->scale = scale;
+    out->x_shift = x_shift;
+}
+
+void cpymo_backend_glyph_cache_get(
+    cpymo_backend_glyph_cache *c,
+    const stbtt_fontinfo *font,
+    uint32_t codepoint,
+    float scale,
+    float x_shift,
+    cpymo_backend_glyph *out)
+{
+    unsigned bucket =
+        (unsigned)(x_shift * CPYMO_BACKEND_GLYPH_CACHE_SUBPIXEL_BUCKETS);
+    if (bucket >= CPYMO_BACKEND_GLYPH_CACHE_SUBPIXEL_BUCKETS)
+        bucket = CPYMO_BACKEND_GLYPH_CACHE_SUBPIXEL_BUCKETS - 1;
+    x_shift = (float)bucket / (float)CPYMO_BACKEND_GLYPH_CACHE_SUBPIXEL_BUCKETS;
+
+    cpymo_backend_glyph_cache_check_font(c, font);
+
+    if (!cpymo_backend_glyph_cache_alloc_atlas(c)) {
+        cpymo_backend_glyph_cache_fill_uncached(
+            c, font, codepoint, scale, x_shift, out);
+        return;
+    }
+
+    const uint64_t key =
+        cpymo_backend_glyph_cache_key(codepoint, scale, bucket);
+
+    cpymo_backend_glyph_cache_index *index =
+        (cpymo_backend_glyph_cache_index *)c->index;
+    cpymo_backend_glyph_cache_index *found = hmgetp_null(index, key);
+    c->index = (void *)index;
+
+    int slot;
+    if (found) {
+        slot = found->value;
+        cpymo_backend_glyph_cache_lru_unlink(c, slot);
+        cpymo_backend_glyph_cache_lru_push_front(c, slot);
+    }
+    else {
+        cpymo_backend_glyph_cache_fill_uncached(
+            c, font, codepoint, scale, x_shift, out);
+
+        if (out->w > CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE
+            || out->h > CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE)
+            return;
+
+        if (c->used_slots < CPYMO_BACKEND_GLYPH_CACHE_SLOTS) {
+            slot = c->used_slots++;
+            c->slots[slot].prev = -1;
+            c->slots[slot].next = -1;
+        }
+        else {
+            slot = c->lru_tail;
+            cpymo_backend_glyph_cache_lru_unlink(c, slot);
+            hmdel(index, c->slots[slot].key);
+        }
+
+        cpymo_backend_glyph_cache_slot *s = c->slots + slot;
+        s->key = key;
+        s->glyph_index = out->glyph_index;
+        s->x0 = out->x0;
+        s->y0 = out->y0;
+        s->w = out->w;
+        s->h = out->h;
+        s->advance_width = out->advance_width;
+        s->left_side_bearing = out->left_side_bearing;
+
+        if (s->w > 0 && s->h > 0)
+            stbtt_MakeGlyphBitmapSubpixel(
+                font,
+                cpymo_backend_glyph_cache_slot_px(c, slot),
+                s->w, s->h, CPYMO_BACKEND_GLYPH_CACHE_ATLAS_W,
+                scale, scale, x_shift, 0, s->glyph_index);
+
+        hmput(index, key, slot);
+        c->index = (void *)index;
+        cpymo_backend_glyph_cache_lru_push_front(c, slot);
+    }
+
+    const cpymo_backend_glyph_cache_slot *s = c->slots + slot;
+    out->x0 = s->x0;
+    out->y0 = s->y0;
+    out->w = s->w;
+    out->h = s->h;
+    out->advance_width = s->advance_width;
+    out->left_side_bearing = s->left_side_bearing;
+    out->px = cpymo_backend_glyph_cache_slot_px(c, slot);
+    out->stride = CPYMO_BACKEND_GLYPH_CACHE_ATLAS_W;
+    out->font = font;
+    out->glyph_index = s->glyph_index;
+    out->scale = scale;
+    out->x_shift = x_shift;
+}
+
+void cpymo_backend_glyph_blit(
+    const cpymo_backend_glyph *g,
+    uint8_t *dst, int dst_w, int dst_h,
+    int x, int y)
+{
+    if (g->w <= 0 || g->h <= 0) return;
+
+    const uint8_t *src = g->px;
+    size_t src_stride = g->stride;
+    uint8_t *uncached = NULL;
+
+    if (src == NULL) {
+        uncached = (uint8_t *)malloc((size_t)g->w * (size_t)g->h);
+        if (uncached == NULL) return;
+
+        stbtt_MakeGlyphBitmapSubpixel(
+            g->font, uncached, g->w, g->h, g->w,
+            g->scale, g->scale, g->x_shift, 0, g->glyph_index);
+
+        src = uncached;
+        src_stride = (size_t)g->w;
+    }
+
+    int sx = 0, sy = 0, w = g->w, h = g->h;
+    if (x < 0) { sx = -x; w += x; x = 0; }
+    if (y < 0) { sy = -y; h += y; y = 0; }
+    if (x + w > dst_w) w = dst_w - x;
+    if (y + h > dst_h) h = dst_h - y;
+
+    for (int row = 0; row < h; ++row) {
+        uint8_t *dst_line = dst + (size_t)(y + row) * (size_t)dst_w + x;
+        const uint8_t *src_line = src + (size_t)(sy + row) * src_stride + sx;
+        for (int col = 0; col < w; ++col)
+            if (src_line[col] > dst_line[col]) dst_line[col] = src_line[col];
+    }
+
+    if (uncached) free(uncached);
+}
+
+error_t cpymo_backend_glyph_run_init(
+    cpymo_backend_glyph_run *r,
+    size_t max_count,
+    int w, int h,
+    float scale)
+{
+    if (w <= 0 || h <= 0) return CPYMO_ERR_INVALID_ARG;
+
+    r->px = (uint8_t *)malloc((size_t)w * (size_t)h);
+    if (r->px == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    r->items = NULL;
+    if (max_count) {
+        r->items = (cpymo_backend_glyph_run_item *)malloc(
+            sizeof(cpymo_backend_glyph_run_item) * max_count);
+        if (r->items == NULL) {
+            free(r->px);
+            return CPYMO_ERR_OUT_OF_MEM;
+        }
+    }
+
+    r->w = w;
+    r->h = h;
+    r->scale = scale;
+    r->max_count = max_count;
+    cpymo_backend_glyph_run_clear(r);
+
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_glyph_run_free(cpymo_backend_glyph_run *r)
+{
+    if (r->px) free(r->px);
+    if (r->items) free(r->items);
+    r->px = NULL;
+    r->items = NULL;
+}
+
+void cpymo_backend_glyph_run_clear(cpymo_backend_glyph_run *r)
+{
+    memset(r->px, 0, (size_t)r->w * (size_t)r->h);
+    r->count = 0;
+    r->composed = 0;
+    r->dirty_y0 = 0;
+    r->dirty_y1 = r->h;
+}
+
+error_t cpymo_backend_glyph_run_append(
+    cpymo_backend_glyph_run *r,
+    uint32_t codepoint,
+    float x, float y_baseline)
+{
+    if (r->count >= r->max_count) return CPYMO_ERR_OUT_OF_MEM;
+
+    cpymo_backend_glyph_run_item *item = r->items + r->count++;
+    item->codepoint = codepoint;
+    item->x = x;
+    item->y_baseline = y_baseline;
+
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_glyph_run_compose(
+    cpymo_backend_glyph_run *r,
+    cpymo_backend_glyph_cache *c,
+    const stbtt_fontinfo *font,
+    size_t visible_count)
+{
+    if (visible_count > r->count) visible_count = r->count;
+
+    if (visible_count < r->composed) {
+        memset(r->px, 0, (size_t)r->w * (size_t)r->h);
+        r->composed = 0;
+        r->dirty_y0 = 0;
+        r->dirty_y1 = r->h;
+    }
+
+    for (; r->composed < visible_count; r->composed++) {
+        const cpymo_backend_glyph_run_item *item = r->items + r->composed;
+
+        cpymo_backend_glyph glyph;
+        cpymo_backend_glyph_cache_get(
+            c, font, item->codepoint, r->scale,
+            item->x - (float)floor(item->x), &glyph);
+
+        int x = (int)floor(item->x) + glyph.x0;
+        int y = (int)floor(item->y_baseline) + glyph.y0;
+        cpymo_backend_glyph_blit(&glyph, r->px, r->w, r->h, x, y);
+
+        int y0 = y < 0 ? 0 : y;
+        int y1 = y + glyph.h > r->h ? r->h : y + glyph.h;
+        if (y0 >= y1) continue;
+
+        if (r->dirty_y0 >= r->dirty_y1) {
+            r->dirty_y0 = y0;
+            r->dirty_y1 = y1;
+        }
+        else {
+            if (y0 < r->dirty_y0) r->dirty_y0 = y0;
+            if (y1 > r->dirty_y1) r->dirty_y1 = y1;
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef INCLUDE_CPYMO_BACKEND_GLYPH_CACHE
+#define INCLUDE_CPYMO_BACKEND_GLYPH_CACHE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../../stb/stb_truetype.h"
+#include "../../cpymo/cpymo_str.h"
+#include "../../cpymo/cpymo_error.h"
+
+// Glyphs are cached in a fixed size atlas of square slots,
+// the least recently used glyph will be evicted when the atlas is full.
+// Glyphs larger than a slot are not cached.
+//
+// Horizontal metrics and kerning are cached separately without size,
+// they are unscaled so one table serves every font size.
+
+#ifndef CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE
+#define CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE 64
+#endif
+
+#ifndef CPYMO_BACKEND_GLYPH_CACHE_SLOTS_X
+#define CPYMO_BACKEND_GLYPH_CACHE_SLOTS_X 16
+#endif
+
+#ifndef CPYMO_BACKEND_GLYPH_CACHE_SLOTS_Y
+#define CPYMO_BACKEND_GLYPH_CACHE_SLOTS_Y 16
+#endif
+
+#ifndef CPYMO_BACKEND_GLYPH_CACHE_SUBPIXEL_BUCKETS
+#define CPYMO_BACKEND_GLYPH_CACHE_SUBPIXEL_BUCKETS 4
+#endif
+
+#define CPYMO_BACKEND_GLYPH_CACHE_SLOTS \
+    (CPYMO_BACKEND_GLYPH_CACHE_SLOTS_X * CPYMO_BACKEND_GLYPH_CACHE_SLOTS_Y)
+
+#define CPYMO_BACKEND_GLYPH_CACHE_ATLAS_W \
+    (CPYMO_BACKEND_GLYPH_CACHE_SLOTS_X * CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE)
+
+#define CPYMO_BACKEND_GLYPH_CACHE_ATLAS_H \
+    (CPYMO_BACKEND_GLYPH_CACHE_SLOTS_Y * CPYMO_BACKEND_GLYPH_CACHE_SLOT_SIZE)
+
+typedef struct {
+    // bitmap box relative to pen position on baseline.
+    int x0, y0, w, h;
+
+    // unscaled horizontal metrics.
+    int advance_width, left_side_bearing;
+
+    // coverage bitmap, NULL if this glyph is not cached.
+    const uint8_t *px;
+    size_t stride;
+
+    // used to rasterize glyphs which are not cached.
+    const stbtt_fontinfo *font;
+    int glyph_index;
+    float scale, x_shift;
+} cpymo_backend_glyph;
+
+typedef struct {
+    bool cached;
+    int glyph_index;
+    int advance_width, left_side_bearing;
+} cpymo_backend_glyph_metrics;
+
+struct cpymo_backend_glyph_cache_slot;
+
+typedef struct {
+    const stbtt_fontinfo *font;
+    const unsigned char *font_data;
+
+    uint8_t *atlas;
+    struct cpymo_backend_glyph_cache_slot *slots;
+    void *index;
+
+    int lru_head, lru_tail, used_slots;
+
+    cpymo_backend_glyph_metrics ascii_metrics[128];
+    void *metrics;
+    int16_t *ascii_kern;
+} cpymo_backend_glyph_cache;
+
+// A zero-initialized cache is valid, memory is allocated on first use.
+static inline void cpymo_backend_glyph_cache_init(cpymo_backend_glyph_cache *c)
+{
+    c->font = NULL;
+    c->font_data = NULL;
+    c->atlas = NULL;
+    c->slots = NULL;
+    c->index = NULL;
+    c->lru_head = -1;
+    c->lru_tail = -1;
+    c->used_slots = 0;
+    c->metrics = NULL;
+    c->ascii_kern = NULL;
+
+    for (size_t i = 0; i < 128; ++i)
+        c->ascii_metrics[i].cached = false;
+}
+
+void cpymo_backend_glyph_cache_free(cpymo_backend_glyph_cache *);
+void cpymo_backend_glyph_cache_clear(cpymo_backend_glyph_cache *);
+
+// Never fails, if glyph can not be cached, out->px will be NULL.
+void cpymo_backend_glyph_cache_get(
+    cpymo_backend_glyph_cache *,
+    const stbtt_fontinfo *font,
+    uint32_t codepoint,
+    float scale,
+    float x_shift,
+    cpymo_backend_glyph *out);
+
+// Unscaled advance and kerning, dense table for ASCII and hash for others.
+cpymo_backend_glyph_metrics cpymo_backend_glyph_cache_get_metrics(
+    cpymo_backend_glyph_cache *,
+    const stbtt_fontinfo *font,
+    uint32_t codepoint);
+
+int cpymo_backend_glyph_cache_get_kern_advance(
+    cpymo_backend_glyph_cache *,
+    const stbtt_fontinfo *font,
+    uint32_t codepoint1,
+    uint32_t codepoint2);
+
+// Same width as measured by rendering text, but only sums cached advances.
+int cpymo_backend_glyph_cache_text_width(
+    cpymo_backend_glyph_cache *,
+    const stbtt_fontinfo *font,
+    cpymo_str text,
+    float scale);
+
+// Copy glyph coverage into a single channel bitmap, clipped by its size.
+// Coverage is combined with max, so overlapping glyph boxes are kept.
+void cpymo_backend_glyph_blit(
+    const cpymo_backend_glyph *glyph,
+    uint8_t *dst, int dst_w, int dst_h,
+    int x, int y);
+
+// Positioned glyphs composed into one coverage bitmap,
+// glyphs are only rasterized when visible count changes.
+typedef struct {
+    uint32_t codepoint;
+    float x, y_baseline;
+} cpymo_backend_glyph_run_item;
+
+typedef struct {
+    uint8_t *px;
+    int w, h;
+    float scale;
+
+    cpymo_backend_glyph_run_item *items;
+    size_t count, max_count, composed;
+
+    // rows changed by last compose, nothing changed if dirty_y0 >= dirty_y1.
+    int dirty_y0, dirty_y1;
+} cpymo_backend_glyph_run;
+
+error_t cpymo_backend_glyph_run_init(
+    cpymo_backend_glyph_run *,
+    size_t max_count,
+    int w, int h,
+    float scale);
+
+void cpymo_backend_glyph_run_free(cpymo_backend_glyph_run *);
+void cpymo_backend_glyph_run_clear(cpymo_backend_glyph_run *);
+
+// x and y_baseline are in pixels of run bitmap.
+error_t cpymo_backend_glyph_run_append(
+    cpymo_backend_glyph_run *,
+    uint32_t codepoint,
+    float x, float y_baseline);
+
+void cpymo_backend_glyph_run_compose(
+    cpymo_backend_glyph_run *,
+    cpymo_backend_glyph_cache *,
+    const stbtt_fontinfo *font,
+    size_t visible_count);
+
+#endif
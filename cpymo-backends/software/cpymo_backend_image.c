@@ -6,7 +6,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-extern cpymo_backend_software_context 
+extern CPYMO_THREAD_LOCAL cpymo_backend_software_context 
     *cpymo_backend_software_cur_context;
 
 void cpymo_backend_image_scale_on_load(
@@ -4,79 +4,143 @@
 #include <stddef.h>
 #include <stdlib.h>
 
-extern void cpymo_backend_image_scale_on_load(
-    void **pixels, int *width, int *height, size_t channels);
+extern CPYMO_THREAD_LOCAL cpymo_backend_software_context
+    *cpymo_backend_software_cur_context;
+
+typedef struct {
+    uint8_t *mask;
+    size_t mask_w, mask_h;
+
+    // mask resampled to render target resolution,
+    // so drawing is a linear pass without any sampling.
+    uint8_t *resampled;
+    size_t resampled_w, resampled_h;
+} cpymo_backend_masktrans_software;
+
+static error_t cpymo_backend_masktrans_resample(
+    cpymo_backend_masktrans_software *m, size_t w, size_t h)
+{
+    uint8_t *resampled = (uint8_t *)realloc(m->resampled, w * h);
+    if (resampled == NULL) return CPYMO_ERR_OUT_OF_MEM;
+    m->resampled = resampled;
+    m->resampled_w = w;
+    m->resampled_h = h;
+
+    for (size_t y = 0; y < h; ++y) {
+        size_t sv = (size_t)((float)y / (float)h * (float)(m->mask_h - 1));
+        const uint8_t *src_line = m->mask + sv * m->mask_w;
+        uint8_t *dst_line = resampled + y * w;
+
+        for (size_t x = 0; x < w; ++x) {
+            size_t su = (size_t)((float)x / (float)w * (float)(m->mask_w - 1));
+            dst_line[x] = src_line[su];
+        }
+    }
+
+    return CPYMO_ERR_SUCC;
+}
 
 error_t cpymo_backend_masktrans_create(
     cpymo_backend_masktrans *out,
     void *mask_singlechannel_moveinto,
     int w, int h)
-{ 
-    cpymo_backend_image_scale_on_load(
-        &mask_singlechannel_moveinto,
-        &w, &h, 1);
-    
-    cpymo_backend_software_image *img =
-        (cpymo_backend_software_image *)malloc(sizeof(*img));
-    if (img == NULL) return CPYMO_ERR_OUT_OF_MEM;
-
-    img->r_offset = 0;
-    img->g_offset = 0;
-    img->b_offset = 0;
-    img->a_offset = 0;
-    img->w = w;
-    img->h = h;
-    img->has_alpha_channel = true;
-    img->line_stride = w;
-    img->pixel_stride = 1;
-    img->pixels = (uint8_t *)mask_singlechannel_moveinto;
-    
-    *out = img;
+{
+    cpymo_backend_masktrans_software *m =
+        (cpymo_backend_masktrans_software *)malloc(sizeof(*m));
+    if (m == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    m->mask = (uint8_t *)mask_singlechannel_moveinto;
+    m->mask_w = (size_t)w;
+    m->mask_h = (size_t)h;
+    m->resampled = NULL;
+    m->resampled_w = 0;
+    m->resampled_h = 0;
+
+    const cpymo_backend_software_image *render_target =
+        cpymo_backend_software_cur_context->render_target;
+
+    error_t err = cpymo_backend_masktrans_resample(
+        m, render_target->w, render_target->h);
+    if (err != CPYMO_ERR_SUCC) {
+        free(m);
+        return err;
+    }
+
+    *out = m;
     return CPYMO_ERR_SUCC;
 }
 
-void cpymo_backend_masktrans_free(cpymo_backend_masktrans m) 
+void cpymo_backend_masktrans_free(cpymo_backend_masktrans mt)
+{
+    cpymo_backend_masktrans_software *m =
+        (cpymo_backend_masktrans_software *)mt;
+    free(m->mask);
+    free(m->resampled);
+    free(m);
+}
+
+static inline uint8_t cpymo_backend_masktrans_mul_div255(
+    unsigned v, unsigned factor)
 {
-    cpymo_backend_software_image *img =
-        (cpymo_backend_software_image *)m;
-    free(img->pixels);
-    free(img);
+    unsigned x = v * factor + 128;
+    return (uint8_t)((x + (x >> 8)) >> 8);
 }
 
 void cpymo_backend_masktrans_draw(
-    cpymo_backend_masktrans m, 
+    cpymo_backend_masktrans mt,
     float t, bool is_fade_in)
 {
-    extern cpymo_backend_software_context 
-        *cpymo_backend_software_cur_context;
-    
+    cpymo_backend_masktrans_software *m =
+        (cpymo_backend_masktrans_software *)mt;
+
     cpymo_backend_software_image *render_target =
         cpymo_backend_software_cur_context->render_target;
 
+    // render target may be resized after creating, such as terminal resizing.
+    if (m->resampled_w != render_target->w
+        || m->resampled_h != render_target->h) {
+        error_t err = cpymo_backend_masktrans_resample(
+            m, render_target->w, render_target->h);
+        if (err != CPYMO_ERR_SUCC) return;
+    }
+
     if (!is_fade_in) t = 1.0f - t;
 
     const float radius = 0.25f;
     float t_top = t + radius;
-	float t_bottom = t - radius;
+    float t_bottom = t - radius;
+
+    // maps mask value to the factor which keeps destination color,
+    // 255 keeps it untouched and 0 turns it to black.
+    uint8_t keep_lut[256];
+    for (unsigned i = 0; i < 256; ++i) {
+        float mask = (float)i / 255.0f;
+        if (!is_fade_in) mask = 1.0f - mask;
+
+        if (mask > t_top) mask = 1.0f;
+        else if (mask < t_bottom) mask = 0.0f;
+        else mask = (mask - t_bottom) / (2 * radius);
+
+        keep_lut[i] = (uint8_t)(255.0f - mask * 255.0f + 0.5f);
+    }
+
+    const size_t
+        pixel_stride = render_target->pixel_stride,
+        r_offset = render_target->r_offset,
+        g_offset = render_target->g_offset,
+        b_offset = render_target->b_offset;
 
     for (size_t y = 0; y < render_target->h; ++y) {
-        for (size_t x = 0; x < render_target->w; ++x) {
-            float mask;
-            float dummy;
-            cpymo_backend_software_image_sample_nearest(
-                (cpymo_backend_software_image *)m,
-                (float)x / (float)render_target->w,
-                (float)y / (float)render_target->h,
-                &mask, &dummy, &dummy, &dummy);
-
-            if (!is_fade_in) mask = 1.0f - mask;
-
-            if (mask > t_top) mask = 1.0f;
-			else if (mask < t_bottom) mask = 0.0f;
-			else mask = (mask - t_bottom) / (2 * radius);
-
-            cpymo_backend_software_image_write_blend(
-                render_target, x, y, 0, 0, 0, mask);
+        const uint8_t *mask_line = m->resampled + y * m->resampled_w;
+        uint8_t *px = render_target->pixels + y * render_target->line_stride;
+
+        for (size_t x = 0; x < render_target->w; ++x, px += pixel_stride) {
+            const unsigned keep = keep_lut[mask_line[x]];
+            if (keep == 255) continue;
+
+            px[r_offset] = cpymo_backend_masktrans_mul_div255(px[r_offset], keep);
+            px[g_offset] = cpymo_backend_masktrans_mul_div255(px[g_offset], keep);
+            px[b_offset] = cpymo_backend_masktrans_mul_div255(px[b_offset], keep);
         }
     }
 }
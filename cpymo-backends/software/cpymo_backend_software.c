@@ -1,10 +1,18 @@
 #include "../../cpymo/cpymo_prelude.h"
 #include "cpymo_backend_software.h"
+#include "cpymo_backend_glyph_cache.h"
 
-cpymo_backend_software_context 
+CPYMO_THREAD_LOCAL cpymo_backend_software_context 
     *cpymo_backend_software_cur_context = NULL;
 
+CPYMO_THREAD_LOCAL cpymo_backend_glyph_cache cpymo_backend_software_glyph_cache;
+
 void cpymo_backend_software_set_context(
     cpymo_backend_software_context *context)
-{ cpymo_backend_software_cur_context = context; }
+{
+    // glyphs are rasterized for render target of the previous context.
+    if (context != cpymo_backend_software_cur_context)
+        cpymo_backend_glyph_cache_free(&cpymo_backend_software_glyph_cache);
 
+    cpymo_backend_software_cur_context = context;
+}
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "../../stb/stb_truetype.h"
+#include "../../cpymo/cpymo_atomic.h"
 
 typedef struct {
     size_t w, h, line_stride, pixel_stride;
@@ -29,6 +30,9 @@ typedef struct {
     stbtt_fontinfo *font;
 } cpymo_backend_software_context;
 
+// Context and glyph cache are per thread,
+// so every thread can drive its own engine and render target.
+// A thread should set context to NULL before it exits to free its glyph cache.
 void cpymo_backend_software_set_context(
     cpymo_backend_software_context *context);
 
@@ -4,6 +4,7 @@
 #include "../../cpymo/cpymo_str.h"
 #include "../include/cpymo_backend_text.h"
 #include "cpymo_backend_software.h"
+#include "cpymo_backend_glyph_cache.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -16,9 +17,11 @@
 #define TEXT_CHARACTER_W_SCALE 4
 #endif
 
-extern cpymo_backend_software_context 
+extern CPYMO_THREAD_LOCAL cpymo_backend_software_context 
     *cpymo_backend_software_cur_context;
 
+extern CPYMO_THREAD_LOCAL cpymo_backend_glyph_cache cpymo_backend_software_glyph_cache;
+
 static void cpymo_backend_text_render(
     void *out_or_null, 
     int *w, int *h, 
@@ -32,11 +35,7 @@ static void cpymo_backend_text_render(
 	float y_base = 0;
 	while (text.len > 0) {
 		uint32_t codepoint = cpymo_str_utf8_try_head_to_utf32(&text);
-		int x0, y0, x1, y1;
-
-		int advance_width, lsb;
 		float x_shift = xpos - (float)floor(xpos);
-		stbtt_GetCodepointHMetrics(font, (int)codepoint, &advance_width, &lsb);
 
 		if (codepoint == '\n') {
 			xpos = 0;
@@ -46,25 +45,30 @@ static void cpymo_backend_text_render(
 			continue;
 		}
 
-		stbtt_GetCodepointBitmapBoxSubpixel(font, (int)codepoint, scale, scale, x_shift, 0, &x0, &y0, &x1, &y1);
+		cpymo_backend_glyph glyph;
+		cpymo_backend_glyph_cache_get(
+			&cpymo_backend_software_glyph_cache,
+			font, codepoint, scale, x_shift, &glyph);
+
 		if (out_or_null)
-			stbtt_MakeCodepointBitmapSubpixel(
-				font,
-				(unsigned char *)out_or_null + (int)xpos + x0 + (int)(baseline + y0 + y_base) * *w,
-				x1 - x0, y1 - y0, *w, scale, scale, x_shift, 0, (int)codepoint);
+			cpymo_backend_glyph_blit(
+				&glyph, (uint8_t *)out_or_null, *w, *h,
+				(int)xpos + glyph.x0,
+				(int)(baseline + glyph.y0 + y_base));
 
-		xpos += (advance_width * scale);
+		xpos += (glyph.advance_width * scale);
 
 		cpymo_str text2 = text;
 		uint32_t next_char = cpymo_str_utf8_try_head_to_utf32(&text2);
 		if (next_char) {
-			xpos += scale * stbtt_GetCodepointKernAdvance(font, codepoint, next_char);
+			xpos += scale * cpymo_backend_glyph_cache_get_kern_advance(
+				&cpymo_backend_software_glyph_cache, font, codepoint, next_char);
 		}
 
 		int new_width = (int)ceil(xpos);
 		if (new_width > width) width = new_width;
 
-		int new_height = (int)((y1 - y0) + baseline + y_base);
+		int new_height = (int)(glyph.h + baseline + y_base);
 		if (new_height > height) height = new_height;
 	}
 
@@ -121,7 +125,9 @@ error_t cpymo_backend_text_create(
 
 void cpymo_backend_text_free(cpymo_backend_text t){ free(t); }
 
-static void cpymo_backend_text_draw_internal(cpymo_color col, float x, float y, float alpha, cpymo_backend_text_impl *t)
+static void cpymo_backend_text_draw_internal(
+    cpymo_color col, float x, float y, float alpha, 
+    const uint8_t *px, size_t w, size_t h)
 {
     cpymo_backend_software_image *render_target = 
         cpymo_backend_software_cur_context->render_target;
@@ -135,15 +141,17 @@ static void cpymo_backend_text_draw_internal(cpymo_color col, float x, float y,
     y /= cpymo_backend_software_cur_context->logical_screen_h;
     y *= window_size_h;
 
-    for (uint16_t draw_rect_y = 0; draw_rect_y < t->h; ++draw_rect_y) {
-        for (uint16_t draw_rect_x = 0; draw_rect_x < t->w * TEXT_CHARACTER_W_SCALE; ++draw_rect_x) {
+    for (size_t draw_rect_y = 0; draw_rect_y < h; ++draw_rect_y) {
+        for (size_t draw_rect_x = 0; draw_rect_x < w * TEXT_CHARACTER_W_SCALE; ++draw_rect_x) {
             size_t draw_x = draw_rect_x + (size_t)x;
             size_t draw_y = draw_rect_y + (size_t)y;
 
             if (draw_x >= window_size_w || draw_y >= window_size_h) continue;
 
-            float pixel_alpha = 
-                ((float)t->px[draw_rect_y * t->w + draw_rect_x / TEXT_CHARACTER_W_SCALE] / 255.0f);
+            const uint8_t coverage = px[draw_rect_y * w + draw_rect_x / TEXT_CHARACTER_W_SCALE];
+            if (coverage == 0) continue;
+
+            float pixel_alpha = ((float)coverage / 255.0f);
 
             cpymo_backend_software_image_write_blend(
                 render_target, 
@@ -166,8 +174,8 @@ void cpymo_backend_text_draw(
     cpymo_backend_text_impl *t = (cpymo_backend_text_impl *)t_;
     float y = y_baseline - t->baseline;
 
-    cpymo_backend_text_draw_internal(cpymo_color_inv(col), x + 1, y + 1, alpha, t);
-    cpymo_backend_text_draw_internal(col, x, y, alpha, t);
+    cpymo_backend_text_draw_internal(cpymo_color_inv(col), x + 1, y + 1, alpha, t->px, t->w, t->h);
+    cpymo_backend_text_draw_internal(col, x, y, alpha, t->px, t->w, t->h);
 }
 
 float cpymo_backend_text_width(
@@ -185,11 +193,168 @@ float cpymo_backend_text_width(
     float height_norm = single_character_size_in_logical_screen / game_h;
     float height_screen = height_norm * win_h;
     float scale = stbtt_ScaleForPixelHeight(font, height_screen);
-    int ascent;
-    stbtt_GetFontVMetrics(font, &ascent, NULL, NULL);
-    float baseline = scale * ascent;
-    int w, h;
-    cpymo_backend_text_render(NULL, &w, &h, s, scale, baseline);
+    int w = cpymo_backend_glyph_cache_text_width(
+        &cpymo_backend_software_glyph_cache, font, s, scale);
 
     return TEXT_CHARACTER_W_SCALE * (float)w / win_w * game_w;
 }
+
+typedef struct {
+    float x, y, w, h, character_size;
+    size_t max_characters;
+
+    // render target size the run bitmap was laid out for.
+    size_t target_w, target_h;
+    cpymo_backend_glyph_run run;
+} cpymo_backend_text_run_impl;
+
+static error_t cpymo_backend_text_run_layout(
+    cpymo_backend_text_run_impl *r, cpymo_backend_glyph_run *out)
+{
+    const cpymo_backend_software_image *render_target =
+        cpymo_backend_software_cur_context->render_target;
+
+    float game_w = cpymo_backend_software_cur_context->logical_screen_w;
+    float game_h = cpymo_backend_software_cur_context->logical_screen_h;
+
+    float win_w = (float)render_target->w;
+    float win_h = (float)render_target->h;
+
+    float height_screen = r->character_size / game_h * win_h;
+    float scale = stbtt_ScaleForPixelHeight(
+        cpymo_backend_software_cur_context->font, height_screen);
+
+    // one more line for descenders and shadow below the last baseline.
+    int px_w = (int)ceil(r->w / game_w * win_w / TEXT_CHARACTER_W_SCALE) + 1;
+    int px_h = (int)ceil((r->h + r->character_size) / game_h * win_h);
+
+    error_t err = cpymo_backend_glyph_run_init(
+        out, r->max_characters, px_w, px_h, scale);
+    CPYMO_THROW(err);
+
+    r->target_w = render_target->w;
+    r->target_h = render_target->h;
+    return CPYMO_ERR_SUCC;
+}
+
+error_t cpymo_backend_text_run_create(
+    cpymo_backend_text_run *out,
+    size_t max_characters,
+    float x, float y, float w, float h,
+    float single_character_size_in_logical_screen)
+{
+    cpymo_backend_text_run_impl *r = 
+        (cpymo_backend_text_run_impl *)malloc(sizeof(cpymo_backend_text_run_impl));
+    if (r == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+    r->x = x;
+    r->y = y;
+    r->w = w;
+    r->h = h;
+    r->character_size = single_character_size_in_logical_screen;
+    r->max_characters = max_characters;
+
+    error_t err = cpymo_backend_text_run_layout(r, &r->run);
+    if (err != CPYMO_ERR_SUCC) {
+        free(r);
+        return err;
+    }
+
+    *out = r;
+    return CPYMO_ERR_SUCC;
+}
+
+// render target may be resized after creating, such as terminal resizing,
+// glyphs are positioned again and composed at the new size.
+static error_t cpymo_backend_text_run_resize(cpymo_backend_text_run_impl *r)
+{
+    const float ratio_w =
+        (float)cpymo_backend_software_cur_context->render_target->w / (float)r->target_w;
+    const float ratio_h =
+        (float)cpymo_backend_software_cur_context->render_target->h / (float)r->target_h;
+
+    cpymo_backend_glyph_run run;
+    error_t err = cpymo_backend_text_run_layout(r, &run);
+    CPYMO_THROW(err);
+
+    for (size_t i = 0; i < r->run.count; ++i) {
+        const cpymo_backend_glyph_run_item *item = r->run.items + i;
+        cpymo_backend_glyph_run_append(
+            &run, item->codepoint, item->x * ratio_w, item->y_baseline * ratio_h);
+    }
+
+    cpymo_backend_glyph_run_free(&r->run);
+    r->run = run;
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_text_run_free(cpymo_backend_text_run r_)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+    cpymo_backend_glyph_run_free(&r->run);
+    free(r);
+}
+
+void cpymo_backend_text_run_clear(cpymo_backend_text_run r_)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+    cpymo_backend_glyph_run_clear(&r->run);
+}
+
+error_t cpymo_backend_text_run_append(
+    cpymo_backend_text_run r_,
+    float *out_width,
+    cpymo_str utf8_character,
+    float x, float y_baseline)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+
+    float game_w = cpymo_backend_software_cur_context->logical_screen_w;
+    float game_h = cpymo_backend_software_cur_context->logical_screen_h;
+
+    float win_w = (float)cpymo_backend_software_cur_context->render_target->w;
+    float win_h = (float)cpymo_backend_software_cur_context->render_target->h;
+
+    cpymo_str tail = utf8_character;
+    uint32_t codepoint = cpymo_str_utf8_try_head_to_utf32(&tail);
+    if (codepoint == 0) return CPYMO_ERR_INVALID_ARG;
+
+    error_t err = cpymo_backend_glyph_run_append(
+        &r->run, codepoint,
+        (x - r->x) / game_w * win_w / TEXT_CHARACTER_W_SCALE,
+        (y_baseline - r->y) / game_h * win_h);
+    CPYMO_THROW(err);
+
+    int w = cpymo_backend_glyph_cache_text_width(
+        &cpymo_backend_software_glyph_cache,
+        cpymo_backend_software_cur_context->font,
+        utf8_character, r->run.scale);
+    *out_width = TEXT_CHARACTER_W_SCALE * (float)w / win_w * game_w;
+
+    return CPYMO_ERR_SUCC;
+}
+
+void cpymo_backend_text_run_draw(
+    cpymo_backend_text_run r_,
+    size_t visible_count,
+    cpymo_color col, float alpha,
+    enum cpymo_backend_image_draw_type draw_type)
+{
+    cpymo_backend_text_run_impl *r = (cpymo_backend_text_run_impl *)r_;
+
+    const cpymo_backend_software_image *render_target =
+        cpymo_backend_software_cur_context->render_target;
+    if (r->target_w != render_target->w || r->target_h != render_target->h) {
+        error_t err = cpymo_backend_text_run_resize(r);
+        if (err != CPYMO_ERR_SUCC) return;
+    }
+
+    cpymo_backend_glyph_run_compose(
+        &r->run, &cpymo_backend_software_glyph_cache,
+        cpymo_backend_software_cur_context->font, visible_count);
+    if (r->run.composed == 0) return;
+
+    const size_t w = (size_t)r->run.w, h = (size_t)r->run.h;
+    cpymo_backend_text_draw_internal(cpymo_color_inv(col), r->x + 1, r->y + 1, alpha, r->run.px, w, h);
+    cpymo_backend_text_draw_internal(col, r->x, r->y, alpha, r->run.px, w, h);
+}
@@ -133,6 +133,8 @@ float cpymo_backend_text_width(
 void cpymo_backend_text_extract(const char *text)
 { puts(text); }
 
+#include "../include/cpymo_backend_text_run_generic.h"
+
 #ifdef _WIN32
 #include <windows.h>
 static uint64_t millis()
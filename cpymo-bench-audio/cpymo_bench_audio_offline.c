@@ -0,0 +1,147 @@
+#include "../cpymo/cpymo_prelude.h"
+#include "cpymo_bench_audio_offline.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static cpymo_backend_audio_info offline_info = {
+	44100, cpymo_backend_audio_s16, 2
+};
+
+void cpymo_bench_audio_offline_set_info(const cpymo_backend_audio_info *info)
+{
+	offline_info = *info;
+}
+
+const cpymo_backend_audio_info *cpymo_backend_audio_get_info(void)
+{
+	return &offline_info;
+}
+
+// Rendering runs on one thread, so there is nothing to lock.
+void cpymo_backend_audio_lock(void) {}
+void cpymo_backend_audio_unlock(void) {}
+void cpymo_backend_audio_decoder_lock(void) {}
+void cpymo_backend_audio_decoder_unlock(void) {}
+void cpymo_backend_audio_decoder_wake(void) {}
+
+size_t cpymo_bench_audio_frame_size(const cpymo_backend_audio_info *info)
+{
+	return info->channels * (info->format == cpymo_backend_audio_s16 ? 2 : 4);
+}
+
+double cpymo_bench_audio_now(void)
+{
+	#ifdef _WIN32
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)freq.QuadPart;
+	#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+	#endif
+}
+
+error_t cpymo_bench_audio_render(
+	cpymo_audio_system *s,
+	FILE *wav,
+	size_t callback_frames,
+	size_t max_frames,
+	cpymo_bench_audio_render_stats *out_stats)
+{
+	cpymo_bench_audio_render_stats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	const size_t callback_size =
+		callback_frames * cpymo_bench_audio_frame_size(&offline_info);
+	uint8_t *buf = (uint8_t *)malloc(callback_size);
+	if (buf == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+	while (max_frames == 0 || stats.frames < max_frames) {
+		bool playing = false;
+		for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i)
+			playing = playing || cpymo_audio_channel_is_playing(i, s);
+		if (!playing) break;
+
+		const double t0 = cpymo_bench_audio_now();
+		cpymo_audio_decode(s);
+		const double t1 = cpymo_bench_audio_now();
+		cpymo_audio_copy_mixed_samples(buf, callback_size, s);
+		const double t2 = cpymo_bench_audio_now();
+
+		stats.decode_seconds += t1 - t0;
+		stats.mix_seconds += t2 - t1;
+		if (t2 - t1 > stats.mix_worst_seconds) stats.mix_worst_seconds = t2 - t1;
+		stats.frames += callback_frames;
+		stats.callbacks++;
+
+		if (wav && fwrite(buf, 1, callback_size, wav) != callback_size) {
+			free(buf);
+			return CPYMO_ERR_UNKNOWN;
+		}
+	}
+
+	free(buf);
+	*out_stats = stats;
+	return CPYMO_ERR_SUCC;
+}
+
+static void cpymo_bench_audio_put_u16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void cpymo_bench_audio_put_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+// Samples are written as mixed, in native order, so the file is for little-endian hosts.
+error_t cpymo_bench_audio_wav_begin(FILE *wav, const cpymo_backend_audio_info *info)
+{
+	const size_t frame_size = cpymo_bench_audio_frame_size(info);
+
+	uint8_t header[44];
+	memcpy(header, "RIFF", 4);
+	cpymo_bench_audio_put_u32(header + 4, 36);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	cpymo_bench_audio_put_u32(header + 16, 16);
+	cpymo_bench_audio_put_u16(header + 20, info->format == cpymo_backend_audio_f32 ? 3 : 1);
+	cpymo_bench_audio_put_u16(header + 22, (uint16_t)info->channels);
+	cpymo_bench_audio_put_u32(header + 24, (uint32_t)info->freq);
+	cpymo_bench_audio_put_u32(header + 28, (uint32_t)(info->freq * frame_size));
+	cpymo_bench_audio_put_u16(header + 32, (uint16_t)frame_size);
+	cpymo_bench_audio_put_u16(header + 34, (uint16_t)(frame_size / info->channels * 8));
+	memcpy(header + 36, "data", 4);
+	cpymo_bench_audio_put_u32(header + 40, 0);
+
+	if (fwrite(header, 1, sizeof(header), wav) != sizeof(header))
+		return CPYMO_ERR_UNKNOWN;
+	return CPYMO_ERR_SUCC;
+}
+
+error_t cpymo_bench_audio_wav_end(FILE *wav, size_t data_size)
+{
+	uint8_t size[4];
+
+	cpymo_bench_audio_put_u32(size, (uint32_t)(36 + data_size));
+	if (fseek(wav, 4, SEEK_SET) != 0) return CPYMO_ERR_UNKNOWN;
+	if (fwrite(size, 1, 4, wav) != 4) return CPYMO_ERR_UNKNOWN;
+
+	cpymo_bench_audio_put_u32(size, (uint32_t)data_size);
+	if (fseek(wav, 40, SEEK_SET) != 0) return CPYMO_ERR_UNKNOWN;
+	if (fwrite(size, 1, 4, wav) != 4) return CPYMO_ERR_UNKNOWN;
+
+	return CPYMO_ERR_SUCC;
+}
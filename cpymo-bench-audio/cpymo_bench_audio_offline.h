@@ -0,0 +1,35 @@
+#ifndef INCLUDE_CPYMO_BENCH_AUDIO_OFFLINE
+#define INCLUDE_CPYMO_BENCH_AUDIO_OFFLINE
+
+#include "../cpymo/cpymo_audio.h"
+#include "../cpymo-backends/include/cpymo_backend_audio.h"
+#include <stdio.h>
+
+// Audio backend without a device,
+// nothing is played until cpymo_bench_audio_render pulls it.
+void cpymo_bench_audio_offline_set_info(const cpymo_backend_audio_info *info);
+
+size_t cpymo_bench_audio_frame_size(const cpymo_backend_audio_info *info);
+
+double cpymo_bench_audio_now(void);
+
+typedef struct {
+	size_t frames, callbacks;
+	double decode_seconds, mix_seconds, mix_worst_seconds;
+} cpymo_bench_audio_render_stats;
+
+// Decodes and mixes as fast as possible, one callback of callback_frames at a time,
+// until every channel stops or max_frames (0 for no limit) are rendered.
+// The mix is appended to wav if it is not NULL.
+error_t cpymo_bench_audio_render(
+	cpymo_audio_system *s,
+	FILE *wav,
+	size_t callback_frames,
+	size_t max_frames,
+	cpymo_bench_audio_render_stats *out_stats);
+
+// Writes a header with empty sizes, cpymo_bench_audio_wav_end fills them.
+error_t cpymo_bench_audio_wav_begin(FILE *wav, const cpymo_backend_audio_info *info);
+error_t cpymo_bench_audio_wav_end(FILE *wav, size_t data_size);
+
+#endif
@@ -0,0 +1,252 @@
+#include "../cpymo/cpymo_prelude.h"
+
+// import modules from CPyMO
+#include "../cpymo/cpymo_error.c"
+#include "../cpymo/cpymo_color.c"
+#include "../cpymo/cpymo_str.c"
+#include "../cpymo/cpymo_package.c"
+#include "../cpymo/cpymo_audio.c"
+
+#include "cpymo_bench_audio_offline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define STBI_NO_PSD
+#define STBI_NO_TGA
+#define STBI_NO_HDR
+#define STBI_NO_PIC
+#define STBI_NO_PNM
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb/stb_image.h"
+
+#define STB_DS_IMPLEMENTATION
+#include "../stb/stb_ds.h"
+
+#ifdef LEAKCHECK
+#define STB_LEAKCHECK_IMPLEMENTATION
+#include "../stb/stb_leakcheck.h"
+#endif
+
+// Parts of the engine the audio module links to, unused here.
+void *cpymo_utils_malloc_trim_memory(struct cpymo_engine *e, size_t size)
+{ return malloc(size); }
+
+bool cpymo_engine_skipping(cpymo_engine *engine)
+{ return false; }
+
+bool cpymo_memory_reserve(struct cpymo_engine *e, enum cpymo_memory_category c, size_t size)
+{ return true; }
+
+bool cpymo_engine_audio_state(struct cpymo_engine *e, bool live)
+{ return live; }
+
+error_t cpymo_assetloader_get_bgm_path(char **out_str, cpymo_str name, const cpymo_assetloader *l)
+{ return CPYMO_ERR_UNSUPPORTED; }
+
+error_t cpymo_assetloader_get_se_path(char **out_str, cpymo_str name, const cpymo_assetloader *l)
+{ return CPYMO_ERR_UNSUPPORTED; }
+
+error_t cpymo_assetloader_get_vo_path(char **out_str, cpymo_str name, const cpymo_assetloader *l)
+{ return CPYMO_ERR_UNSUPPORTED; }
+
+#define TONE_FREQ 44100
+
+static const struct {
+	const char *ext;
+	const char *desc;
+} codecs[] = {
+	{ "wav", "pcm_s16le" },
+	{ "ogg", "vorbis" },
+	{ "mp3", "mp3" },
+	{ "flac", "flac" },
+};
+
+static const struct {
+	cpymo_backend_audio_format format;
+	const char *name;
+} formats[] = {
+	{ cpymo_backend_audio_s16, "s16" },
+	{ cpymo_backend_audio_s32, "s32" },
+	{ cpymo_backend_audio_f32, "f32" },
+};
+
+// 440 Hz on left, 660 Hz on right, 16 bit stereo.
+static error_t generate_tone(const char *path, size_t seconds)
+{
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+
+	const cpymo_backend_audio_info info = { TONE_FREQ, cpymo_backend_audio_s16, 2 };
+	error_t err = cpymo_bench_audio_wav_begin(f, &info);
+	if (err != CPYMO_ERR_SUCC) {
+		fclose(f);
+		return err;
+	}
+
+	const size_t frames = TONE_FREQ * seconds;
+	int16_t chunk[2 * 1024];
+	for (size_t i = 0; i < frames; i += 1024) {
+		size_t n = frames - i < 1024 ? frames - i : 1024;
+		for (size_t j = 0; j < n; ++j) {
+			const double t = (double)(i + j) / TONE_FREQ;
+			chunk[j * 2] = (int16_t)(sin(t * 440.0 * 2 * 3.14159265358979) * 16000);
+			chunk[j * 2 + 1] = (int16_t)(sin(t * 660.0 * 2 * 3.14159265358979) * 16000);
+		}
+
+		if (fwrite(chunk, sizeof(int16_t) * 2, n, f) != n) {
+			fclose(f);
+			return CPYMO_ERR_UNKNOWN;
+		}
+	}
+
+	err = cpymo_bench_audio_wav_end(f, frames * 4);
+	fclose(f);
+	return err;
+}
+
+static error_t encode_tone(const char *wav_path, const char *out_path)
+{
+	char command[1024];
+	snprintf(command, sizeof(command),
+		"ffmpeg -i \"%s\" -y -v quiet \"%s\"", wav_path, out_path);
+	if (system(command) != 0) return CPYMO_ERR_UNSUPPORTED;
+	return CPYMO_ERR_SUCC;
+}
+
+// Plays one file on every channel at once, so decoding and mixing see full load.
+static error_t bench(
+	const char *codec, const char *path,
+	cpymo_backend_audio_format format, const char *format_name,
+	size_t callback_frames, const char *wav_dir)
+{
+	const cpymo_backend_audio_info info = { TONE_FREQ, format, 2 };
+	cpymo_bench_audio_offline_set_info(&info);
+
+	cpymo_audio_system s;
+	cpymo_audio_init(&s);
+	if (!s.enabled) return CPYMO_ERR_OUT_OF_MEM;
+
+	FILE *wav = NULL;
+	cpymo_bench_audio_render_stats stats;
+	error_t err = CPYMO_ERR_SUCC;
+	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i) {
+		cpymo_audio_set_channel_volume(i, &s, 1.0f / CPYMO_AUDIO_MAX_CHANNELS);
+		cpymo_package_stream_reader r;
+		err = cpymo_package_stream_reader_from_file(&r, path);
+		if (err != CPYMO_ERR_SUCC) goto EXIT;
+
+		err = cpymo_audio_channel_play_file(s.channels + i, &r, false);
+		if (err != CPYMO_ERR_SUCC) goto EXIT;
+	}
+
+	if (wav_dir) {
+		char wav_path[1024];
+		snprintf(wav_path, sizeof(wav_path), "%s/mix-%s-%s.wav", wav_dir, codec, format_name);
+		wav = fopen(wav_path, "wb");
+		if (wav == NULL) {
+			err = CPYMO_ERR_CAN_NOT_OPEN_FILE;
+			goto EXIT;
+		}
+
+		err = cpymo_bench_audio_wav_begin(wav, &info);
+		if (err != CPYMO_ERR_SUCC) {
+			fclose(wav);
+			goto EXIT;
+		}
+	}
+
+	err = cpymo_bench_audio_render(&s, wav, callback_frames, 0, &stats);
+
+	if (wav) {
+		if (err == CPYMO_ERR_SUCC)
+			err = cpymo_bench_audio_wav_end(
+				wav, stats.frames * cpymo_bench_audio_frame_size(&info));
+		fclose(wav);
+	}
+
+	if (err != CPYMO_ERR_SUCC) goto EXIT;
+
+	size_t underruns = 0;
+	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i)
+		underruns += cpymo_audio_get_channel_stats(i, &s).underruns;
+
+	const double decoded = (double)(stats.frames * CPYMO_AUDIO_MAX_CHANNELS);
+	printf("%-6s %-4s %14.0f %14.0f %12.1f %10u\n",
+		codec, format_name,
+		stats.decode_seconds > 0 ? decoded / stats.decode_seconds : 0,
+		stats.mix_seconds > 0 ? (double)stats.frames / stats.mix_seconds : 0,
+		stats.mix_worst_seconds * 1e6,
+		(unsigned)underruns);
+
+EXIT:
+	cpymo_audio_free(&s);
+	return err;
+}
+
+static int help(void)
+{
+	printf("cpymo-bench-audio\n");
+	printf("Decode and mix throughput of CPyMO audio, rendered offline.\n");
+	printf("\n");
+	printf("    cpymo-bench-audio [--seconds <n>] [--callback-frames <n>] [--wav-dir <dir>]\n");
+	printf("\n");
+	printf("Test tones are written to current directory, other codecs than wav need ffmpeg in PATH.\n");
+	printf("With --wav-dir, every mix is saved as mix-<codec>-<format>.wav.\n");
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	size_t seconds = 30;
+	size_t callback_frames = 1024;
+	const char *wav_dir = NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			seconds = (size_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--callback-frames") == 0 && i + 1 < argc)
+			callback_frames = (size_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--wav-dir") == 0 && i + 1 < argc)
+			wav_dir = argv[++i];
+		else return help();
+	}
+
+	if (seconds == 0 || callback_frames == 0) return help();
+
+	error_t err = generate_tone("cpymo-bench-tone.wav", seconds);
+	if (err != CPYMO_ERR_SUCC) {
+		printf("[Error] Can not write test tone: %s.\n", cpymo_error_message(err));
+		return -1;
+	}
+
+	printf("%-6s %-4s %14s %14s %12s %10s\n",
+		"codec", "fmt", "decode smp/s", "mix smp/s", "worst cb us", "underruns");
+
+	int ret = 0;
+	for (size_t i = 0; i < CPYMO_ARR_COUNT(codecs); ++i) {
+		char path[64];
+		snprintf(path, sizeof(path), "cpymo-bench-tone.%s", codecs[i].ext);
+
+		if (i > 0 && encode_tone("cpymo-bench-tone.wav", path) != CPYMO_ERR_SUCC) {
+			printf("[Warning] Can not encode %s with ffmpeg, skipped.\n", codecs[i].desc);
+			continue;
+		}
+
+		for (size_t j = 0; j < CPYMO_ARR_COUNT(formats); ++j) {
+			err = bench(codecs[i].ext, path,
+				formats[j].format, formats[j].name, callback_frames, wav_dir);
+			if (err != CPYMO_ERR_SUCC) {
+				printf("[Error] %s %s: %s.\n",
+					codecs[i].ext, formats[j].name, cpymo_error_message(err));
+				ret = -1;
+			}
+		}
+
+		if (i > 0) remove(path);
+	}
+
+	remove("cpymo-bench-tone.wav");
+	return ret;
+}
@@ -327,8 +327,9 @@ error_t cpymo_tool_asset_filter_run(
           false, true  },
 
         { "bgm", f->filter_bgm, f->filter_bgm_userdata,
-          f->input_assetloader.game_config->bgmformat, NULL, f->asset_list.bgm, NULL,
-          false, false },
+          f->input_assetloader.game_config->bgmformat, NULL, f->asset_list.bgm,
+          f->input_assetloader.use_pkg_bgm ? &f->input_assetloader.pkg_bgm : NULL,
+          false, true },
 
         { "chara", f->filter_chara, f->filter_chara_userdata,
           f->input_assetloader.game_config->charaformat,
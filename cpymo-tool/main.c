@@ -10,6 +10,7 @@
 #include "../cpymo/cpymo_assetloader.c"
 #include "../cpymo/cpymo_album.c"
 #include "../cpymo/cpymo_str.c"
+#include "../cpymo/cpymo_arena.c"
 
 #include <stdio.h>
 #include <math.h>
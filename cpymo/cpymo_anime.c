@@ -78,6 +78,9 @@ void cpymo_anime_update(
 				else cpymo_anime_off(anime);
 			}
 		}
+
+		if (anime->anime_image)
+			cpymo_engine_request_deadline(e, anime->interval - anime->current_time);
 	}
 }
 
@@ -93,3 +96,9 @@ void cpymo_anime_off(cpymo_anime *anime)
 		anime->anime_image = NULL;
 	}
 }
+
+size_t cpymo_anime_memory_usage(const cpymo_anime *anime)
+{
+	if (anime->anime_image == NULL) return 0;
+	return (size_t)anime->image_width * anime->frame_height * anime->all_frame * 4;
+}
@@ -38,6 +38,8 @@ error_t cpymo_anime_on(
 
 void cpymo_anime_off(cpymo_anime *anime);
 
+size_t cpymo_anime_memory_usage(const cpymo_anime *anime);
+
 static inline void cpymo_anime_init(cpymo_anime *anime)
 { anime->anime_image = NULL; anime->anime_name = NULL; }
 
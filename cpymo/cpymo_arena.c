@@ -0,0 +1,85 @@
+﻿#include "cpymo_prelude.h"
+#include "cpymo_arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CPYMO_ARENA_ALIGN 8
+
+struct cpymo_arena_overflow {
+	struct cpymo_arena_overflow *prev;
+};
+
+void cpymo_arena_init(cpymo_arena *a, size_t size)
+{
+	a->buf = (char *)malloc(size);
+	a->size = a->buf ? size : 0;
+	a->top = 0;
+	a->overflow = NULL;
+}
+
+void cpymo_arena_free(cpymo_arena *a)
+{
+	cpymo_arena_reset(a);
+	if (a->buf) free(a->buf);
+	a->buf = NULL;
+	a->size = 0;
+}
+
+void *cpymo_arena_alloc(cpymo_arena *a, size_t size)
+{
+	const size_t begin = (a->top + CPYMO_ARENA_ALIGN - 1) & ~(size_t)(CPYMO_ARENA_ALIGN - 1);
+	if (begin + size <= a->size) {
+		a->top = begin + size;
+		return a->buf + begin;
+	}
+
+	// Header is padded to keep the block aligned.
+	const size_t header =
+		(sizeof(struct cpymo_arena_overflow) + CPYMO_ARENA_ALIGN - 1)
+		& ~(size_t)(CPYMO_ARENA_ALIGN - 1);
+
+	struct cpymo_arena_overflow *o =
+		(struct cpymo_arena_overflow *)malloc(header + size);
+	if (o == NULL) return NULL;
+
+	o->prev = a->overflow;
+	a->overflow = o;
+	return (char *)o + header;
+}
+
+char *cpymo_arena_str(cpymo_arena *a, cpymo_str str)
+{
+	char *cstr = (char *)cpymo_arena_alloc(a, str.len + 1);
+	if (cstr == NULL) return NULL;
+
+	memcpy(cstr, str.begin, str.len);
+	cstr[str.len] = '\0';
+	return cstr;
+}
+
+cpymo_arena_mark cpymo_arena_get_mark(const cpymo_arena *a)
+{
+	cpymo_arena_mark mark;
+	mark.top = a->top;
+	mark.overflow = a->overflow;
+	return mark;
+}
+
+void cpymo_arena_release(cpymo_arena *a, cpymo_arena_mark mark)
+{
+	while (a->overflow != mark.overflow) {
+		struct cpymo_arena_overflow *prev = a->overflow->prev;
+		free(a->overflow);
+		a->overflow = prev;
+	}
+
+	a->top = mark.top;
+}
+
+void cpymo_arena_reset(cpymo_arena *a)
+{
+	cpymo_arena_mark empty;
+	empty.top = 0;
+	empty.overflow = NULL;
+	cpymo_arena_release(a, empty);
+}
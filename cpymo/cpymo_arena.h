@@ -0,0 +1,43 @@
+#ifndef INCLUDE_CPYMO_ARENA
+#define INCLUDE_CPYMO_ARENA
+
+#include <stddef.h>
+#include "cpymo_str.h"
+
+// Bump allocator for buffers which do not outlive a command or a frame.
+// What does not fit is allocated with malloc and freed on release or reset,
+// so callers never free what they get from here.
+// Main thread only.
+
+#ifndef CPYMO_ARENA_SIZE
+#define CPYMO_ARENA_SIZE 4096
+#endif
+
+struct cpymo_arena_overflow;
+
+typedef struct {
+	char *buf;
+	size_t size, top;
+	struct cpymo_arena_overflow *overflow;
+} cpymo_arena;
+
+typedef struct {
+	size_t top;
+	struct cpymo_arena_overflow *overflow;
+} cpymo_arena_mark;
+
+// Never fails, if the buffer can not be allocated everything overflows.
+void cpymo_arena_init(cpymo_arena *a, size_t size);
+void cpymo_arena_free(cpymo_arena *a);
+
+// Returns NULL if out of memory.
+void *cpymo_arena_alloc(cpymo_arena *a, size_t size);
+char *cpymo_arena_str(cpymo_arena *a, cpymo_str str);
+
+// Everything allocated after the mark is released.
+cpymo_arena_mark cpymo_arena_get_mark(const cpymo_arena *a);
+void cpymo_arena_release(cpymo_arena *a, cpymo_arena_mark mark);
+
+void cpymo_arena_reset(cpymo_arena *a);
+
+#endif
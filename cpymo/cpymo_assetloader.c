@@ -1,6 +1,7 @@
 ﻿#include "cpymo_prelude.h"
 #include "cpymo_assetloader.h"
 #include "cpymo_utils.h"
+#include "cpymo_trace.h"
 #include <stdlib.h>
 #include <string.h>
 #include <memory.h>
@@ -16,12 +17,14 @@ error_t cpymo_assetloader_init(cpymo_assetloader * out, const cpymo_gameconfig *
 	out->gamedir = chbuf;
 
 	out->game_config = config;
+	out->arena = NULL;
 
 	if (chbuf == NULL) return CPYMO_ERR_OUT_OF_MEM;
 
 	strcpy(chbuf, gamedir);
 
 	out->use_pkg_bg = false;
+	out->use_pkg_bgm = false;
 	out->use_pkg_chara = false;
 	out->use_pkg_se = false;
 	out->use_pkg_voice = false;
@@ -36,6 +39,16 @@ error_t cpymo_assetloader_init(cpymo_assetloader * out, const cpymo_gameconfig *
 		return err;
 	}
 
+	// init bgm package
+	strcpy(chbuf + gamedir_strlen, "/bgm/bgm.pak");
+	err = cpymo_package_open(&out->pkg_bgm, chbuf);
+	if (err == CPYMO_ERR_SUCC)
+		out->use_pkg_bgm = true;
+	else if (err != CPYMO_ERR_NOT_FOUND && err != CPYMO_ERR_CAN_NOT_OPEN_FILE) {
+		cpymo_assetloader_free(out);
+		return err;
+	}
+
 	// init chara package
 	strcpy(chbuf + gamedir_strlen, "/chara/chara.pak");
 	err = cpymo_package_open(&out->pkg_chara, chbuf);
@@ -77,6 +90,7 @@ void cpymo_assetloader_free(cpymo_assetloader * loader)
 {
 	if (loader) {
 		if (loader->use_pkg_bg) cpymo_package_close(&loader->pkg_bg);
+		if (loader->use_pkg_bgm) cpymo_package_close(&loader->pkg_bgm);
 		if (loader->use_pkg_chara) cpymo_package_close(&loader->pkg_chara);
 		if (loader->use_pkg_se) cpymo_package_close(&loader->pkg_se);
 		if (loader->use_pkg_voice) cpymo_package_close(&loader->pkg_voice);
@@ -84,24 +98,39 @@ void cpymo_assetloader_free(cpymo_assetloader * loader)
 	}
 }
 
-error_t cpymo_assetloader_get_fs_path(
-	char **out_str,
+static void *cpymo_assetloader_alloc_temp(const cpymo_assetloader *l, size_t size)
+{
+	if (l->arena) return cpymo_arena_alloc(l->arena, size);
+	else return malloc(size);
+}
+
+// Arena is released by its owner.
+static void cpymo_assetloader_free_temp(const cpymo_assetloader *l, void *p)
+{
+	if (l->arena == NULL) free(p);
+}
+
+static size_t cpymo_assetloader_fs_path_size(
 	cpymo_str asset_name,
 	const char *asset_type,
 	const char *asset_ext,
 	const cpymo_assetloader *l)
 {
-	assert(*out_str == NULL);
-	char *str = (char *)malloc(
-		strlen(l->gamedir)
+	return strlen(l->gamedir)
 		+ strlen(asset_type)
 		+ 2
 		+ asset_name.len
 		+ strlen(asset_ext)
-		+ 4);
-
-	if (str == NULL) return CPYMO_ERR_OUT_OF_MEM;
+		+ 4;
+}
 
+static void cpymo_assetloader_write_fs_path(
+	char *str,
+	cpymo_str asset_name,
+	const char *asset_type,
+	const char *asset_ext,
+	const cpymo_assetloader *l)
+{
 	strcpy(str, l->gamedir);
 	strcat(str, "/");
 	strcat(str, asset_type);
@@ -109,11 +138,41 @@ error_t cpymo_assetloader_get_fs_path(
 	strncat(str, asset_name.begin, asset_name.len);
 	strcat(str, ".");
 	strcat(str, asset_ext);
+}
+
+error_t cpymo_assetloader_get_fs_path(
+	char **out_str,
+	cpymo_str asset_name,
+	const char *asset_type,
+	const char *asset_ext,
+	const cpymo_assetloader *l)
+{
+	assert(*out_str == NULL);
+	char *str = (char *)malloc(
+		cpymo_assetloader_fs_path_size(asset_name, asset_type, asset_ext, l));
+
+	if (str == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+	cpymo_assetloader_write_fs_path(str, asset_name, asset_type, asset_ext, l);
 
 	*out_str = str;
 	return CPYMO_ERR_SUCC;
 }
 
+// Free it with cpymo_assetloader_free_temp.
+static char *cpymo_assetloader_get_temp_fs_path(
+	cpymo_str asset_name,
+	const char *asset_type,
+	const char *asset_ext,
+	const cpymo_assetloader *l)
+{
+	char *str = (char *)cpymo_assetloader_alloc_temp(
+		l, cpymo_assetloader_fs_path_size(asset_name, asset_type, asset_ext, l));
+
+	if (str) cpymo_assetloader_write_fs_path(str, asset_name, asset_type, asset_ext, l);
+	return str;
+}
+
 static error_t cpymo_assetloader_load_filesystem_file(
 	char **out_buffer,
 	size_t *buf_size,
@@ -122,18 +181,19 @@ static error_t cpymo_assetloader_load_filesystem_file(
 	const char *asset_ext_name,
 	const cpymo_assetloader *assetloader) 
 {
-	char *path = NULL;
-	error_t err = cpymo_assetloader_get_fs_path(
-		&path, 
+	char *path = cpymo_assetloader_get_temp_fs_path(
 		asset_name, 
 		asset_type, 
 		asset_ext_name, 
 		assetloader);
-	CPYMO_THROW(err);
+	if (path == NULL) return CPYMO_ERR_OUT_OF_MEM;
 
-	err = cpymo_utils_loadfile(path, out_buffer, buf_size);
+	CPYMO_TRACE_BEGIN(trace);
+	error_t err = cpymo_utils_loadfile(path, out_buffer, buf_size);
+	CPYMO_TRACE_END(trace, "file", "load", cpymo_str_pure(path), 
+		err == CPYMO_ERR_SUCC ? *buf_size : 0);
 
-	free(path);
+	cpymo_assetloader_free_temp(assetloader, path);
 
 	return err;
 }
@@ -149,12 +209,13 @@ static error_t cpymo_assetloader_load_filesystem_image_pixels(
 	const char *asset_ext_name,
 	const cpymo_assetloader *l)
 {
-	char *path = NULL;
-	error_t err = cpymo_assetloader_get_fs_path(&path, asset_name, asset_type, asset_ext_name, l);
-	CPYMO_THROW(err);
+	char *path = cpymo_assetloader_get_temp_fs_path(asset_name, asset_type, asset_ext_name, l);
+	if (path == NULL) return CPYMO_ERR_OUT_OF_MEM;
 
+	CPYMO_TRACE_BEGIN(trace);
 	*pixels = stbi_load(path, w, h, NULL, c);
-	free(path);
+	CPYMO_TRACE_END(trace, "image", "load_decode", cpymo_str_pure(path), 0);
+	cpymo_assetloader_free_temp(l, path);
 
 	if (*pixels == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
 	
@@ -202,12 +263,14 @@ error_t cpymo_assetloader_load_bg_image(cpymo_backend_image * img, int * w, int
 	error_t err = cpymo_assetloader_load_bg_pixels(&pixels, w, h, name, loader);
 	CPYMO_THROW(err);
 
+	CPYMO_TRACE_BEGIN(trace);
 	err = cpymo_backend_image_load(
 		img,
 		pixels,
 		*w,
 		*h,
 		cpymo_backend_image_format_rgb);
+	CPYMO_TRACE_END(trace, "upload", "bg", name, (size_t)*w * *h * 3);
 
 	if (err != CPYMO_ERR_SUCC) {
 		free(pixels);
@@ -237,7 +300,7 @@ static error_t cpymo_assetloader_load_image_with_mask(
 	CPYMO_THROW(err);
 
 	if (load_mask && cpymo_gameconfig_is_symbian(loader->game_config)) {
-		char *filename = (char *)malloc(name.len + 6);
+		char *filename = (char *)cpymo_assetloader_alloc_temp(loader, name.len + 6);
 		if (filename == NULL) goto LOAD_WITHOUT_MASK;
 		
 		strncpy(filename, name.begin, name.len);
@@ -249,9 +312,11 @@ static error_t cpymo_assetloader_load_image_with_mask(
 			&mask, &mw, &mh, 1,
 			asset_type, cpymo_str_pure(filename), mask_ext,
 			use_pkg, pkg, loader);
-		free(filename);
+		cpymo_assetloader_free_temp(loader, filename);
 		if (err == CPYMO_ERR_SUCC) {
+			CPYMO_TRACE_BEGIN(trace);
 			error_t err = cpymo_backend_image_load_with_mask(img, pixels, mask, *w, *h, mw, mh);
+			CPYMO_TRACE_END(trace, "upload", asset_type, name, (size_t)*w * *h * 4);
 			if (err != CPYMO_ERR_SUCC) {
 				free(mask);
 				goto LOAD_WITHOUT_MASK;
@@ -260,8 +325,10 @@ static error_t cpymo_assetloader_load_image_with_mask(
 		else goto LOAD_WITHOUT_MASK;
 	}
 	else {
-	LOAD_WITHOUT_MASK:
+	LOAD_WITHOUT_MASK:;
+		CPYMO_TRACE_BEGIN(trace);
 		err = cpymo_backend_image_load(img, pixels, *w, *h, cpymo_backend_image_format_rgba);
+		CPYMO_TRACE_END(trace, "upload", asset_type, name, (size_t)*w * *h * 4);
 		if (err != CPYMO_ERR_SUCC) free(pixels);
 	}
 
@@ -317,7 +384,9 @@ error_t cpymo_assetloader_load_system_masktrans(
 	error_t err = cpymo_assetloader_load_filesystem_image_pixels(&px, &w, &h, 1, "system", name, "png", loader);
 	CPYMO_THROW(err);
 
+	CPYMO_TRACE_BEGIN(trace);
 	err = cpymo_backend_masktrans_create(out, px, w, h);
+	CPYMO_TRACE_END(trace, "upload", "masktrans", name, (size_t)w * h);
 	if (err != CPYMO_ERR_SUCC) {
 		free(px);
 		return err;
@@ -4,13 +4,17 @@
 #include "cpymo_package.h"
 #include "cpymo_gameconfig.h"
 #include "cpymo_parser.h"
+#include "cpymo_arena.h"
 #include <stddef.h>
 
 typedef struct {
-	bool use_pkg_bg, use_pkg_chara, use_pkg_se, use_pkg_voice;
-	cpymo_package pkg_bg, pkg_chara, pkg_se, pkg_voice;
+	bool use_pkg_bg, use_pkg_bgm, use_pkg_chara, use_pkg_se, use_pkg_voice;
+	cpymo_package pkg_bg, pkg_bgm, pkg_chara, pkg_se, pkg_voice;
 	const cpymo_gameconfig *game_config;
 	const char *gamedir;
+
+	// Names and paths which do not outlive a load, NULL to use malloc.
+	cpymo_arena *arena;
 } cpymo_assetloader;
 
 error_t cpymo_assetloader_init(cpymo_assetloader *out, const cpymo_gameconfig *config, const char *gamedir);
@@ -0,0 +1,69 @@
+#ifndef INCLUDE_CPYMO_ATOMIC
+#define INCLUDE_CPYMO_ATOMIC
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Acquire loads and release stores on plain variables,
+// enough for a single producer and a single consumer.
+// Increment and decrement are full read-modify-writes, safe with any number of threads.
+
+// For state which must be one per thread instead of one per process.
+#if defined(_MSC_VER)
+#define CPYMO_THREAD_LOCAL __declspec(thread)
+#else
+#define CPYMO_THREAD_LOCAL __thread
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+
+static inline size_t cpymo_atomic_size_load(const volatile size_t *p)
+{ return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+static inline void cpymo_atomic_size_store(volatile size_t *p, size_t v)
+{ __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+static inline bool cpymo_atomic_bool_load(const volatile bool *p)
+{ return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+static inline void cpymo_atomic_bool_store(volatile bool *p, bool v)
+{ __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+static inline long cpymo_atomic_long_increment(volatile long *p)
+{ return __atomic_add_fetch(p, 1, __ATOMIC_ACQ_REL); }
+
+static inline long cpymo_atomic_long_decrement(volatile long *p)
+{ return __atomic_sub_fetch(p, 1, __ATOMIC_ACQ_REL); }
+
+#elif defined(_MSC_VER)
+#include <intrin.h>
+
+#if defined(_M_ARM) || defined(_M_ARM64)
+#define CPYMO_ATOMIC_FENCE() __dmb(0xB)
+#else
+#define CPYMO_ATOMIC_FENCE() _ReadWriteBarrier()
+#endif
+
+static inline size_t cpymo_atomic_size_load(const volatile size_t *p)
+{ size_t v = *p; CPYMO_ATOMIC_FENCE(); return v; }
+
+static inline void cpymo_atomic_size_store(volatile size_t *p, size_t v)
+{ CPYMO_ATOMIC_FENCE(); *p = v; }
+
+static inline bool cpymo_atomic_bool_load(const volatile bool *p)
+{ bool v = *p; CPYMO_ATOMIC_FENCE(); return v; }
+
+static inline void cpymo_atomic_bool_store(volatile bool *p, bool v)
+{ CPYMO_ATOMIC_FENCE(); *p = v; }
+
+static inline long cpymo_atomic_long_increment(volatile long *p)
+{ return _InterlockedIncrement(p); }
+
+static inline long cpymo_atomic_long_decrement(volatile long *p)
+{ return _InterlockedDecrement(p); }
+
+#else
+#error "cpymo_atomic.h: unsupported compiler."
+#endif
+
+#endif
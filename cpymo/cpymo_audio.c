@@ -3,6 +3,9 @@
 #include <assert.h>
 #include "../cpymo-backends/include/cpymo_backend_audio.h"
 #include "cpymo_engine.h"
+#include "cpymo_atomic.h"
+#include "cpymo_trace.h"
+#include "../stb/stb_ds.h"
 
 #ifdef __CXX
 #undef av_err2str
@@ -10,41 +13,211 @@
 #endif
 
 #ifndef DISABLE_FFMPEG_AUDIO
+
+// Every track is read through one AVIO adapter with this buffer,
+// a few reads per second of audio keep small file reads off slow SD cards.
+#ifndef CPYMO_AUDIO_AVIO_BUFFER_SIZE
+#define CPYMO_AUDIO_AVIO_BUFFER_SIZE (64 * 1024)
+#endif
+
+#ifndef CPYMO_AUDIO_RING_MS
+#define CPYMO_AUDIO_RING_MS 500
+#endif
+
+// SE clips not longer than this are decoded once and kept in memory.
+#ifndef CPYMO_AUDIO_SE_CACHE_MAX_MS
+#define CPYMO_AUDIO_SE_CACHE_MAX_MS 3000
+#endif
+
+// Bytes of decoded SE kept in memory, 0 to disable the cache.
+#ifndef CPYMO_AUDIO_SE_CACHE_BUDGET
+#define CPYMO_AUDIO_SE_CACHE_BUDGET (4 * 1024 * 1024)
+#endif
+
+// Head of a looping track kept decoded, tracks not longer are looped from memory only.
+#ifndef CPYMO_AUDIO_LOOP_HEAD_MS
+#define CPYMO_AUDIO_LOOP_HEAD_MS 3000
+#endif
+
+#ifndef CPYMO_AUDIO_TELEMETRY_WINDOW
+#define CPYMO_AUDIO_TELEMETRY_WINDOW 10.0f
+#endif
+
+// Head of a prepared voice decoded before its #vo.
+#ifndef CPYMO_AUDIO_VO_PREPARE_MS
+#define CPYMO_AUDIO_VO_PREPARE_MS 300
+#endif
+
+// Keyed by SE name, NULL value means the clip is always streamed.
+typedef struct {
+	char *key;
+	cpymo_audio_pcm *value;
+} cpymo_audio_se_cache_entry;
+
 static inline void cpymo_audio_channel_init(cpymo_audio_channel *c)
 {
-	c->enabled = false;
-	c->loop = false;
 	c->format_context = NULL;
-	c->codec_context = NULL;
-	c->swr_context = NULL;
+	c->converted_buf_size = 0;
 	c->converted_frame_current_offset = 0;
 	c->io_context = NULL;
+	c->pcm = NULL;
+	c->pcm_offset = 0;
+	c->loop_skip = 0;
+	c->loop_resident = false;
+	c->loop_capturing = false;
+	c->loop_whole = false;
 }
 
+// Closes the track, codec, resampler and I/O buffer stay for the next track.
 static void cpymo_audio_channel_reset_unsafe(cpymo_audio_channel *c)
 {
-	if (c->swr_context) swr_free(&c->swr_context);
-	if (c->codec_context) avcodec_free_context(&c->codec_context);
 	if (c->format_context) avformat_close_input(&c->format_context);
 	if (c->io_context) {
+		// FFmpeg may have replaced the buffer while probing.
 		void *buf = c->io_context->buffer;
+		const int buf_size = c->io_context->buffer_size;
 		avio_context_free(&c->io_context);
-		if (buf) av_free(buf);
+
+		if (buf && buf_size == CPYMO_AUDIO_AVIO_BUFFER_SIZE && c->io_buffer == NULL) 
+			c->io_buffer = buf;
+		else if (buf) av_free(buf);
+
 		cpymo_package_stream_reader_close(&c->package_reader);
 	}
 
 	cpymo_audio_channel_init(c);
 }
 
-static void cpymo_audio_channel_reset(cpymo_audio_channel *c)
+static void cpymo_audio_channel_free_decoder(cpymo_audio_channel *c)
 {
-	if (c->enabled) {
-		cpymo_backend_audio_lock();
-		c->enabled = false;
-		cpymo_backend_audio_unlock();
+	if (c->swr_context) swr_free(&c->swr_context);
+	if (c->codec_context) avcodec_free_context(&c->codec_context);
+	if (c->codec_parameters) avcodec_parameters_free(&c->codec_parameters);
+}
 
-		cpymo_audio_channel_reset_unsafe(c);
-	}
+static void cpymo_audio_channel_free_pool(cpymo_audio_channel *c)
+{
+	cpymo_audio_channel_free_decoder(c);
+	if (c->io_buffer) av_free(c->io_buffer);
+	if (c->loop_head) free(c->loop_head);
+	c->io_buffer = NULL;
+	c->loop_head = NULL;
+	c->loop_head_capacity = 0;
+}
+
+// Sets up a detached channel, the ring is allocated by caller.
+static void cpymo_audio_channel_create(cpymo_audio_channel *c, size_t ring_size)
+{
+	cpymo_audio_channel_init(c);
+	c->enabled = false;
+	c->loop = false;
+	c->codec_context = NULL;
+	c->swr_context = NULL;
+	c->codec_parameters = NULL;
+	c->io_buffer = NULL;
+	c->packet = NULL;
+	c->frame = NULL;
+	c->converted_buf = NULL;
+	c->converted_buf_all_size = 0;
+	c->loop_head = NULL;
+	c->loop_head_capacity = 0;
+	c->volume = 0;
+
+	c->ring_size = ring_size;
+	c->ring_read = 0;
+	c->ring_write = 0;
+	c->ring_pending = 0;
+	c->decoding = false;
+	c->ring_primed = false;
+	c->underruns = 0;
+	c->ring_fill_lowest = 0;
+	c->ring = NULL;
+}
+
+static void cpymo_audio_channel_destroy(cpymo_audio_channel *c)
+{
+	cpymo_audio_channel_reset_unsafe(c);
+	cpymo_audio_channel_free_pool(c);
+
+	if (c->packet) av_packet_free(&c->packet);
+	if (c->frame) av_frame_free(&c->frame);
+	if (c->converted_buf) free(c->converted_buf);
+	if (c->ring) free(c->ring);
+	c->converted_buf = NULL;
+	c->ring = NULL;
+}
+
+// Stops c and moves its track and decoder into out, 
+// so they are closed or reopened without holding any lock.
+// c keeps its ring and volume, and must get the decoder back by cpymo_audio_channel_attach.
+static void cpymo_audio_channel_detach(cpymo_audio_channel *c, cpymo_audio_channel *out)
+{
+	cpymo_backend_audio_decoder_lock();
+	cpymo_backend_audio_lock();
+
+	c->enabled = false;
+	c->decoding = false;
+	c->ring_read = 0;
+	c->ring_write = 0;
+	c->ring_pending = 0;
+
+	*out = *c;
+	out->ring = NULL;
+	if (out->io_context) out->io_context->opaque = &out->package_reader;
+
+	cpymo_audio_channel_init(c);
+	c->loop = false;
+	c->codec_context = NULL;
+	c->swr_context = NULL;
+	c->codec_parameters = NULL;
+	c->io_buffer = NULL;
+	c->packet = NULL;
+	c->frame = NULL;
+	c->converted_buf = NULL;
+	c->converted_buf_all_size = 0;
+	c->loop_head = NULL;
+	c->loop_head_capacity = 0;
+
+	cpymo_backend_audio_unlock();
+	cpymo_backend_audio_decoder_unlock();
+}
+
+// Moves the decoder back from d, and starts playing it if start.
+static void cpymo_audio_channel_attach(cpymo_audio_channel *c, cpymo_audio_channel *d, bool start)
+{
+	cpymo_backend_audio_decoder_lock();
+	cpymo_backend_audio_lock();
+
+	uint8_t *ring = c->ring;
+	const float volume = c->volume;
+
+	*c = *d;
+	c->ring = ring;
+	c->volume = volume;
+	if (c->io_context) c->io_context->opaque = &c->package_reader;
+
+	c->ring_read = 0;
+	c->ring_write = 0;
+	c->ring_pending = 0;
+	c->ring_primed = false;
+	c->underruns = 0;
+	c->ring_fill_lowest = c->ring_size;
+	c->decoding = start;
+	c->enabled = start;
+	if (!start) c->loop = false;
+
+	cpymo_backend_audio_unlock();
+	cpymo_backend_audio_decoder_unlock();
+
+	if (start) cpymo_backend_audio_decoder_wake();
+}
+
+static void cpymo_audio_channel_reset(cpymo_audio_channel *c)
+{
+	cpymo_audio_channel d;
+	cpymo_audio_channel_detach(c, &d);
+	cpymo_audio_channel_reset_unsafe(&d);
+	cpymo_audio_channel_attach(c, &d, false);
 }
 
 static enum AVSampleFormat cpymo_audio_fmt2ffmpeg(
@@ -189,7 +362,7 @@ static error_t cpymo_audio_channel_next_frame(cpymo_audio_channel *c)
 			goto RETRY;
 		}
 		else if (result == AVERROR_EOF) {
-			if (c->loop) {
+			if (c->loop && !c->loop_resident) {
 				cpymo_audio_channel_seek_to_head(c);
 			}
 			else {
@@ -217,70 +390,376 @@ static error_t cpymo_audio_channel_next_frame(cpymo_audio_channel *c)
 	}
 }}
 
-static void cpymo_audio_mix_samples(
-	void *dst_, 
-	const void *src_,
-	size_t len, 
-	cpymo_backend_audio_format fmt,
-	float volume)
-{
-
-#define MIX_SIGNED(TYPE, TYPE_MAX_VAL) { \
-	TYPE *dst = (TYPE *)dst_; \
-	const TYPE *src = (TYPE *)src_; \
-	len /= sizeof(TYPE); \
-	\
-	for (size_t i = 0; i < len; ++i) { \
-		double src_sample = (float)src[i] / (float)TYPE_MAX_VAL; \
-		double dst_sample = (float)dst[i] / (float)TYPE_MAX_VAL; \
-		src_sample *= volume * 1.0f; \
-		dst_sample += src_sample; \
-		\
-		if (dst_sample > 1) dst_sample = 1; \
-		if (dst_sample < -1) dst_sample = -1; \
-		\
-		dst[i] = (TYPE)(dst_sample * TYPE_MAX_VAL); \
-	}\
+#if !defined DISABLE_AUDIO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPYMO_AUDIO_MIX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define CPYMO_AUDIO_MIX_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+// Gain in Q15, so 16-bit samples can be scaled by vqdmulh or mulhi/mullo.
+#define CPYMO_AUDIO_GAIN_ONE 32767
+
+static inline int32_t cpymo_audio_gain_q15(float volume)
+{
+	if (volume <= 0) return 0;
+	if (volume >= 1) return CPYMO_AUDIO_GAIN_ONE;
+	return (int32_t)(volume * CPYMO_AUDIO_GAIN_ONE + 0.5f);
+}
+
+// Every kernel mixes all sources in one pass over dst,
+// SIMD and scalar paths give the same result.
+static void cpymo_audio_mix_s16(
+	int16_t *dst, 
+	const int16_t *const *src, 
+	const float *volume, 
+	size_t src_count, 
+	size_t samples)
+{
+	int32_t gain[CPYMO_AUDIO_MAX_CHANNELS];
+	for (size_t k = 0; k < src_count; ++k)
+		gain[k] = cpymo_audio_gain_q15(volume[k]);
+
+	size_t i = 0;
+
+#if defined CPYMO_AUDIO_MIX_SSE2
+	for (; i + 8 <= samples; i += 8) {
+		__m128i acc = _mm_setzero_si128();
+		for (size_t k = 0; k < src_count; ++k) {
+			const __m128i g = _mm_set1_epi16((int16_t)gain[k]);
+			const __m128i x = _mm_loadu_si128((const __m128i *)(src[k] + i));
+			const __m128i lo = _mm_mullo_epi16(x, g);
+			const __m128i hi = _mm_mulhi_epi16(x, g);
+			const __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+			const __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+			acc = _mm_adds_epi16(acc, _mm_packs_epi32(p0, p1));
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), acc);
+	}
+#elif defined CPYMO_AUDIO_MIX_NEON
+	for (; i + 8 <= samples; i += 8) {
+		int16x8_t acc = vdupq_n_s16(0);
+		for (size_t k = 0; k < src_count; ++k) {
+			const int16x8_t x = vld1q_s16(src[k] + i);
+			acc = vqaddq_s16(acc, vqdmulhq_n_s16(x, (int16_t)gain[k]));
+		}
+		vst1q_s16(dst + i, acc);
+	}
+#endif
+
+	for (; i < samples; ++i) {
+		int32_t acc = 0;
+		for (size_t k = 0; k < src_count; ++k) {
+			acc += ((int32_t)src[k][i] * gain[k]) >> 15;
+			if (acc > INT16_MAX) acc = INT16_MAX;
+			if (acc < INT16_MIN) acc = INT16_MIN;
+		}
+		dst[i] = (int16_t)acc;
+	}
+}
+
+static void cpymo_audio_mix_s32(
+	int32_t *dst, 
+	const int32_t *const *src, 
+	const float *volume, 
+	size_t src_count, 
+	size_t samples)
+{
+	int32_t gain[CPYMO_AUDIO_MAX_CHANNELS];
+	for (size_t k = 0; k < src_count; ++k)
+		gain[k] = cpymo_audio_gain_q15(volume[k]);
+
+	size_t i = 0;
+
+#if defined CPYMO_AUDIO_MIX_SSE2
+	// No 32x32 signed multiply in SSE2, so x * g is built from 16-bit halves:
+	// (x * g) >> 15 == ((x >> 16) * g << 1) + ((x & 0xFFFF) * g >> 15).
+	// Both terms fit 32 bits since g < 2^15. Saturating add is emulated.
+	const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+	const __m128i max = _mm_set1_epi32(INT32_MAX);
+	for (; i + 4 <= samples; i += 4) {
+		__m128i acc = _mm_setzero_si128();
+		for (size_t k = 0; k < src_count; ++k) {
+			const __m128i g = _mm_set1_epi16((int16_t)gain[k]);
+			const __m128i x = _mm_loadu_si128((const __m128i *)(src[k] + i));
+			const __m128i lo = _mm_mullo_epi16(x, g);
+			const __m128i low_part = _mm_or_si128(
+				_mm_and_si128(lo, low_mask), 
+				_mm_slli_epi32(_mm_mulhi_epu16(x, g), 16));
+			const __m128i high_part = _mm_or_si128(
+				_mm_srli_epi32(lo, 16), 
+				_mm_andnot_si128(low_mask, _mm_mulhi_epi16(x, g)));
+			const __m128i t = _mm_add_epi32(
+				_mm_slli_epi32(high_part, 1), _mm_srli_epi32(low_part, 15));
+
+			const __m128i sum = _mm_add_epi32(acc, t);
+			const __m128i overflow = _mm_srai_epi32(_mm_andnot_si128(
+				_mm_xor_si128(acc, t), _mm_xor_si128(acc, sum)), 31);
+			const __m128i saturated = _mm_xor_si128(_mm_srai_epi32(acc, 31), max);
+			acc = _mm_or_si128(
+				_mm_and_si128(overflow, saturated), 
+				_mm_andnot_si128(overflow, sum));
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), acc);
+	}
+#elif defined CPYMO_AUDIO_MIX_NEON
+	for (; i + 4 <= samples; i += 4) {
+		int32x4_t acc = vdupq_n_s32(0);
+		for (size_t k = 0; k < src_count; ++k) {
+			const int32x4_t x = vld1q_s32(src[k] + i);
+			const int32x2_t lo = vmovn_s64(
+				vshrq_n_s64(vmull_n_s32(vget_low_s32(x), gain[k]), 15));
+			const int32x2_t hi = vmovn_s64(
+				vshrq_n_s64(vmull_n_s32(vget_high_s32(x), gain[k]), 15));
+			acc = vqaddq_s32(acc, vcombine_s32(lo, hi));
+		}
+		vst1q_s32(dst + i, acc);
+	}
+#endif
+
+	for (; i < samples; ++i) {
+		int64_t acc = 0;
+		for (size_t k = 0; k < src_count; ++k) {
+			acc += ((int64_t)src[k][i] * gain[k]) >> 15;
+			if (acc > INT32_MAX) acc = INT32_MAX;
+			if (acc < INT32_MIN) acc = INT32_MIN;
+		}
+		dst[i] = (int32_t)acc;
+	}
+}
+
+static void cpymo_audio_mix_f32(
+	float *dst, 
+	const float *const *src, 
+	const float *volume, 
+	size_t src_count, 
+	size_t samples)
+{
+	size_t i = 0;
+
+#if defined CPYMO_AUDIO_MIX_SSE2
+	const __m128 one = _mm_set1_ps(1.0f), minus_one = _mm_set1_ps(-1.0f);
+	for (; i + 4 <= samples; i += 4) {
+		__m128 acc = _mm_setzero_ps();
+		for (size_t k = 0; k < src_count; ++k) {
+			const __m128 x = _mm_loadu_ps(src[k] + i);
+			acc = _mm_add_ps(acc, _mm_mul_ps(x, _mm_set1_ps(volume[k])));
+		}
+		_mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(acc, minus_one), one));
+	}
+#elif defined CPYMO_AUDIO_MIX_NEON
+	for (; i + 4 <= samples; i += 4) {
+		float32x4_t acc = vdupq_n_f32(0);
+		for (size_t k = 0; k < src_count; ++k) {
+			const float32x4_t x = vld1q_f32(src[k] + i);
+			acc = vaddq_f32(acc, vmulq_n_f32(x, volume[k]));
+		}
+		acc = vminq_f32(vmaxq_f32(acc, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+		vst1q_f32(dst + i, acc);
+	}
+#endif
+
+	for (; i < samples; ++i) {
+		float acc = 0;
+		for (size_t k = 0; k < src_count; ++k)
+			acc += src[k][i] * volume[k];
+
+		if (acc > 1.0f) acc = 1.0f;
+		if (acc < -1.0f) acc = -1.0f;
+		dst[i] = acc;
+	}
 }
 
+static void cpymo_audio_mix(
+	void *dst, 
+	const void *const *src, 
+	const float *volume, 
+	size_t src_count, 
+	size_t len, 
+	cpymo_backend_audio_format fmt)
+{
 	switch (fmt) {
-	case cpymo_backend_audio_s16: MIX_SIGNED(int16_t, INT16_MAX); break;
-	case cpymo_backend_audio_s32: MIX_SIGNED(int32_t, INT32_MAX); break;
-	case cpymo_backend_audio_f32: MIX_SIGNED(float, 1.0f); break;
+	case cpymo_backend_audio_s16:
+		cpymo_audio_mix_s16(
+			(int16_t *)dst, (const int16_t *const *)src, 
+			volume, src_count, len / sizeof(int16_t));
+		break;
+	case cpymo_backend_audio_s32:
+		cpymo_audio_mix_s32(
+			(int32_t *)dst, (const int32_t *const *)src, 
+			volume, src_count, len / sizeof(int32_t));
+		break;
+	case cpymo_backend_audio_f32:
+		cpymo_audio_mix_f32(
+			(float *)dst, (const float *const *)src, 
+			volume, src_count, len / sizeof(float));
+		break;
 	}
 }
 
-static void cpymo_audio_channel_mix_samples(uint8_t *dst, size_t len, cpymo_audio_channel *c)
+// Called from the audio callback, returns bytes readable from the ring without wrapping.
+static size_t cpymo_audio_channel_peek(cpymo_audio_channel *c, uint8_t **samples)
 {
-	const cpymo_backend_audio_info *info = cpymo_backend_audio_get_info();
+	// read decoding first, so no samples are written after it.
+	const bool decoding = cpymo_atomic_bool_load(&c->decoding);
+	const size_t read = c->ring_read;
+	const size_t fill = cpymo_atomic_size_load(&c->ring_write) - read;
+
+	if (fill > 0) c->ring_primed = true;
+	if (c->ring_primed && fill < c->ring_fill_lowest) c->ring_fill_lowest = fill;
+	if (decoding && fill < c->ring_size / 2) cpymo_backend_audio_decoder_wake();
+
+	if (fill == 0) {
+		if (!decoding) c->enabled = false;
+		return 0;
+	}
 
-	while (len > 0) {
-		uint8_t *src = c->converted_buf + c->converted_frame_current_offset;
-		size_t src_size = c->converted_buf_size - c->converted_frame_current_offset;
+	const size_t offset = read % c->ring_size;
+	size_t size = c->ring_size - offset;
+	if (size > fill) size = fill;
+
+	*samples = c->ring + offset;
+	return size;
+}
+
+static inline void cpymo_audio_channel_consume(cpymo_audio_channel *c, size_t size)
+{
+	cpymo_atomic_size_store(&c->ring_read, c->ring_read + size);
+}
+
+static void cpymo_audio_channel_loop_capture(
+	cpymo_audio_channel *c, const uint8_t *src, size_t size)
+{
+	cpymo_audio_pcm *head = c->loop_head;
+	size_t n = c->loop_head_capacity - head->size;
+	if (n > size) n = size;
+
+	memcpy(head->samples + head->size, src, n);
+	head->size += n;
+	if (head->size == c->loop_head_capacity) c->loop_capturing = false;
+}
+
+// Reached the end of a looping track, replays its head from memory.
+static error_t cpymo_audio_channel_loop_rewind(cpymo_audio_channel *c)
+{
+	// whole track captured, the file is never read again.
+	if (c->loop_capturing) {
+		c->loop_capturing = false;
+		c->loop_whole = true;
+	}
+
+	if (c->loop_head->size == 0) return CPYMO_ERR_NO_MORE_CONTENT;
+
+	c->pcm = c->loop_head;
+	c->pcm_offset = 0;
+	if (c->loop_whole) return CPYMO_ERR_SUCC;
+
+	cpymo_audio_channel_seek_to_head(c);
+	avcodec_flush_buffers(c->codec_context);
+	swr_close(c->swr_context);
+	if (swr_init(c->swr_context) < 0) return CPYMO_ERR_UNKNOWN;
 
-		if (src_size == 0) {
+	c->converted_buf_size = 0;
+	c->converted_frame_current_offset = 0;
+	c->loop_skip = c->loop_head->size;
+	return CPYMO_ERR_SUCC;
+}
+
+// Decodes and drops what the replayed loop head already covers.
+static error_t cpymo_audio_channel_loop_skip(cpymo_audio_channel *c)
+{
+	while (c->loop_skip) {
+		if (c->converted_frame_current_offset == c->converted_buf_size) {
 			error_t err = cpymo_audio_channel_next_frame(c);
-			if (err == CPYMO_ERR_SUCC) 
+			CPYMO_THROW(err);
+			continue;
+		}
+
+		size_t size = c->converted_buf_size - c->converted_frame_current_offset;
+		if (size > c->loop_skip) size = c->loop_skip;
+		c->converted_frame_current_offset += size;
+		c->loop_skip -= size;
+	}
+
+	return CPYMO_ERR_SUCC;
+}
+
+// Runs with decoder lock held, stops when limit bytes are in the ring.
+static void cpymo_audio_channel_decode(cpymo_audio_channel *c, size_t limit)
+{
+	while (c->decoding) {
+		const size_t write = c->ring_write;
+		const size_t fill = write - cpymo_atomic_size_load(&c->ring_read);
+		if (fill >= limit) {
+			// ring is full, catch up the decoder behind a replayed loop head.
+			if (c->loop_skip && cpymo_audio_channel_loop_skip(c) != CPYMO_ERR_SUCC) {
+				cpymo_audio_channel_reset_unsafe(c);
+				cpymo_atomic_bool_store(&c->decoding, false);
+			}
+			return;
+		}
+		const size_t free_size = limit - fill;
+
+		if (c->pcm) {
+			if (c->pcm_offset == c->pcm->size) {
+				if (c->loop_resident && !c->loop_whole) {
+					// loop head replayed, go on with the decoder.
+					if (cpymo_audio_channel_loop_skip(c) != CPYMO_ERR_SUCC) {
+						cpymo_audio_channel_reset_unsafe(c);
+						cpymo_atomic_bool_store(&c->decoding, false);
+					}
+					c->pcm = NULL;
+				}
+				else if (c->loop && c->pcm->size) c->pcm_offset = 0;
+				else cpymo_atomic_bool_store(&c->decoding, false);
 				continue;
-			else
-				goto FILL_BLANK_AND_RESET;
+			}
 		}
-		else {
-			size_t write_size = src_size;
-			if (write_size > len) write_size = len;
+		else if (c->converted_frame_current_offset == c->converted_buf_size) {
+			error_t err = cpymo_audio_channel_next_frame(c);
+			if (err == CPYMO_ERR_NO_MORE_CONTENT && c->loop_resident)
+				err = cpymo_audio_channel_loop_rewind(c);
 
-			cpymo_audio_mix_samples(dst, src, write_size, info->format, c->volume);
-			c->converted_frame_current_offset += write_size;
-			dst += write_size;
-			len -= write_size;
+			if (err != CPYMO_ERR_SUCC) {
+				cpymo_audio_channel_reset_unsafe(c);
+				cpymo_atomic_bool_store(&c->decoding, false);
+			}
+			continue;
 		}
-	}
 
-	return;
+		const uint8_t *src = c->pcm ?
+			c->pcm->samples + c->pcm_offset :
+			c->converted_buf + c->converted_frame_current_offset;
+		const size_t src_size = c->pcm ?
+			c->pcm->size - c->pcm_offset :
+			c->converted_buf_size - c->converted_frame_current_offset;
+
+		const size_t offset = write % c->ring_size;
+		size_t size = c->ring_size - offset;
+		if (size > free_size) size = free_size;
+		if (size > src_size) size = src_size;
+
+		memcpy(c->ring + offset, src, size);
+		if (c->loop_capturing && c->pcm == NULL) cpymo_audio_channel_loop_capture(c, src, size);
+		if (c->pcm) c->pcm_offset += size;
+		else c->converted_frame_current_offset += size;
+		cpymo_atomic_size_store(&c->ring_write, write + size);
+	}
+}
 
-FILL_BLANK_AND_RESET:
-	cpymo_audio_channel_reset_unsafe(c);
-	return;
+void cpymo_audio_decode(cpymo_audio_system *s)
+{
+	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i) {
+		cpymo_backend_audio_decoder_lock();
+		if (s->enabled) {
+			cpymo_audio_channel *c = s->channels + i;
+			cpymo_audio_channel_decode(c, c->ring_size);
+		}
+		cpymo_backend_audio_decoder_unlock();
+	}
 }
 
 int cpymo_audio_packaged_audio_ffmpeg_read_packet(void *opaque, uint8_t *buf, int buf_size)
@@ -295,260 +774,805 @@ int64_t cpymo_audio_packaged_audio_ffmpeg_seek(void *opaque, int64_t offset, int
 {
 	cpymo_package_stream_reader *r = (cpymo_package_stream_reader *)opaque;
 
-	switch (whence) {
+	switch (whence & ~AVSEEK_FORCE) {
 	case AVSEEK_SIZE:
 		return (int64_t)r->file_length;
 	case SEEK_SET:
-		if (cpymo_package_stream_reader_seek((size_t)offset, r) == CPYMO_ERR_SUCC)
-			return 0;
-		else return AVERROR_EOF;
+		break;
+	case SEEK_CUR:
+		offset += (int64_t)r->current;
+		break;
+	case SEEK_END:
+		offset += (int64_t)r->file_length;
+		break;
 	default:
-		assert(false);
-		return -1;
+		return AVERROR(EINVAL);
 	};
+
+	if (offset < 0) return AVERROR(EINVAL);
+	if (cpymo_package_stream_reader_seek((size_t)offset, r) != CPYMO_ERR_SUCC)
+		return AVERROR_EOF;
+
+	return offset;
+}
+
+static bool cpymo_audio_codec_parameters_match(
+	const AVCodecParameters *a, const AVCodecParameters *b)
+{
+	return a->codec_id == b->codec_id
+		&& a->format == b->format
+		&& a->sample_rate == b->sample_rate
+		&& a->channels == b->channels
+		&& a->channel_layout == b->channel_layout
+		&& a->bits_per_coded_sample == b->bits_per_coded_sample
+		&& a->block_align == b->block_align
+		&& a->extradata_size == b->extradata_size
+		&& (a->extradata_size == 0 
+			|| memcmp(a->extradata, b->extradata, (size_t)a->extradata_size) == 0);
 }
 
+// Reuses codec and resampler of the last track if the stream has the same parameters.
+static error_t cpymo_audio_channel_open_decoder(
+	cpymo_audio_channel *c, 
+	const AVCodec *codec, 
+	const AVStream *stream, 
+	const cpymo_backend_audio_info *info)
+{
+	if (c->codec_context && c->codec_parameters
+		&& cpymo_audio_codec_parameters_match(c->codec_parameters, stream->codecpar)) {
+		avcodec_flush_buffers(c->codec_context);
+		c->codec_context->pkt_timebase = stream->time_base;
+
+		swr_close(c->swr_context);
+		if (swr_init(c->swr_context) >= 0) 
+			return CPYMO_ERR_SUCC;
+	}
+
+	cpymo_audio_channel_free_decoder(c);
+
+	c->codec_context = avcodec_alloc_context3(codec);
+	if (c->codec_context == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+	avcodec_parameters_to_context(c->codec_context, stream->codecpar);
+	c->codec_context->pkt_timebase = stream->time_base;
+
+	int result = avcodec_open2(c->codec_context, codec, NULL);
+	if (result != 0) {
+		cpymo_audio_channel_free_decoder(c);
+		return CPYMO_ERR_UNSUPPORTED;
+	}
+
+	c->swr_context = swr_alloc_set_opts(
+		NULL,
+		av_get_default_channel_layout((int)info->channels),
+		cpymo_audio_fmt2ffmpeg(info->format),
+		(int)info->freq,
+		stream->codecpar->channels == 1 ?
+			AV_CH_LAYOUT_MONO :
+			(stream->codecpar->channel_layout == 0 ?
+				av_get_default_channel_layout(stream->codecpar->channels) :
+				stream->codecpar->channel_layout),
+		(enum AVSampleFormat)stream->codecpar->format,
+		stream->codecpar->sample_rate,
+		0, NULL);
+	if (c->swr_context == NULL) {
+		cpymo_audio_channel_free_decoder(c);
+		return CPYMO_ERR_UNKNOWN;
+	}
+
+	result = swr_init(c->swr_context);
+	if (result < 0) {
+		cpymo_audio_channel_free_decoder(c);
+		return CPYMO_ERR_UNKNOWN;
+	}
+
+	// Without a copy of parameters this decoder is simply not reused.
+	c->codec_parameters = avcodec_parameters_alloc();
+	if (c->codec_parameters 
+		&& avcodec_parameters_copy(c->codec_parameters, stream->codecpar) < 0)
+		avcodec_parameters_free(&c->codec_parameters);
+
+	return CPYMO_ERR_SUCC;
+}
+
+static bool cpymo_audio_channel_alloc_loop_head(
+	cpymo_audio_channel *c, const cpymo_backend_audio_info *info)
+{
+	if (c->loop_head) return true;
+
+	const size_t capacity =
+		info->freq * CPYMO_AUDIO_LOOP_HEAD_MS / 1000
+		* info->channels
+		* (size_t)av_get_bytes_per_sample(cpymo_audio_fmt2ffmpeg(info->format));
+
+	c->loop_head = (cpymo_audio_pcm *)malloc(sizeof(cpymo_audio_pcm) + capacity);
+	if (c->loop_head == NULL) return false;
+
+	c->loop_head->size = 0;
+	c->loop_head->last_used = 0;
+	c->loop_head->samples = (uint8_t *)(c->loop_head + 1);
+	c->loop_head_capacity = capacity;
+	return true;
+}
+
+// Opens into a detached channel, returns CPYMO_ERR_NO_MORE_CONTENT for an empty file.
+// Takes reader, it is closed on failure.
+// Any byte source a reader can hold plays the same way: 
+// a file, a range of a package, or a buffer in memory.
+static error_t cpymo_audio_channel_open(
+	cpymo_audio_channel *c, 
+	const cpymo_package_stream_reader *reader, 
+	bool loop,
+	const cpymo_backend_audio_info *info)
+{
+	assert(c->enabled == false);
+	
+	assert(c->io_context == NULL);
+
+	assert(c->format_context == NULL);
+
+	c->package_reader = *reader;
+
+	void *io_buffer = c->io_buffer;
+	c->io_buffer = NULL;
+	if (io_buffer == NULL) io_buffer = av_malloc(CPYMO_AUDIO_AVIO_BUFFER_SIZE);
+	if (io_buffer == NULL) {
+		cpymo_package_stream_reader_close(&c->package_reader);
+		cpymo_audio_channel_reset_unsafe(c);
+		return CPYMO_ERR_OUT_OF_MEM;
+	}
+
+	c->io_context = avio_alloc_context(
+		(unsigned char *)io_buffer, CPYMO_AUDIO_AVIO_BUFFER_SIZE, 0, &c->package_reader,
+		&cpymo_audio_packaged_audio_ffmpeg_read_packet,
+		NULL,
+		&cpymo_audio_packaged_audio_ffmpeg_seek);
+
+	if (c->io_context == NULL) {
+		av_free(io_buffer);
+		cpymo_package_stream_reader_close(&c->package_reader);
+		cpymo_audio_channel_reset_unsafe(c);
+		printf("[Error] avio_alloc_context failed.\n");
+		return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+	}
+
+	c->format_context = avformat_alloc_context();
+	if (c->format_context == NULL) {
+		cpymo_audio_channel_reset_unsafe(c);
+		return CPYMO_ERR_OUT_OF_MEM;
+	}
+
+	c->format_context->pb = c->io_context;
+	c->format_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+	int result = avformat_open_input(&c->format_context, "", NULL, NULL);
+
+	const char *filename = "audio stream";
+
+	if (result != 0) {
+		printf("[Error] Can not open %s with error ffmpeg error %s.\n",
+			filename,
+			av_err2str(result));
+
+		cpymo_audio_channel_reset_unsafe(c);
+		return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+	}
+
+	result = avformat_find_stream_info(c->format_context, NULL);
+	if (result != 0) {
+		cpymo_audio_channel_reset_unsafe(c);
+		printf("[Error] Can not get stream info from %s.\n", filename);
+		return CPYMO_ERR_BAD_FILE_FORMAT;
+	}
+
+	
+	c->stream_id = av_find_best_stream(
+		c->format_context, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+	if (result != 0) {
+		cpymo_audio_channel_reset_unsafe(c);
+		printf("[Error] Can not find best stream from %s.\n", filename);
+		return CPYMO_ERR_BAD_FILE_FORMAT;
+	}
+
+	error_t err;
+	AVStream *stream = c->format_context->streams[c->stream_id];
+	const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+	if (codec == NULL) {
+		cpymo_audio_channel_reset_unsafe(c);
+		printf("[Error] Can not find codec.\n");
+		return CPYMO_ERR_NOT_FOUND;
+	}
+	err = cpymo_audio_channel_open_decoder(c, codec, stream, info);
+	if (err != CPYMO_ERR_SUCC) {
+		cpymo_audio_channel_reset_unsafe(c);
+		return err;
+	}
+
+	if (c->packet == NULL) {
+		c->packet = av_packet_alloc();
+		if (c->packet == NULL) {
+			cpymo_audio_channel_reset_unsafe(c);
+			return CPYMO_ERR_OUT_OF_MEM;
+		}
+	}
+
+	if (c->frame == NULL) {
+		c->frame = av_frame_alloc();
+		if (c->frame == NULL) {
+			cpymo_audio_channel_reset_unsafe(c);
+			return CPYMO_ERR_OUT_OF_MEM;
+		}
+	}
+
+	c->loop = loop;
+	c->converted_frame_current_offset = 0;
+	c->loop_resident = loop && cpymo_audio_channel_alloc_loop_head(c, info);
+	c->loop_capturing = c->loop_resident;
+	if (c->loop_resident) c->loop_head->size = 0;
+
+	// read first frame
+	if (cpymo_audio_channel_next_frame(c) != CPYMO_ERR_SUCC) {
+		cpymo_audio_channel_reset_unsafe(c);
+		return CPYMO_ERR_NO_MORE_CONTENT;
+	}
+
+	return CPYMO_ERR_SUCC;
+}
+
+// Takes reader, d has been detached from c and reset.
+static error_t cpymo_audio_channel_play_detached(
+	cpymo_audio_channel *c,
+	cpymo_audio_channel *d,
+	const cpymo_package_stream_reader *reader,
+	bool loop,
+	const cpymo_backend_audio_info *info)
+{
+	error_t err = cpymo_audio_channel_open(d, reader, loop, info);
+	cpymo_audio_channel_attach(c, d, err == CPYMO_ERR_SUCC);
+
+	if (err == CPYMO_ERR_NO_MORE_CONTENT) return CPYMO_ERR_SUCC;
+	return err;
+}
+
+// Takes reader.
 static error_t cpymo_audio_channel_play_file(
 	cpymo_audio_channel *c, 
-	const char * filename, const cpymo_package_stream_reader *package_reader, 
+	const cpymo_package_stream_reader *reader, 
 	bool loop)
 {
 	const cpymo_backend_audio_info *info = 
 		cpymo_backend_audio_get_info();
-	if (info == NULL) return CPYMO_ERR_SUCC;
+	if (info == NULL) {
+		cpymo_package_stream_reader r = *reader;
+		cpymo_package_stream_reader_close(&r);
+		return CPYMO_ERR_SUCC;
+	}
 
-	if (filename) { assert(package_reader == NULL); }
-	if (package_reader) { assert(filename == NULL); }
-	assert(!(filename == NULL && package_reader == NULL));
+	// close and open outside of locks, other channels keep decoding.
+	cpymo_audio_channel d;
+	cpymo_audio_channel_detach(c, &d);
+	cpymo_audio_channel_reset_unsafe(&d);
 
-	cpymo_audio_channel_reset(c);
-	// everything safe now.
+	return cpymo_audio_channel_play_detached(c, &d, reader, loop, info);
+}
 
-	assert(c->enabled == false);
-	
-	assert(c->io_context == NULL);
+static void cpymo_audio_channel_play_pcm(
+	cpymo_audio_channel *c, const cpymo_audio_pcm *pcm, bool loop)
+{
+	cpymo_audio_channel d;
+	cpymo_audio_channel_detach(c, &d);
+	cpymo_audio_channel_reset_unsafe(&d);
+
+	d.pcm = pcm;
+	d.pcm_offset = 0;
+	d.loop = loop;
+	cpymo_audio_channel_attach(c, &d, true);
+}
+
+// Finds an asset in package, or on filesystem if package is NULL.
+// Tracks from a package are streamed only if stream is true, otherwise read whole:
+// the package stream is shared, and only one channel may read it on the decoder thread.
+static error_t cpymo_audio_open_reader(
+	cpymo_package_stream_reader *out,
+	cpymo_engine *e,
+	cpymo_str filename,
+	error_t(*get_path)(char **, cpymo_str, const cpymo_assetloader *),
+	const cpymo_package *package,
+	bool stream)
+{
+	if (package) {
+		if (stream) 
+			return cpymo_package_stream_reader_find_create(out, package, filename);
+		else 
+			return cpymo_package_stream_reader_find_load(out, package, filename);
+	}
+
+	char *path = NULL;
+	error_t err = get_path(&path, filename, &e->assetloader);
+	CPYMO_THROW(err);
+
+	err = cpymo_package_stream_reader_from_file(out, path);
+	free(path);
+	return err;
+}
+
+// Opens an asset into a detached channel, as cpymo_audio_high_level_play finds it.
+static error_t cpymo_audio_channel_open_asset(
+	cpymo_audio_channel *c,
+	cpymo_engine *e,
+	cpymo_str filename,
+	error_t(*get_path)(char **, cpymo_str, const cpymo_assetloader *),
+	const cpymo_package *package,
+	const cpymo_backend_audio_info *info)
+{
+	cpymo_package_stream_reader r;
+	error_t err = cpymo_audio_open_reader(&r, e, filename, get_path, package, false);
+	CPYMO_THROW(err);
+
+	return cpymo_audio_channel_open(c, &r, false, info);
+}
+
+// Decodes a whole clip to the backend format, 
+// CPYMO_ERR_UNSUPPORTED if it is longer than CPYMO_AUDIO_SE_CACHE_MAX_MS.
+static error_t cpymo_audio_pcm_load(
+	cpymo_audio_pcm **out,
+	cpymo_engine *e,
+	cpymo_str filename,
+	error_t(*get_path)(char **, cpymo_str, const cpymo_assetloader *),
+	const cpymo_package *package)
+{
+	const cpymo_backend_audio_info *info = cpymo_backend_audio_get_info();
+	const size_t max_size =
+		info->freq * CPYMO_AUDIO_SE_CACHE_MAX_MS / 1000
+		* info->channels
+		* (size_t)av_get_bytes_per_sample(cpymo_audio_fmt2ffmpeg(info->format));
+
+	cpymo_audio_channel c;
+	cpymo_audio_channel_create(&c, 0);
+
+	cpymo_audio_pcm *pcm = NULL;
+	size_t capacity = 0;
+
+	error_t err = cpymo_audio_channel_open_asset(&c, e, filename, get_path, package, info);
+	if (err != CPYMO_ERR_SUCC) goto FREE_CHANNEL;
+
+	if (c.format_context->duration != AV_NOPTS_VALUE
+		&& c.format_context->duration > 
+			(int64_t)CPYMO_AUDIO_SE_CACHE_MAX_MS * (AV_TIME_BASE / 1000)) {
+		err = CPYMO_ERR_UNSUPPORTED;
+		goto FREE_CHANNEL;
+	}
+
+	pcm = (cpymo_audio_pcm *)malloc(sizeof(cpymo_audio_pcm));
+	if (pcm == NULL) {
+		err = CPYMO_ERR_OUT_OF_MEM;
+		goto FREE_CHANNEL;
+	}
+	pcm->size = 0;
+
+	do {
+		const size_t frame_size = c.converted_buf_size;
+		if (pcm->size + frame_size > max_size) {
+			err = CPYMO_ERR_UNSUPPORTED;
+			break;
+		}
+
+		if (pcm->size + frame_size > capacity) {
+			size_t new_capacity = capacity ? capacity * 2 : 64 * 1024;
+			while (new_capacity < pcm->size + frame_size) new_capacity *= 2;
+			if (new_capacity > max_size) new_capacity = max_size;
+
+			cpymo_audio_pcm *new_pcm = 
+				(cpymo_audio_pcm *)realloc(pcm, sizeof(cpymo_audio_pcm) + new_capacity);
+			if (new_pcm == NULL) {
+				err = CPYMO_ERR_OUT_OF_MEM;
+				break;
+			}
+
+			pcm = new_pcm;
+			capacity = new_capacity;
+		}
+
+		memcpy((uint8_t *)(pcm + 1) + pcm->size, c.converted_buf, frame_size);
+		pcm->size += frame_size;
+	} while ((err = cpymo_audio_channel_next_frame(&c)) == CPYMO_ERR_SUCC);
+
+	if (err == CPYMO_ERR_NO_MORE_CONTENT) err = CPYMO_ERR_SUCC;
+
+FREE_CHANNEL:
+	cpymo_audio_channel_destroy(&c);
+
+	if (err != CPYMO_ERR_SUCC) {
+		if (pcm) free(pcm);
+		return err;
+	}
+
+	cpymo_audio_pcm *fitted = 
+		(cpymo_audio_pcm *)realloc(pcm, sizeof(cpymo_audio_pcm) + pcm->size);
+	if (fitted) pcm = fitted;
+
+	pcm->samples = (uint8_t *)(pcm + 1);
+	pcm->last_used = 0;
+	*out = pcm;
+	return CPYMO_ERR_SUCC;
+}
+
+static void cpymo_audio_se_cache_free(cpymo_audio_system *s)
+{
+	cpymo_audio_se_cache_entry *cache = (cpymo_audio_se_cache_entry *)s->se_cache;
+	for (size_t i = 0; i < shlenu(cache); ++i)
+		if (cache[i].value) free(cache[i].value);
+	shfree(cache);
+	s->se_cache = NULL;
+	s->se_cache_size = 0;
+}
+
+// Frees least recently used clips, except the playing one, until at most target bytes are cached.
+static void cpymo_audio_se_cache_shrink(cpymo_audio_system *s, size_t target)
+{
+	cpymo_audio_se_cache_entry *cache = (cpymo_audio_se_cache_entry *)s->se_cache;
+	const cpymo_audio_pcm *playing = s->channels[CPYMO_AUDIO_CHANNEL_SE].pcm;
+
+	while (s->se_cache_size > target) {
+		ptrdiff_t lru = -1;
+		for (size_t i = 0; i < shlenu(cache); ++i) {
+			const cpymo_audio_pcm *pcm = cache[i].value;
+			if (pcm == NULL || pcm == playing) continue;
+			if (lru < 0 || pcm->last_used < cache[lru].value->last_used)
+				lru = (ptrdiff_t)i;
+		}
+
+		if (lru < 0) break;
+
+		s->se_cache_size -= cache[lru].value->size;
+		free(cache[lru].value);
+		shdel(cache, cache[lru].key);
+	}
+
+	s->se_cache = (void *)cache;
+}
+
+static bool cpymo_audio_se_cache_make_room(cpymo_audio_system *s, size_t size)
+{
+	if (size > CPYMO_AUDIO_SE_CACHE_BUDGET) return false;
+	cpymo_audio_se_cache_shrink(s, CPYMO_AUDIO_SE_CACHE_BUDGET - size);
+	return s->se_cache_size + size <= CPYMO_AUDIO_SE_CACHE_BUDGET;
+}
 
-	assert(c->format_context == NULL);
+void cpymo_audio_trim(cpymo_audio_system *s)
+{
+	cpymo_audio_se_cache_shrink(s, 0);
+}
 
-	if (package_reader) {
-		c->package_reader = *package_reader;
+static size_t cpymo_audio_channel_memory_usage(const cpymo_audio_channel *c)
+{
+	size_t size = c->ring_size + c->converted_buf_all_size + c->loop_head_capacity;
+	if (c->io_buffer) size += CPYMO_AUDIO_AVIO_BUFFER_SIZE;
+	return size;
+}
 
-		const size_t avio_buf_size = 1024 * 1024;
-		void *io_buffer = av_malloc(avio_buf_size);
-		if (io_buffer == NULL) {
-			cpymo_audio_channel_reset_unsafe(c);
-			return CPYMO_ERR_OUT_OF_MEM;
-		}
+size_t cpymo_audio_memory_usage(const cpymo_audio_system *s)
+{
+	if (!s->enabled) return 0;
 
-		c->io_context = avio_alloc_context(
-			(unsigned char *)io_buffer, (int)avio_buf_size, 0, &c->package_reader,
-			&cpymo_audio_packaged_audio_ffmpeg_read_packet,
-			NULL,
-			&cpymo_audio_packaged_audio_ffmpeg_seek);
+	size_t size = s->se_cache_size + cpymo_audio_channel_memory_usage(&s->vo_standby);
+	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i)
+		size += cpymo_audio_channel_memory_usage(&s->channels[i]);
 
-		if (c->io_context == NULL) {
-			cpymo_audio_channel_reset_unsafe(c);
-			printf("[Error] avio_alloc_context failed.\n");
-			return CPYMO_ERR_CAN_NOT_OPEN_FILE;
-		}
+	return size;
+}
 
-		c->format_context = avformat_alloc_context();
-		if (c->format_context == NULL) {
-			cpymo_audio_channel_reset_unsafe(c);
-			return CPYMO_ERR_OUT_OF_MEM;
-		}
+// Returns NULL if the clip should be streamed.
+static const cpymo_audio_pcm *cpymo_audio_se_cache_get(
+	cpymo_engine *e, cpymo_str sename, const cpymo_package *package)
+{
+	if (CPYMO_AUDIO_SE_CACHE_BUDGET == 0) return NULL;
 
-		c->format_context->pb = c->io_context;
-		c->format_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+	cpymo_audio_system *s = &e->audio;
+	cpymo_audio_se_cache_entry *cache = (cpymo_audio_se_cache_entry *)s->se_cache;
+
+	if (cache == NULL) {
+		sh_new_strdup(cache);
+		s->se_cache = (void *)cache;
 	}
 
-	int result = 
-		avformat_open_input(&c->format_context, filename == NULL ? "" : filename, NULL, NULL);
+	char *key = cpymo_str_copy_malloc(sename);
+	if (key == NULL) return NULL;
 
-	if (filename == NULL) filename = "package stream reader";
+	cpymo_audio_se_cache_entry *found = shgetp_null(cache, key);
+	if (found) {
+		free(key);
+		if (found->value) found->value->last_used = ++s->se_cache_clock;
+		return found->value;
+	}
 
-	if (result != 0) {
-		printf("[Error] Can not open %s with error ffmpeg error %s.\n",
-			filename,
-			av_err2str(result));
+	cpymo_audio_pcm *pcm = NULL;
+	error_t err = cpymo_audio_pcm_load(
+		&pcm, e, sename, &cpymo_assetloader_get_se_path, package);
 
-		cpymo_audio_channel_reset_unsafe(c);
-		return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+	// Too long, remember it and always stream.
+	if (err == CPYMO_ERR_UNSUPPORTED) {
+		shput(cache, key, NULL);
+		s->se_cache = (void *)cache;
+		free(key);
+		return NULL;
 	}
 
-	result = avformat_find_stream_info(c->format_context, NULL);
-	if (result != 0) {
-		cpymo_audio_channel_reset_unsafe(c);
-		printf("[Error] Can not get stream info from %s.\n", filename);
-		return CPYMO_ERR_BAD_FILE_FORMAT;
+	if (err != CPYMO_ERR_SUCC) {
+		free(key);
+		return NULL;
 	}
 
-	
-	c->stream_id = av_find_best_stream(
-		c->format_context, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
-	if (result != 0) {
-		cpymo_audio_channel_reset_unsafe(c);
-		printf("[Error] Can not find best stream from %s.\n", filename);
-		return CPYMO_ERR_BAD_FILE_FORMAT;
+	if (!cpymo_memory_reserve(e, cpymo_memory_audio, pcm->size)
+		|| !cpymo_audio_se_cache_make_room(s, pcm->size)) {
+		free(pcm);
+		cache = (cpymo_audio_se_cache_entry *)s->se_cache;
+		shput(cache, key, NULL);
+		s->se_cache = (void *)cache;
+		free(key);
+		return NULL;
 	}
 
-	AVStream *stream = c->format_context->streams[c->stream_id];
-	const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
-	if (codec == NULL) {
-		cpymo_audio_channel_reset_unsafe(c);
-		printf("[Error] Can not find codec.\n");
-		return CPYMO_ERR_NOT_FOUND;
-	}
-	assert(c->codec_context == NULL);
-	c->codec_context = avcodec_alloc_context3(codec);
-	avcodec_parameters_to_context(c->codec_context, stream->codecpar);
-	c->codec_context->pkt_timebase = stream->time_base;
-	if (c->codec_context == NULL) {
-		cpymo_audio_channel_reset_unsafe(c);
-		return CPYMO_ERR_UNKNOWN;
-	}
+	cache = (cpymo_audio_se_cache_entry *)s->se_cache;
+	pcm->last_used = ++s->se_cache_clock;
+	shput(cache, key, pcm);
+	s->se_cache = (void *)cache;
+	s->se_cache_size += pcm->size;
+	free(key);
+	return pcm;
+}
 
-	result = avcodec_open2(c->codec_context, codec, NULL);
-	if (result != 0) {
-		c->codec_context = NULL;
-		cpymo_audio_channel_reset_unsafe(c);
-		return CPYMO_ERR_UNSUPPORTED;
-	}
+void cpymo_audio_init(cpymo_audio_system *s)
+{
+	const cpymo_backend_audio_info *info = cpymo_backend_audio_get_info();
 
-	assert(c->swr_context == NULL);
-	c->swr_context = swr_alloc_set_opts(
-		NULL,
-		av_get_default_channel_layout((int)info->channels),
-		cpymo_audio_fmt2ffmpeg(info->format),
-		(int)info->freq,
-		stream->codecpar->channels == 1 ?
-			AV_CH_LAYOUT_MONO :
-			(stream->codecpar->channel_layout == 0 ?
-				av_get_default_channel_layout(stream->codecpar->channels) :
-				stream->codecpar->channel_layout),
-		(enum AVSampleFormat)stream->codecpar->format,
-		stream->codecpar->sample_rate,
-		0, NULL);
-	if (c->swr_context == NULL) {
-		cpymo_audio_channel_reset_unsafe(c);
-		return CPYMO_ERR_UNKNOWN;
+	// Backend may already run decoder thread and callback on this system,
+	// they must not see it enabled before every channel is ready.
+	if (info) {
+		cpymo_backend_audio_decoder_lock();
+		cpymo_backend_audio_lock();
 	}
 
-	result = swr_init(c->swr_context);
-	if (result < 0) {
-		cpymo_audio_channel_reset_unsafe(c);
-		return CPYMO_ERR_UNKNOWN;
+	s->enabled = false;
+	bool enabled = info != NULL;
+
+	size_t ring_size = 0;
+	if (info) {
+		ring_size = 
+			info->freq * CPYMO_AUDIO_RING_MS / 1000 
+			* info->channels
+			* (size_t)av_get_bytes_per_sample(cpymo_audio_fmt2ffmpeg(info->format));
 	}
 
-	if (c->packet == NULL) {
-		c->packet = av_packet_alloc();
-		if (c->packet == NULL) {
-			cpymo_audio_channel_reset_unsafe(c);
-			return CPYMO_ERR_OUT_OF_MEM;
-		}
-	}
+	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i) {
+		cpymo_audio_channel *c = s->channels + i;
+		cpymo_audio_channel_create(c, ring_size);
 
-	if (c->frame == NULL) {
-		c->frame = av_frame_alloc();
-		if (c->frame == NULL) {
-			cpymo_audio_channel_reset_unsafe(c);
-			return CPYMO_ERR_OUT_OF_MEM;
+		if (enabled) {
+			c->ring = (uint8_t *)malloc(ring_size);
+			if (c->ring == NULL) enabled = false;
 		}
 	}
 
-	c->loop = loop;
-	c->converted_frame_current_offset = 0;
-
-	// read first frame
-	if (cpymo_audio_channel_next_frame(c) != CPYMO_ERR_SUCC) {
-		cpymo_audio_channel_reset_unsafe(c);
-		return CPYMO_ERR_SUCC;
+	cpymo_audio_channel_create(&s->vo_standby, ring_size);
+	if (enabled) {
+		s->vo_standby.ring = (uint8_t *)malloc(ring_size);
+		if (s->vo_standby.ring == NULL) enabled = false;
 	}
 
-	cpymo_backend_audio_lock();
-	c->enabled = true;
-	cpymo_backend_audio_unlock();
-	return CPYMO_ERR_SUCC;
-}
+	s->vo_standby_name = NULL;
+	s->vo_standby_ready = false;
 
-void cpymo_audio_init(cpymo_audio_system *s)
-{
-	s->enabled = cpymo_backend_audio_get_info() != NULL;
+	memset(&s->telemetry, 0, sizeof(s->telemetry));
+	memset(&s->telemetry_last, 0, sizeof(s->telemetry_last));
 
-	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i) {
-		cpymo_audio_channel_init(s->channels + i);
-		s->channels[i].packet = NULL;
-		s->channels[i].frame = NULL;
-		s->channels[i].converted_buf = NULL;
-		s->channels[i].converted_buf_all_size = 0;
-		s->channels[i].volume = 0;
+	if (!enabled) {
+		for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i) {
+			if (s->channels[i].ring) free(s->channels[i].ring);
+			s->channels[i].ring = NULL;
+		}
+
+		if (s->vo_standby.ring) free(s->vo_standby.ring);
+		s->vo_standby.ring = NULL;
 	}
 
 	s->bgm_name = NULL;
 	s->se_name = NULL;
+
+	s->se_cache = NULL;
+	s->se_cache_size = 0;
+	s->se_cache_clock = 0;
+
+	s->enabled = enabled;
+
+	if (info) {
+		cpymo_backend_audio_unlock();
+		cpymo_backend_audio_decoder_unlock();
+	}
 }
 
 void cpymo_audio_free(cpymo_audio_system *s)
 {
 	if (s->enabled == false) return;
 
-	cpymo_backend_audio_lock();
+	cpymo_backend_audio_decoder_lock();
 
+	cpymo_backend_audio_lock();
+	s->enabled = false;
 	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i) {
 		s->channels[i].enabled = false;
-		cpymo_audio_channel_reset_unsafe(s->channels + i);
-
-		if (s->channels[i].packet) av_packet_free(&s->channels[i].packet);
-		if (s->channels[i].frame) av_frame_free(&s->channels[i].frame);
-		if (s->channels[i].converted_buf) free(s->channels[i].converted_buf);
+		s->channels[i].decoding = false;
 	}
-
 	cpymo_backend_audio_unlock();
 
-	s->enabled = false;
+	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i)
+		cpymo_audio_channel_destroy(s->channels + i);
+
+	cpymo_backend_audio_decoder_unlock();
+
+	cpymo_audio_channel_destroy(&s->vo_standby);
+	s->vo_standby_ready = false;
+	if (s->vo_standby_name) free(s->vo_standby_name);
+	s->vo_standby_name = NULL;
+
+	cpymo_audio_se_cache_free(s);
 
 	if (s->bgm_name) free(s->bgm_name);
 	if (s->se_name) free(s->se_name);
 }
 
+// Samples returned stay valid until the next call on the same channel.
 bool cpymo_audio_channel_get_samples(void **samples, size_t *len, size_t cid, cpymo_audio_system *s)
-{ RETRY: {
+{
 	if (!s->enabled) return false;
 
 	cpymo_audio_channel *c = &s->channels[cid];
+
+	if (c->ring_pending) {
+		cpymo_audio_channel_consume(c, c->ring_pending);
+		c->ring_pending = 0;
+	}
+
 	if (!c->enabled) return false;
 
-	size_t writeable_size = c->converted_buf_size - c->converted_frame_current_offset;
+	uint8_t *ring_samples;
+	size_t size = cpymo_audio_channel_peek(c, &ring_samples);
 
-	if (writeable_size == 0) {
-		error_t err = cpymo_audio_channel_next_frame(c);
-		if (err == CPYMO_ERR_SUCC) goto RETRY;
-		else {
-			cpymo_audio_channel_reset_unsafe(c);
-			return false;
-		}
+	if (*len == 0) return false;
+
+	if (size == 0) {
+		if (c->enabled && c->ring_primed) c->underruns++;
+		return false;
 	}
 
-	*samples = c->converted_buf + c->converted_frame_current_offset;
+	if (size > *len) size = *len;
 
-	if (writeable_size > *len) writeable_size = *len;
-	*len = writeable_size;
-	c->converted_frame_current_offset += writeable_size;
+	*samples = ring_samples;
+	*len = size;
+	c->ring_pending = size;
 
 	return true;
-} }
+}
 
-void cpymo_audio_copy_mixed_samples(void * dst, size_t len, cpymo_audio_system *s)
+bool cpymo_audio_copy_mixed_samples(void * dst, size_t len, cpymo_audio_system *s)
 {
-	if (s->enabled == false) return;
+	if (s->enabled == false) {
+		memset(dst, 0, len);
+		return true;
+	}
 
-	memset(dst, 0, len);
+	const cpymo_backend_audio_info *info = cpymo_backend_audio_get_info();
+	uint8_t *out = (uint8_t *)dst;
+	bool underrun[CPYMO_AUDIO_MAX_CHANNELS] = { false };
+	bool complete = true;
 
-	for (size_t i = 0; i < CPYMO_AUDIO_MAX_CHANNELS; ++i) {
-		if (s->channels[i].enabled) {
-			cpymo_audio_channel_mix_samples((uint8_t *)dst, len, s->channels + i);
+	while (len > 0) {
+		const void *src[CPYMO_AUDIO_MAX_CHANNELS];
+		float volume[CPYMO_AUDIO_MAX_CHANNELS];
+		cpymo_audio_channel *playing[CPYMO_AUDIO_MAX_CHANNELS];
+		size_t count = 0, size = len;
+
+		// mix as much as every playing channel has without wrapping.
+		for (size_t cid = 0; cid < CPYMO_AUDIO_MAX_CHANNELS; ++cid) {
+			cpymo_audio_channel *c = s->channels + cid;
+			if (!c->enabled) continue;
+
+			uint8_t *samples;
+			size_t readable = cpymo_audio_channel_peek(c, &samples);
+			if (readable == 0) {
+				if (c->enabled && c->ring_primed && !underrun[cid]) {
+					c->underruns++;
+					underrun[cid] = true;
+					complete = false;
+				}
+				continue;
+			}
+
+			if (readable < size) size = readable;
+			src[count] = samples;
+			volume[count] = c->volume;
+			playing[count] = c;
+			count++;
+		}
+
+		if (count == 0) {
+			memset(out, 0, len);
+			return complete;
 		}
+
+		cpymo_audio_mix(out, src, volume, count, size, info->format);
+
+		for (size_t k = 0; k < count; ++k)
+			cpymo_audio_channel_consume(playing[k], size);
+
+		out += size;
+		len -= size;
 	}
+
+	return complete;
+}
+
+cpymo_audio_channel_stats cpymo_audio_get_channel_stats(size_t cid, const cpymo_audio_system *s)
+{
+	const cpymo_audio_channel *c = &s->channels[cid];
+
+	cpymo_audio_channel_stats stats;
+	stats.ring_size = c->ring_size;
+	stats.ring_fill = 
+		cpymo_atomic_size_load(&c->ring_write) - cpymo_atomic_size_load(&c->ring_read);
+	stats.ring_fill_lowest = c->ring_fill_lowest;
+	stats.underruns = c->underruns;
+	return stats;
+}
+
+void cpymo_audio_telemetry_callback(
+	cpymo_audio_system *s, double seconds, double budget_seconds, bool complete)
+{
+	cpymo_audio_telemetry *t = &s->telemetry;
+	t->callbacks++;
+	if (!complete) t->short_callbacks++;
+	if (seconds > budget_seconds) t->late_callbacks++;
+	t->callback_seconds += seconds;
+	if (seconds > t->callback_seconds_max) t->callback_seconds_max = seconds;
+}
+
+void cpymo_audio_telemetry_lock_held(cpymo_audio_system *s, double seconds)
+{
+	if (seconds > s->telemetry.lock_seconds_max) 
+		s->telemetry.lock_seconds_max = seconds;
+}
+
+void cpymo_audio_telemetry_update(cpymo_audio_system *s, float delta_time)
+{
+	if (!s->enabled) return;
+
+	s->telemetry.window_seconds += delta_time;
+	if (s->telemetry.window_seconds < CPYMO_AUDIO_TELEMETRY_WINDOW) return;
+
+	cpymo_backend_audio_lock();
+	cpymo_audio_telemetry t = s->telemetry;
+	memset(&s->telemetry, 0, sizeof(s->telemetry));
+	cpymo_backend_audio_unlock();
+
+	s->telemetry_last = t;
+
+	#ifndef ENABLE_AUDIO_TELEMETRY_LOG
+	if (t.short_callbacks == 0 && t.late_callbacks == 0) return;
+	#endif
+
+	printf("[Audio] %u callbacks in %.1fs, avg %.2fms, max %.2fms, short %u, late %u, lock max %.2fms.\n",
+		(unsigned)t.callbacks,
+		t.window_seconds,
+		t.callbacks ? t.callback_seconds / t.callbacks * 1000.0 : 0.0,
+		t.callback_seconds_max * 1000.0,
+		(unsigned)t.short_callbacks,
+		(unsigned)t.late_callbacks,
+		t.lock_seconds_max * 1000.0);
+}
+
+cpymo_audio_telemetry cpymo_audio_get_telemetry(const cpymo_audio_system *s)
+{
+	return s->telemetry_last;
 }
 
 bool cpymo_audio_enabled(cpymo_engine * e)
@@ -567,39 +1591,7 @@ bool cpymo_audio_wait_se(struct cpymo_engine *e, float d)
 		return true;
 	}
 
-	return !e->audio.channels[CPYMO_AUDIO_CHANNEL_SE].enabled;
-}
-
-static error_t cpymo_audio_high_level_play_file_on_filesystem(
-	cpymo_engine *e,
-	const char *path,
-	int channel,
-	bool loop)
-{
-	#ifdef DONT_PASS_PATH_TO_FFMPEG
-		cpymo_package_stream_reader r;
-		error_t err = cpymo_package_stream_reader_from_file(&r, path);
-		CPYMO_THROW(err);
-		
-		err = cpymo_audio_channel_play_file(
-			&e->audio.channels[channel],
-			NULL,
-			&r,
-			loop);
-
-		if (err != CPYMO_ERR_SUCC) {
-			cpymo_package_stream_reader_close(&r);
-			return err;
-		}
-
-		return CPYMO_ERR_SUCC;
-	#else
-		return cpymo_audio_channel_play_file(
-			&e->audio.channels[channel],
-			path,
-			NULL,
-			loop);
-	#endif
+	return cpymo_engine_audio_state(e, !e->audio.channels[CPYMO_AUDIO_CHANNEL_SE].enabled);
 }
 
 static error_t cpymo_audio_high_level_play(
@@ -611,32 +1603,42 @@ static error_t cpymo_audio_high_level_play(
 	bool loop)
 {
 	if (e->audio.enabled) {
-		if (package) {
-			cpymo_package_stream_reader r;
-			error_t err = cpymo_package_stream_reader_find_create(
-				&r, package, filename);
+		CPYMO_TRACE_BEGIN(trace);
+
+		cpymo_audio_channel *c = &e->audio.channels[channel];
+		const cpymo_backend_audio_info *info = cpymo_backend_audio_get_info();
+		cpymo_package_stream_reader r;
+		error_t err;
+
+		if (channel == CPYMO_AUDIO_CHANNEL_BGM && package && info) {
+			cpymo_package_index index;
+			err = cpymo_package_find(&index, package, filename);
 			CPYMO_THROW(err);
 
-			err = cpymo_audio_channel_play_file(
-				&e->audio.channels[channel],
-				NULL,
-				&r,
-				loop);
-			if (err != CPYMO_ERR_SUCC) {
-				cpymo_package_stream_reader_close(&r);
-				return err;
-			}
+			// Creating a streamed reader seeks the shared package stream,
+			// which the decoder thread reads for the old track until it is detached.
+			cpymo_audio_channel d;
+			cpymo_audio_channel_detach(c, &d);
+			cpymo_audio_channel_reset_unsafe(&d);
+
+			r = cpymo_package_stream_reader_create(package, &index);
+			err = cpymo_audio_channel_play_detached(c, &d, &r, loop, info);
 		}
 		else {
-			char *path = NULL;
-			error_t err = get_path(&path, filename, &e->assetloader);
+			// SE and voice packages are also read on main thread by cache and standby.
+			err = cpymo_audio_open_reader(
+				&r, e, filename, get_path, package,
+				channel == CPYMO_AUDIO_CHANNEL_BGM);
 			CPYMO_THROW(err);
 
-			err = cpymo_audio_high_level_play_file_on_filesystem(
-				e, path, channel, loop);
-			free(path);
-			return err;
+			err = cpymo_audio_channel_play_file(c, &r, loop);
 		}
+
+		#ifdef ENABLE_TRACE
+		static const char *names[CPYMO_AUDIO_MAX_CHANNELS] = { "play_bgm", "play_se", "play_vo" };
+		CPYMO_TRACE_END(trace, "audio", names[channel], filename, 0);
+		#endif
+		return err;
 	}
 
 	return CPYMO_ERR_SUCC;
@@ -669,7 +1671,8 @@ error_t cpymo_audio_bgm_play(cpymo_engine *e, cpymo_str bgmname, bool loop)
 
 	return cpymo_audio_high_level_play(
 		e, bgmname, &cpymo_assetloader_get_bgm_path, 
-		NULL, CPYMO_AUDIO_CHANNEL_BGM, loop);
+		e->assetloader.use_pkg_bgm ? &e->assetloader.pkg_bgm : NULL,
+		CPYMO_AUDIO_CHANNEL_BGM, loop);
 }
 
 void cpymo_audio_bgm_stop(cpymo_engine * engine)
@@ -700,10 +1703,23 @@ error_t cpymo_audio_se_play(cpymo_engine * e, cpymo_str sename, bool loop)
 		}
 	}
 
+	const cpymo_package *package = 
+		e->assetloader.use_pkg_se ? &e->assetloader.pkg_se : NULL;
+
+	if (e->audio.enabled) {
+		CPYMO_TRACE_BEGIN(trace);
+		const cpymo_audio_pcm *pcm = cpymo_audio_se_cache_get(e, sename, package);
+		if (pcm) {
+			cpymo_audio_channel_play_pcm(
+				&e->audio.channels[CPYMO_AUDIO_CHANNEL_SE], pcm, loop);
+			CPYMO_TRACE_END(trace, "audio", "play_se_cached", sename, pcm->size);
+			return CPYMO_ERR_SUCC;
+		}
+	}
+
 	return cpymo_audio_high_level_play(
 		e, sename, &cpymo_assetloader_get_se_path,
-		e->assetloader.use_pkg_se ? &e->assetloader.pkg_se : NULL,
-		CPYMO_AUDIO_CHANNEL_SE, loop);
+		package, CPYMO_AUDIO_CHANNEL_SE, loop);
 }
 
 void cpymo_audio_se_stop(cpymo_engine *e)
@@ -719,8 +1735,101 @@ void cpymo_audio_se_stop(cpymo_engine *e)
 	}
 }
 
+error_t cpymo_audio_vo_prepare(cpymo_engine *e, cpymo_str voname)
+{
+	cpymo_audio_system *s = &e->audio;
+	if (!s->enabled) return CPYMO_ERR_SUCC;
+
+	if (s->vo_standby_ready && cpymo_str_equals_str(voname, s->vo_standby_name))
+		return CPYMO_ERR_SUCC;
+
+	const cpymo_backend_audio_info *info = cpymo_backend_audio_get_info();
+	if (info == NULL) return CPYMO_ERR_SUCC;
+
+	// The standby is never seen by the decoder thread or the callback.
+	cpymo_audio_channel *c = &s->vo_standby;
+	s->vo_standby_ready = false;
+	cpymo_audio_channel_reset_unsafe(c);
+	c->ring_read = 0;
+	c->ring_write = 0;
+	c->ring_pending = 0;
+
+	CPYMO_TRACE_BEGIN(trace);
+	error_t err = cpymo_audio_channel_open_asset(
+		c, e, voname, &cpymo_assetloader_get_vo_path,
+		e->assetloader.use_pkg_voice ? &e->assetloader.pkg_voice : NULL,
+		info);
+
+	// Nothing to decode, channel has been reset already.
+	if (err == CPYMO_ERR_NO_MORE_CONTENT) return CPYMO_ERR_SUCC;
+	CPYMO_THROW(err);
+
+	char *name = cpymo_str_copy_malloc(voname);
+	if (name == NULL) {
+		cpymo_audio_channel_reset_unsafe(c);
+		return CPYMO_ERR_OUT_OF_MEM;
+	}
+
+	c->decoding = true;
+	size_t head = 
+		info->freq * CPYMO_AUDIO_VO_PREPARE_MS / 1000
+		* info->channels
+		* (size_t)av_get_bytes_per_sample(cpymo_audio_fmt2ffmpeg(info->format));
+	if (head > c->ring_size) head = c->ring_size;
+	cpymo_audio_channel_decode(c, head);
+	CPYMO_TRACE_END(trace, "audio", "prepare_vo", voname, head);
+
+	if (s->vo_standby_name) free(s->vo_standby_name);
+	s->vo_standby_name = name;
+	s->vo_standby_ready = true;
+	return CPYMO_ERR_SUCC;
+}
+
+// Moves the prepared voice into VO channel, false if it is not for voname.
+static bool cpymo_audio_vo_play_standby(cpymo_audio_system *s, cpymo_str voname)
+{
+	if (!s->vo_standby_ready) return false;
+	s->vo_standby_ready = false;
+
+	// Another voice is played, release the prepared decoder now.
+	if (!cpymo_str_equals_str(voname, s->vo_standby_name)) {
+		cpymo_audio_channel_reset_unsafe(&s->vo_standby);
+		return false;
+	}
+
+	cpymo_audio_channel *vo = s->channels + CPYMO_AUDIO_CHANNEL_VO;
+	cpymo_audio_channel_reset(vo);
+
+	cpymo_backend_audio_decoder_lock();
+	cpymo_backend_audio_lock();
+
+	cpymo_audio_channel prev = *vo;
+	*vo = s->vo_standby;
+	s->vo_standby = prev;
+
+	vo->volume = prev.volume;
+	vo->ring_primed = false;
+	vo->underruns = 0;
+	vo->ring_fill_lowest = vo->ring_size;
+	vo->enabled = true;
+
+	// AVIO reads through the reader stored in the channel.
+	if (vo->io_context) vo->io_context->opaque = &vo->package_reader;
+	if (s->vo_standby.io_context) 
+		s->vo_standby.io_context->opaque = &s->vo_standby.package_reader;
+
+	cpymo_backend_audio_unlock();
+	cpymo_backend_audio_decoder_unlock();
+
+	cpymo_backend_audio_decoder_wake();
+	return true;
+}
+
 error_t cpymo_audio_vo_play(cpymo_engine * e, cpymo_str voname)
 {
+	if (e->audio.enabled && cpymo_audio_vo_play_standby(&e->audio, voname))
+		return CPYMO_ERR_SUCC;
+
 	return cpymo_audio_high_level_play(
 		e, voname, &cpymo_assetloader_get_vo_path,
 		e->assetloader.use_pkg_voice ? &e->assetloader.pkg_voice : NULL,
@@ -730,12 +1839,21 @@ error_t cpymo_audio_vo_play(cpymo_engine * e, cpymo_str voname)
 void cpymo_audio_vo_stop(cpymo_engine * e)
 {
 	cpymo_audio_channel_reset(e->audio.channels + CPYMO_AUDIO_CHANNEL_VO);
+
+	e->audio.vo_standby_ready = false;
+	cpymo_audio_channel_reset_unsafe(&e->audio.vo_standby);
 }
 
 error_t cpymo_audio_play_video(cpymo_engine * e, const char * path)
 {
-	return cpymo_audio_high_level_play_file_on_filesystem(
-		e, path, CPYMO_AUDIO_CHANNEL_BGM, false);
+	if (!e->audio.enabled) return CPYMO_ERR_SUCC;
+
+	cpymo_package_stream_reader r;
+	error_t err = cpymo_package_stream_reader_from_file(&r, path);
+	CPYMO_THROW(err);
+
+	return cpymo_audio_channel_play_file(
+		&e->audio.channels[CPYMO_AUDIO_CHANNEL_BGM], &r, false);
 }
 
 const char * cpymo_audio_get_bgm_name(cpymo_engine * e)
@@ -772,8 +1890,8 @@ const char * cpymo_audio_get_se_name(cpymo_engine * e)
 bool cpymo_audio_enabled(cpymo_engine * e)
 { return false; }
 
-void cpymo_audio_copy_mixed_samples(void * dst, size_t len, cpymo_audio_system *s)
-{ memset(dst, 0, len); }
+bool cpymo_audio_copy_mixed_samples(void * dst, size_t len, cpymo_audio_system *s)
+{ memset(dst, 0, len); return true; }
 
 bool cpymo_audio_channel_get_samples(
 	void **samples,
@@ -793,6 +1911,15 @@ void cpymo_audio_init(cpymo_audio_system *s)
 
 void cpymo_audio_free(cpymo_audio_system *s) {}
 
+void cpymo_audio_decode(cpymo_audio_system *s) {}
+
+cpymo_audio_channel_stats cpymo_audio_get_channel_stats(size_t cid, const cpymo_audio_system *s)
+{
+	cpymo_audio_channel_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	return stats;
+}
+
 float cpymo_audio_get_channel_volume(size_t cid, const cpymo_audio_system *s)
 {
 	return s->volumes[cid];
@@ -803,9 +1930,8 @@ void cpymo_audio_set_channel_volume(size_t cid, cpymo_audio_system *s, float vol
 	s->volumes[cid] = vol;
 }
 
-struct cpymo_engine;
 bool cpymo_audio_wait_se(struct cpymo_engine *e, float d)
-{ return true; }
+{ return cpymo_engine_audio_state(e, true); }
 
 error_t cpymo_audio_bgm_play(struct cpymo_engine *e, cpymo_str bgmname, bool loop)
 { return CPYMO_ERR_SUCC; }
@@ -817,6 +1943,9 @@ error_t cpymo_audio_se_play(struct cpymo_engine *e, cpymo_str sename, bool loop)
 
 void cpymo_audio_se_stop(struct cpymo_engine *e) {}
 
+error_t cpymo_audio_vo_prepare(struct cpymo_engine *e, cpymo_str voname)
+{ return CPYMO_ERR_SUCC; }
+
 error_t cpymo_audio_vo_play(struct cpymo_engine *e, cpymo_str voname)
 { return CPYMO_ERR_SUCC; }
 
@@ -833,3 +1962,27 @@ bool cpymo_audio_channel_is_looping(size_t cid, cpymo_audio_system *s)
 
 #endif
 
+#ifdef DISABLE_FFMPEG_AUDIO
+#include <string.h>
+
+void cpymo_audio_telemetry_callback(
+	cpymo_audio_system *s, double seconds, double budget_seconds, bool complete) {}
+
+void cpymo_audio_telemetry_lock_held(cpymo_audio_system *s, double seconds) {}
+
+void cpymo_audio_telemetry_update(cpymo_audio_system *s, float delta_time) {}
+
+cpymo_audio_telemetry cpymo_audio_get_telemetry(const cpymo_audio_system *s)
+{
+	cpymo_audio_telemetry t;
+	memset(&t, 0, sizeof(t));
+	return t;
+}
+
+size_t cpymo_audio_memory_usage(const cpymo_audio_system *s)
+{ return 0; }
+
+void cpymo_audio_trim(cpymo_audio_system *s) {}
+
+#endif
+
@@ -18,6 +18,21 @@
 #endif
 #endif
 
+// Mixing callback timing over a window, reported by backends.
+typedef struct {
+	size_t callbacks;
+	
+	// produced silence for a playing channel, or took longer than the audio it made.
+	size_t short_callbacks, late_callbacks;
+
+	double callback_seconds, callback_seconds_max;
+
+	// longest time cpymo_backend_audio_lock was held outside the callback.
+	double lock_seconds_max;
+
+	float window_seconds;
+} cpymo_audio_telemetry;
+
 #ifdef DISABLE_AUDIO
 typedef struct {
 	float volumes[CPYMO_AUDIO_MAX_CHANNELS];
@@ -38,6 +53,12 @@ extern "C" {
 }
 #endif
 
+typedef struct {
+	size_t size;
+	uint64_t last_used;
+	uint8_t *samples;
+} cpymo_audio_pcm;
+
 typedef struct {
 	bool enabled, loop;
 
@@ -57,7 +78,34 @@ typedef struct {
 	AVIOContext *io_context;
 	cpymo_package_stream_reader package_reader;
 
+	// Kept when a track ends, reused by the next track if it matches.
+	AVCodecParameters *codec_parameters;
+	uint8_t *io_buffer;
+
 	int stream_id;
+
+	// Plays from memory instead of FFmpeg when set.
+	const cpymo_audio_pcm *pcm;
+	size_t pcm_offset;
+
+	// Decoded head of a looping track, replayed from memory at the loop point
+	// while the decoder seeks back and skips it.
+	cpymo_audio_pcm *loop_head;
+	size_t loop_head_capacity, loop_skip;
+	bool loop_resident, loop_capturing, loop_whole;
+
+	// Decoded PCM, filled by cpymo_audio_decode and drained by the audio callback.
+	// ring_write and decoding belong to the decoder, ring_read to the callback.
+	uint8_t *ring;
+	size_t ring_size;
+	volatile size_t ring_read, ring_write;
+	volatile bool decoding;
+	size_t ring_pending;
+
+	// Set by the callback once the ring had samples, a channel which
+	// just started is not underrun until the decoder has written to it.
+	bool ring_primed;
+	size_t underruns, ring_fill_lowest;
 } cpymo_audio_channel;
 
 typedef struct {
@@ -65,19 +113,64 @@ typedef struct {
 	cpymo_audio_channel channels[CPYMO_AUDIO_MAX_CHANNELS];
 
 	char *bgm_name, *se_name;
+
+	// Decoded short SE clips.
+	void *se_cache;
+	size_t se_cache_size;
+	uint64_t se_cache_clock;
+
+	// Voice opened ahead of its #vo, swapped into VO channel when played.
+	cpymo_audio_channel vo_standby;
+	char *vo_standby_name;
+	bool vo_standby_ready;
+
+	// Current window is written under cpymo_backend_audio_lock.
+	cpymo_audio_telemetry telemetry, telemetry_last;
 } cpymo_audio_system;
 
 #elif (!defined DISABLE_AUDIO)
 typedef void *cpymo_audio_system;
 #endif
 
-void cpymo_audio_copy_mixed_samples(void * dst, size_t len, cpymo_audio_system *s);
+typedef struct {
+	size_t ring_size, ring_fill, ring_fill_lowest;
+	size_t underruns;
+} cpymo_audio_channel_stats;
+
+// Mixes every channel with its volume into dst, in one pass.
+// Returns false if a playing channel had not enough samples.
+bool cpymo_audio_copy_mixed_samples(void * dst, size_t len, cpymo_audio_system *s);
 bool cpymo_audio_channel_get_samples(
 	void **samples,
 	size_t *in_out_len,
 	size_t channelID,
 	cpymo_audio_system *);
 
+// Decode every playing channel until its PCM ring is full.
+// Backends call it on their decoder thread, or before mixing if they have none.
+void cpymo_audio_decode(cpymo_audio_system *);
+
+cpymo_audio_channel_stats cpymo_audio_get_channel_stats(size_t cid, const cpymo_audio_system *);
+
+// Backends report every mixing callback, budget is the duration of audio it produced.
+void cpymo_audio_telemetry_callback(
+	cpymo_audio_system *, double seconds, double budget_seconds, bool complete);
+
+// Backends report before releasing cpymo_backend_audio_lock.
+void cpymo_audio_telemetry_lock_held(cpymo_audio_system *, double seconds);
+
+// Closes the window every CPYMO_AUDIO_TELEMETRY_WINDOW seconds and logs it.
+void cpymo_audio_telemetry_update(cpymo_audio_system *, float delta_time);
+
+// The last closed window.
+cpymo_audio_telemetry cpymo_audio_get_telemetry(const cpymo_audio_system *);
+
+// PCM rings, decoder buffers and cached SE clips.
+size_t cpymo_audio_memory_usage(const cpymo_audio_system *);
+
+// Frees cached SE clips which are not playing.
+void cpymo_audio_trim(cpymo_audio_system *);
+
 void cpymo_audio_init(cpymo_audio_system *);
 void cpymo_audio_free(cpymo_audio_system *);
 
@@ -99,6 +192,9 @@ void cpymo_audio_bgm_stop(struct cpymo_engine *e);
 error_t cpymo_audio_se_play(struct cpymo_engine *e, cpymo_str sename, bool loop);
 void cpymo_audio_se_stop(struct cpymo_engine *e);
 
+// Opens a voice and decodes its head ahead of time,
+// the next cpymo_audio_vo_play with the same name starts from it.
+error_t cpymo_audio_vo_prepare(struct cpymo_engine *e, cpymo_str voname);
 error_t cpymo_audio_vo_play(struct cpymo_engine *e, cpymo_str voname);
 void cpymo_audio_vo_stop(struct cpymo_engine *e);
 
@@ -76,6 +76,39 @@ static void cpymo_backlog_record_clean(cpymo_backlog_record *rec)
 #endif
 }
 
+size_t cpymo_backlog_memory_usage(const cpymo_backlog *b)
+{
+	if (b->records == NULL) return 0;
+
+	size_t size = CPYMO_BACKLOG_MAX_RECORDS * sizeof(b->records[0]);
+	for (size_t i = 0; i < CPYMO_BACKLOG_MAX_RECORDS; ++i) {
+		const cpymo_backlog_record *rec = &b->records[i];
+		if (rec->text == NULL) continue;
+
+		const cpymo_str text = cpymo_str_pure(rec->text);
+		size += text.len + 1;
+
+		// Rendered text is estimated as a byte per pixel of every character.
+		if (rec->text_render) {
+			const size_t font_size = (size_t)(rec->font_size + 0.5f);
+			size += cpymo_str_utf8_len(text) * font_size * font_size;
+		}
+	}
+
+	return size;
+}
+
+void cpymo_backlog_trim(cpymo_backlog *b)
+{
+	if (b->records == NULL) return;
+
+	for (size_t i = 0; i < CPYMO_BACKLOG_MAX_RECORDS; ++i) {
+		cpymo_backlog_record *rec = &b->records[i];
+		if (rec->text_render) cpymo_backend_text_free(rec->text_render);
+		rec->text_render = NULL;
+	}
+}
+
 void cpymo_backlog_free(cpymo_backlog *b)
 {
 	if (b->owning_name && b->pending_name) {
@@ -23,6 +23,11 @@ typedef struct {
 error_t cpymo_backlog_init(cpymo_backlog *);
 void cpymo_backlog_free(cpymo_backlog *);
 
+size_t cpymo_backlog_memory_usage(const cpymo_backlog *);
+
+// Frees rendered texts, they are rendered again when backlog is shown.
+void cpymo_backlog_trim(cpymo_backlog *);
+
 void cpymo_backlog_record_write_vo(
 	cpymo_backlog *,
 	cpymo_str vo);
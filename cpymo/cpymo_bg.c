@@ -24,6 +24,16 @@ void cpymo_bg_free(cpymo_bg *bg)
 		free(bg->current_bg_name);
 }
 
+size_t cpymo_bg_memory_usage(const cpymo_bg *bg)
+{
+	size_t size = 0;
+	if (bg->current_bg)
+		size += (size_t)bg->current_bg_w * bg->current_bg_h * 3;
+	if (bg->transform_next_bg)
+		size += (size_t)bg->transform_next_bg_w * bg->transform_next_bg_h * 3;
+	return size;
+}
+
 void cpymo_bg_draw(const cpymo_engine *e)
 {
 	const cpymo_bg *bg = &e->bg;
@@ -246,6 +256,12 @@ error_t cpymo_bg_command(
 	if (cpymo_str_equals_str(transition, "BG_NOFADE") || time <= 0.00001f)
 		return cpymo_bg_command_low_memory(engine, bg, bgname, x, y);
 
+	// A transition keeps both backgrounds until it ends.
+	const size_t next_bg_size =
+		(size_t)engine->gameconfig.imagesize_w * engine->gameconfig.imagesize_h * 3;
+	if (!cpymo_memory_reserve(engine, cpymo_memory_bg, next_bg_size))
+		return cpymo_bg_command_low_memory(engine, bg, bgname, x, y);
+
 	int w, h;
 	cpymo_backend_image img;
 	error_t err = cpymo_assetloader_load_bg_image(
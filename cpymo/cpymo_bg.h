@@ -43,6 +43,8 @@ static inline void cpymo_bg_init(cpymo_bg *bg)
 
 void cpymo_bg_free(cpymo_bg *);
 
+size_t cpymo_bg_memory_usage(const cpymo_bg *);
+
 static inline void cpymo_bg_reset(cpymo_bg *bg)
 { cpymo_bg_free(bg); cpymo_bg_init(bg); }
 
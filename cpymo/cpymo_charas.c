@@ -3,72 +3,128 @@
 #include "cpymo_engine.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include "../stb/stb_ds.h"
+
+typedef struct {
+	int key;
+	size_t value;
+} cpymo_charas_index_entry;
+
+static void cpymo_charas_free_chara(struct cpymo_chara *ch)
+{
+	cpymo_backend_image_free(ch->img);
+	free(ch->chara_name);
+}
 
 void cpymo_charas_free(cpymo_charas *c)
 {
-	while (c->chara) {
-		struct cpymo_chara *to_free = c->chara;
-		c->chara = c->chara->next;
+	for (size_t i = 0; i < c->count; ++i)
+		cpymo_charas_free_chara(&c->chara[i]);
 
-		cpymo_backend_image_free(to_free->img);
-		free(to_free);
-	}
+	if (c->chara) free(c->chara);
+	if (c->pos_x) free(c->pos_x);
+	if (c->pos_y) free(c->pos_y);
+	if (c->alpha) free(c->alpha);
+
+	cpymo_charas_index_entry *index = (cpymo_charas_index_entry *)c->index;
+	hmfree(index);
+	c->index = NULL;
 
 	if (c->anime_owned && c->anime_pos)
 		free(c->anime_pos);
 }
 
+size_t cpymo_charas_memory_usage(const cpymo_charas *c)
+{
+	size_t size = c->capacity * (sizeof(struct cpymo_chara) + 3 * sizeof(cpymo_tween));
+	for (size_t i = 0; i < c->count; ++i) {
+		const struct cpymo_chara *ch = &c->chara[i];
+		size += strlen(ch->chara_name) + 1 + (size_t)ch->img_w * ch->img_h * 4;
+	}
+	return size;
+}
+
+// Indices from the given one on have moved.
+static void cpymo_charas_reindex(cpymo_charas *c, size_t from)
+{
+	cpymo_charas_index_entry *index = (cpymo_charas_index_entry *)c->index;
+	for (size_t i = from; i < c->count; ++i)
+		if (c->chara[i].alive)
+			hmput(index, c->chara[i].chara_id, i);
+	c->index = (void *)index;
+}
+
+static void cpymo_charas_unindex(cpymo_charas *c, int chara_id)
+{
+	cpymo_charas_index_entry *index = (cpymo_charas_index_entry *)c->index;
+	hmdel(index, chara_id);
+	c->index = (void *)index;
+}
+
+static void cpymo_charas_die(cpymo_charas *c, size_t i, float time)
+{
+	c->chara[i].alive = false;
+	cpymo_charas_unindex(c, c->chara[i].chara_id);
+	cpymo_tween_to(&c->alpha[i], 0, time);
+}
+
 void cpymo_charas_gc(cpymo_charas *p, bool trim_memory)
 {
-	struct cpymo_chara *pcur = p->chara, **ppcur = &p->chara;
-	while (pcur) {
-		struct cpymo_chara *pnext = pcur->next;
-		if (!pcur->alive && (trim_memory || cpymo_tween_value(&pcur->alpha) <= 0.0001f)) {
-			*ppcur = pnext;
-
-			cpymo_backend_image_free(pcur->img);
-			free(pcur);
+	size_t kept = 0, first_moved = p->count;
+	for (size_t i = 0; i < p->count; ++i) {
+		if (!p->chara[i].alive && (trim_memory || cpymo_tween_value(&p->alpha[i]) <= 0.0001f)) {
+			cpymo_charas_free_chara(&p->chara[i]);
+			if (first_moved == p->count) first_moved = kept;
+			continue;
 		}
-		else {
-			ppcur = &pcur->next;
+
+		if (kept != i) {
+			p->chara[kept] = p->chara[i];
+			p->pos_x[kept] = p->pos_x[i];
+			p->pos_y[kept] = p->pos_y[i];
+			p->alpha[kept] = p->alpha[i];
 		}
 
-		pcur = pnext;
+		kept++;
 	}
+
+	if (kept == p->count) return;
+
+	// Collected charas were dead and not indexed, only the ones after them moved.
+	p->count = kept;
+	cpymo_charas_reindex(p, first_moved);
+}
+
+// Returns true if every tween had finished before this update.
+static bool cpymo_charas_update_tweens(
+	cpymo_tween *tweens, size_t count, float delta_time, bool finish)
+{
+	bool finished = true;
+	for (size_t i = 0; i < count; ++i) {
+		if (finish) cpymo_tween_finish(&tweens[i]);
+		if (!cpymo_tween_finished(&tweens[i])) finished = false;
+		cpymo_tween_update(&tweens[i], delta_time);
+	}
+
+	return finished;
 }
 
 static bool cpymo_charas_wait_all_tween(cpymo_engine *e, float delta_time)
 {
 	cpymo_engine_request_redraw(e);
-	bool waiting = false;
 
 	bool forward_key_pressed = cpymo_input_foward_key_just_pressed(e);
 
-	struct cpymo_chara * pcur = e->charas.chara;
-	while (pcur) {
-
-		if (forward_key_pressed) {
-			cpymo_tween_finish(&pcur->pos_x);
-			cpymo_tween_finish(&pcur->pos_y);
-			cpymo_tween_finish(&pcur->alpha);
-		}
-
-		if (!cpymo_tween_finished(&pcur->pos_x)
-			|| !cpymo_tween_finished(&pcur->pos_y)
-			|| !cpymo_tween_finished(&pcur->alpha))
-			waiting = true;
-
-		cpymo_tween_update(&pcur->pos_x, delta_time);
-		cpymo_tween_update(&pcur->pos_y, delta_time);
-		cpymo_tween_update(&pcur->alpha, delta_time);
-
-		pcur = pcur->next;
-	}
+	cpymo_charas *c = &e->charas;
+	bool finished = cpymo_charas_update_tweens(c->pos_x, c->count, delta_time, forward_key_pressed);
+	finished &= cpymo_charas_update_tweens(c->pos_y, c->count, delta_time, forward_key_pressed);
+	finished &= cpymo_charas_update_tweens(c->alpha, c->count, delta_time, forward_key_pressed);
 
 	cpymo_charas_gc(&e->charas, false);
 
-	return !waiting;
+	return finished;
 }
 
 static inline float smooth_alpha(float x) {
@@ -78,12 +134,13 @@ static inline float smooth_alpha(float x) {
 void cpymo_charas_draw(const cpymo_engine *e)
 {
 	const cpymo_charas *c = &e->charas;
-	const struct cpymo_chara *pcur = c->chara;
 
-	while (pcur) {
+	for (size_t i = 0; i < c->count; ++i) {
+		const struct cpymo_chara *ch = &c->chara[i];
+
 		float anime_offset_x = 0;
 		float anime_offset_y = 0;
-		if (pcur->play_anime) {
+		if (ch->play_anime) {
 			assert(c->anime_pos != NULL);
 			assert(c->anime_pos_current * 2 + 1 < c->anime_pos_count * 2);
 			anime_offset_x = c->anime_pos[c->anime_pos_current * 2] * (float)e->gameconfig.imagesize_w / 540.0f;
@@ -91,25 +148,23 @@ void cpymo_charas_draw(const cpymo_engine *e)
 		}
 
 		cpymo_backend_image_draw(
-			cpymo_tween_value(&pcur->pos_x) + anime_offset_x,
-			cpymo_tween_value(&pcur->pos_y) + anime_offset_y,
-			(float)pcur->img_w,
-			(float)pcur->img_h,
-			pcur->img,
+			cpymo_tween_value(&c->pos_x[i]) + anime_offset_x,
+			cpymo_tween_value(&c->pos_y[i]) + anime_offset_y,
+			(float)ch->img_w,
+			(float)ch->img_h,
+			ch->img,
 			0,
 			0,
-			pcur->img_w,
-			pcur->img_h,
-			smooth_alpha(cpymo_tween_value(&pcur->alpha)),
+			ch->img_w,
+			ch->img_h,
+			smooth_alpha(cpymo_tween_value(&c->alpha[i])),
 			cpymo_backend_image_draw_type_chara);
-
-		pcur = pcur->next;
 	}
 }
 
 error_t cpymo_chara_convert_to_mode0_pos(
 	cpymo_engine *e,
-	struct cpymo_chara *c,
+	const struct cpymo_chara *c,
 	int coord_mode,
 	float *x, float *y)
 {
@@ -143,144 +198,133 @@ error_t cpymo_chara_convert_to_mode0_pos(
 	return CPYMO_ERR_SUCC;
 }
 
+static error_t cpymo_charas_reserve(cpymo_charas *c)
+{
+	if (c->count < c->capacity) return CPYMO_ERR_SUCC;
+
+	const size_t capacity = c->capacity ? c->capacity * 2 : 8;
+
+	#define GROW(FIELD, TYPE) { \
+		TYPE *p = (TYPE *)realloc(c->FIELD, capacity * sizeof(TYPE)); \
+		if (p == NULL) return CPYMO_ERR_OUT_OF_MEM; \
+		c->FIELD = p; \
+	}
+
+	GROW(chara, struct cpymo_chara);
+	GROW(pos_x, cpymo_tween);
+	GROW(pos_y, cpymo_tween);
+	GROW(alpha, cpymo_tween);
+
+	#undef GROW
+
+	c->capacity = capacity;
+	return CPYMO_ERR_SUCC;
+}
+
 error_t cpymo_charas_new_chara(
 	cpymo_engine *e, 
-	struct cpymo_chara **out, 
 	cpymo_str filename, 
 	int chara_id, int layer, 
 	int coord_mode, float x, float y, 
 	float begin_alpha, float time)
 {
-	struct cpymo_chara *ch = NULL;
-	error_t err = cpymo_charas_find(&e->charas, &ch, chara_id);
-	if (err == CPYMO_ERR_SUCC) {
-		ch->alive = false;
-		cpymo_tween_to(&ch->alpha, 0, time);
-	}
+	cpymo_charas *c = &e->charas;
+
+	size_t old;
+	if (cpymo_charas_find(c, &old, chara_id) == CPYMO_ERR_SUCC)
+		cpymo_charas_die(c, old, time);
 
-	ch = (struct cpymo_chara *)cpymo_utils_malloc_trim_memory(
-		e, sizeof(struct cpymo_chara) + filename.len + 1);
-	if (ch == NULL) return CPYMO_ERR_OUT_OF_MEM;
-	cpymo_str_copy(ch->chara_name, filename.len + 1, filename);
+	cpymo_memory_reserve(e, cpymo_memory_chara, 0);
 
-	err = cpymo_assetloader_load_chara_image(
-		&ch->img, &ch->img_w, &ch->img_h, filename, &e->assetloader);
+	struct cpymo_chara ch;
+	ch.chara_name = cpymo_str_copy_malloc_trim_memory(e, filename);
+	if (ch.chara_name == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+	error_t err = cpymo_assetloader_load_chara_image(
+		&ch.img, &ch.img_w, &ch.img_h, filename, &e->assetloader);
 	if (err == CPYMO_ERR_OUT_OF_MEM) {
 		cpymo_engine_trim_memory(e);
 		err = cpymo_assetloader_load_chara_image(
-			&ch->img, &ch->img_w, &ch->img_h, filename, &e->assetloader);
+			&ch.img, &ch.img_w, &ch.img_h, filename, &e->assetloader);
 	}
 	if (err != CPYMO_ERR_SUCC) {
-		free(ch);
+		free(ch.chara_name);
 
 		if (err == CPYMO_ERR_NOT_FOUND || err == CPYMO_ERR_CAN_NOT_OPEN_FILE) {
 			char name[32];
 			cpymo_str_copy(name, sizeof(name), filename);
 			printf("[Error] Can not load chara \"%s\".\n", name);
+			e->stats.missing_assets++;
 			return CPYMO_ERR_SUCC;
 		}
 
 		return err;
 	}
 
-	err = cpymo_chara_convert_to_mode0_pos(e, ch, coord_mode, &x, &y);
+	err = cpymo_chara_convert_to_mode0_pos(e, &ch, coord_mode, &x, &y);
+	if (err == CPYMO_ERR_SUCC) err = cpymo_charas_reserve(c);
 	if (err != CPYMO_ERR_SUCC) {
-		cpymo_backend_image_free(ch->img);
-		free(ch);
+		cpymo_charas_free_chara(&ch);
 		return err;
 	}
 
-	ch->play_anime = false;
-	ch->chara_id = chara_id;
-	ch->layer = layer;
-	ch->alive = true;
-	ch->next = NULL;
-	cpymo_tween_assign(&ch->pos_x, x);
-	cpymo_tween_assign(&ch->pos_y, y);
-	cpymo_tween_assign(&ch->alpha, begin_alpha);
+	ch.play_anime = false;
+	ch.chara_id = chara_id;
+	ch.layer = layer;
+	ch.alive = true;
+
+	size_t at = c->count;
+	while (at > 0 && c->chara[at - 1].layer > layer) at--;
+
+	const size_t moved = c->count - at;
+	memmove(c->chara + at + 1, c->chara + at, moved * sizeof(c->chara[0]));
+	memmove(c->pos_x + at + 1, c->pos_x + at, moved * sizeof(c->pos_x[0]));
+	memmove(c->pos_y + at + 1, c->pos_y + at, moved * sizeof(c->pos_y[0]));
+	memmove(c->alpha + at + 1, c->alpha + at, moved * sizeof(c->alpha[0]));
+	c->count++;
+
+	c->chara[at] = ch;
+	cpymo_tween_assign(&c->pos_x[at], x);
+	cpymo_tween_assign(&c->pos_y[at], y);
+	cpymo_tween_assign(&c->alpha[at], begin_alpha);
 #ifdef LOW_FRAME_RATE
-	cpymo_tween_assign(&ch->alpha, 1.0f);
+	cpymo_tween_assign(&c->alpha[at], 1.0f);
 #else
-	cpymo_tween_to(&ch->alpha, 1.0f, time);
+	cpymo_tween_to(&c->alpha[at], 1.0f, time);
 #endif
 
-
-	if (e->charas.chara == NULL) {
-		e->charas.chara = ch;
-	}
-	else if (e->charas.chara->layer > layer) {
-		if (e->charas.chara->layer >= layer) {
-			ch->next = e->charas.chara;
-			e->charas.chara = ch;
-		}
-		else {
-			e->charas.chara = ch;
-		}
-	}
-	else {
-		struct cpymo_chara *prev = e->charas.chara;
-		while (prev) {
-			struct cpymo_chara *next = prev->next;
-
-			if (next == NULL) {
-				prev->next = ch;
-				break;
-			}
-			else if (prev->layer <= layer && next->layer >= layer) {
-				ch->next = prev->next;
-				prev->next = ch;
-				break;
-			}
-			else prev = prev->next;
-		}
-	}
-	
-
-	*out = ch;
-
-	//print_charas(&e->charas);
+	cpymo_charas_reindex(c, at);
 
 	return CPYMO_ERR_SUCC;
 }
 
-error_t cpymo_charas_find(cpymo_charas * c, struct cpymo_chara ** out, int chara_id)
+error_t cpymo_charas_find(const cpymo_charas * c, size_t * out, int chara_id)
 {
-	assert(*out == NULL);
-
-	struct cpymo_chara *pcur = c->chara;
-	while (pcur) {
-		if (pcur->chara_id == chara_id && pcur->alive) {
-			*out = pcur;
-			return CPYMO_ERR_SUCC;
-		}
-
-		pcur = pcur->next;
-	}
+	cpymo_charas_index_entry *index = (cpymo_charas_index_entry *)c->index;
+	ptrdiff_t i = hmgeti(index, chara_id);
+	if (i < 0) return CPYMO_ERR_NOT_FOUND;
 
-	return CPYMO_ERR_NOT_FOUND;
+	*out = index[i].value;
+	return CPYMO_ERR_SUCC;
 }
 
 error_t cpymo_charas_kill(cpymo_engine *e, int chara_id, float time)
 {
-	struct cpymo_chara *ch = NULL;
-	error_t err = cpymo_charas_find(&e->charas, &ch, chara_id);
+	size_t i;
+	error_t err = cpymo_charas_find(&e->charas, &i, chara_id);
 	CPYMO_THROW(err);
 
-	ch->alive = false;
-	cpymo_tween_to(&ch->alpha, 0, time);
+	cpymo_charas_die(&e->charas, i, time);
 
 	return CPYMO_ERR_SUCC;
 }
 
 static void cpymo_charas_stop_all_tween(cpymo_engine *e)
 {
-	struct cpymo_chara *chara = e->charas.chara;
-	while (chara) {
-		cpymo_tween_finish(&chara->pos_x);
-		cpymo_tween_finish(&chara->pos_y);
-		cpymo_tween_finish(&chara->alpha);
-		chara = chara->next;
-	}
+	cpymo_charas *c = &e->charas;
+	cpymo_charas_update_tweens(c->pos_x, c->count, 0, true);
+	cpymo_charas_update_tweens(c->pos_y, c->count, 0, true);
+	cpymo_charas_update_tweens(c->alpha, c->count, 0, true);
 
 	cpymo_charas_gc(&e->charas, false);
 }
@@ -295,15 +339,17 @@ void cpymo_charas_wait(cpymo_engine *e)
 
 void cpymo_charas_kill_all(cpymo_engine *e, float time)
 {
-	struct cpymo_chara *ch = e->charas.chara;
-	while (ch) {
-		if (ch->alive) {
-			ch->alive = false;
-			cpymo_tween_to(&ch->alpha, 0, time);
+	cpymo_charas *c = &e->charas;
+	for (size_t i = 0; i < c->count; ++i) {
+		if (c->chara[i].alive) {
+			c->chara[i].alive = false;
+			cpymo_tween_to(&c->alpha[i], 0, time);
 		}
-
-		ch = ch->next;
 	}
+
+	cpymo_charas_index_entry *index = (cpymo_charas_index_entry *)c->index;
+	hmfree(index);
+	c->index = NULL;
 }
 
 void cpymo_charas_fast_kill_all(cpymo_charas * c)
@@ -314,15 +360,15 @@ void cpymo_charas_fast_kill_all(cpymo_charas * c)
 
 error_t cpymo_charas_pos(cpymo_engine *e, int chara_id, int coord_mode, float x, float y)
 {
-	struct cpymo_chara *c = NULL;
-	error_t err = cpymo_charas_find(&e->charas, &c, chara_id);
+	size_t i;
+	error_t err = cpymo_charas_find(&e->charas, &i, chara_id);
 	CPYMO_THROW(err);
 
-	err = cpymo_chara_convert_to_mode0_pos(e, c, coord_mode, &x, &y);
+	err = cpymo_chara_convert_to_mode0_pos(e, &e->charas.chara[i], coord_mode, &x, &y);
 	CPYMO_THROW(err);
 
-	cpymo_tween_assign(&c->pos_x, x);
-	cpymo_tween_assign(&c->pos_y, y);
+	cpymo_tween_assign(&e->charas.pos_x[i], x);
+	cpymo_tween_assign(&e->charas.pos_y[i], y);
 
 	cpymo_engine_request_redraw(e);
 
@@ -336,17 +382,14 @@ static void cpymo_charas_stop_all_anime(cpymo_engine *e)
 #endif
 
 	cpymo_charas *c = &e->charas;
-	struct cpymo_chara *ch = c->chara;
 	
 	float last_pos_x = c->anime_pos[(c->anime_pos_count - 1) * 2] * (float)e->gameconfig.imagesize_w / 540.0f;
 	float last_pos_y = c->anime_pos[(c->anime_pos_count - 1) * 2 + 1] * (float)e->gameconfig.imagesize_h / 360.0f;
 
-	while (ch) {
-		ch->play_anime = false;
-		cpymo_tween_assign(&ch->pos_x, last_pos_x + cpymo_tween_value(&ch->pos_x));
-		cpymo_tween_assign(&ch->pos_y, last_pos_y + cpymo_tween_value(&ch->pos_y));
-
-		ch = ch->next;
+	for (size_t i = 0; i < c->count; ++i) {
+		c->chara[i].play_anime = false;
+		cpymo_tween_assign(&c->pos_x[i], last_pos_x + cpymo_tween_value(&c->pos_x[i]));
+		cpymo_tween_assign(&c->pos_y[i], last_pos_y + cpymo_tween_value(&c->pos_y[i]));
 	}
 
 	if (c->anime_owned && c->anime_pos)
@@ -365,9 +408,9 @@ void cpymo_charas_set_play_anime(cpymo_charas * c, int id)
 #ifdef LOW_FRAME_RATE
 	return;
 #endif
-	struct cpymo_chara *ch = NULL;
-	if (cpymo_charas_find(c, &ch, id) == CPYMO_ERR_SUCC)
-		ch->play_anime = true;
+	size_t i;
+	if (cpymo_charas_find(c, &i, id) == CPYMO_ERR_SUCC)
+		c->chara[i].play_anime = true;
 }
 
 void cpymo_charas_set_all_chara_play_anime(cpymo_charas *c)
@@ -375,11 +418,8 @@ void cpymo_charas_set_all_chara_play_anime(cpymo_charas *c)
 #ifdef LOW_FRAME_RATE
 	return;
 #endif
-	struct cpymo_chara *ch = c->chara;
-	while (ch) {
-		ch->play_anime = true;
-		ch = ch->next;
-	}
+	for (size_t i = 0; i < c->count; ++i)
+		c->chara[i].play_anime = true;
 }
 
 static error_t cpymo_charas_anime_finished_callback(cpymo_engine *e)
@@ -12,18 +12,23 @@ struct cpymo_chara {
 	
 	cpymo_backend_image img;
 	bool alive;
-	cpymo_tween pos_x, pos_y, alpha;
 	int img_w, img_h;
 
 	bool play_anime;
 
-	struct cpymo_chara *next;
-
-	char chara_name[];
+	char *chara_name;
 };
 
+// Charas are sorted by layer, a new chara goes after those in its layer.
+// Tweens of chara[i] are pos_x[i], pos_y[i] and alpha[i],
+// kept apart so waiting for them is a linear pass over each.
 typedef struct {
 	struct cpymo_chara *chara;
+	cpymo_tween *pos_x, *pos_y, *alpha;
+	size_t count, capacity;
+
+	// Alive chara id to its index.
+	void *index;
 
 	float *anime_pos;
 	int anime_loop;
@@ -36,6 +41,9 @@ typedef struct {
 static inline void cpymo_charas_init(cpymo_charas *cpymo_charas)
 { 
 	cpymo_charas->chara = NULL;
+	cpymo_charas->pos_x = cpymo_charas->pos_y = cpymo_charas->alpha = NULL;
+	cpymo_charas->count = cpymo_charas->capacity = 0;
+	cpymo_charas->index = NULL;
 	cpymo_charas->anime_pos = NULL;
 	cpymo_charas->anime_owned = false;
 	cpymo_charas->anime_pos_current = 0;
@@ -43,18 +51,22 @@ static inline void cpymo_charas_init(cpymo_charas *cpymo_charas)
 
 void cpymo_charas_free(cpymo_charas *);
 
+size_t cpymo_charas_memory_usage(const cpymo_charas *);
+
 void cpymo_charas_draw(const struct cpymo_engine *);
 
+// A missing image is reported and skipped.
 error_t cpymo_charas_new_chara(
-	struct cpymo_engine *, struct cpymo_chara **out,
+	struct cpymo_engine *,
 	cpymo_str filename,
 	int chara_id, int layer,
 	int coord_mode,
 	float x, float y,
 	float begin_alpha, float time);
 
+// Index of an alive chara, valid until charas are added or collected.
 error_t cpymo_charas_find(
-	cpymo_charas *, struct cpymo_chara **out,
+	const cpymo_charas *, size_t *out,
 	int chara_id);
 
 error_t cpymo_charas_kill(
@@ -64,7 +76,7 @@ error_t cpymo_charas_kill(
 
 error_t cpymo_chara_convert_to_mode0_pos(
 	struct cpymo_engine *e,
-	struct cpymo_chara *c,
+	const struct cpymo_chara *c,
 	int coord_mode,
 	float *x, float *y);
 
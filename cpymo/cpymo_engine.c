@@ -8,11 +8,13 @@
 #include "cpymo_msgbox_ui.h"
 #include "cpymo_save_global.h"
 #include "cpymo_localization.h"
+#include "cpymo_trace.h"
+#include "cpymo_atomic.h"
 
 static void cpymo_logo() {
-	static bool logo_printed = false;
-	if (logo_printed) return;
-	logo_printed = true;
+	// Once per process, even with engines starting on several threads.
+	static volatile long logo_printed = 0;
+	if (cpymo_atomic_long_increment(&logo_printed) != 1) return;
 
 	puts("   __________        __  _______");
 	puts("  / ____/ __ \\__  __/  |/  / __ \\");
@@ -48,8 +50,13 @@ static error_t cpymo_engine_version_warning(cpymo_engine *e)
 	return err;
 }
 
-error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
+static error_t cpymo_engine_init_internal(cpymo_engine *out, const char *gamedir)
 {
+	cpymo_memory_init(&out->memory);
+	memset(&out->stats, 0, sizeof(out->stats));
+	cpymo_engine_seed(out, (uint32_t)rand());
+	out->replay = NULL;
+
 	// init audio system
 	cpymo_audio_init(&out->audio);
 
@@ -77,13 +84,18 @@ error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
 	err = cpymo_assetloader_init(&out->assetloader, &out->gameconfig, gamedir);
 	if (err != CPYMO_ERR_SUCC) return err;
 
+	// create arena
+	cpymo_arena_init(&out->arena, CPYMO_ARENA_SIZE);
+	out->assetloader.arena = &out->arena;
+
 	// create vars
-	cpymo_vars_init(&out->vars);
+	cpymo_vars_init(&out->vars, &out->arena);
 
 	// create script interpreter
 	out->interpreter = (cpymo_interpreter *)malloc(sizeof(cpymo_interpreter));
 	if (out->interpreter == NULL) {
 		cpymo_assetloader_free(&out->assetloader);
+		cpymo_arena_free(&out->arena);
 		return CPYMO_ERR_OUT_OF_MEM;
 	}
 
@@ -93,6 +105,7 @@ error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
 		free(out->interpreter);
 		cpymo_vars_free(&out->vars);
 		cpymo_assetloader_free(&out->assetloader);
+		cpymo_arena_free(&out->arena);
 		return err;
 	}
 
@@ -105,6 +118,7 @@ error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
 		free(out->interpreter);
 		cpymo_vars_free(&out->vars);
 		cpymo_assetloader_free(&out->assetloader);
+		cpymo_arena_free(&out->arena);
 		return CPYMO_ERR_OUT_OF_MEM;
 	}
 	out->title[0] = '\0';
@@ -156,12 +170,14 @@ error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
 		free(out->interpreter);
 		cpymo_vars_free(&out->vars);
 		cpymo_assetloader_free(&out->assetloader);
+		cpymo_arena_free(&out->arena);
 		return err;
 	}
 
 	// states
 	out->skipping = false;
 	out->redraw = true;
+	out->deadline = 0;
 	out->ignore_next_mouse_button_flag = false;
 
 	// default config
@@ -174,6 +190,14 @@ error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
 	out->text_extract_buffer_maxsize = 0;
 	#endif
 
+	#ifdef ENABLE_PROFILER
+	err = cpymo_profiler_create(&out->profiler);
+	if (err != CPYMO_ERR_SUCC) {
+		printf("[Warning] Can not create profiler: %s\n", cpymo_error_message(err));
+		out->profiler = NULL;
+	}
+	#endif
+
 	// load config
 	err = cpymo_save_config_load(out);
 	if (err != CPYMO_ERR_SUCC && err != CPYMO_ERR_CAN_NOT_OPEN_FILE) {
@@ -209,8 +233,30 @@ error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
 	return CPYMO_ERR_SUCC;
 }
 
+error_t cpymo_engine_init(cpymo_engine *out, const char *gamedir)
+{
+	#ifdef ENABLE_TRACE
+	if (cpymo_trace_open(gamedir) != CPYMO_ERR_SUCC)
+		printf("[Warning] Can not create trace.json.\n");
+	#endif
+
+	error_t err = cpymo_engine_init_internal(out, gamedir);
+
+	#ifdef ENABLE_TRACE
+	if (err != CPYMO_ERR_SUCC) cpymo_trace_close();
+	else out->trace_opened = true;
+	#endif
+
+	return err;
+}
+
 void cpymo_engine_free(cpymo_engine *engine)
 {
+	#ifdef ENABLE_MEMORY_REPORT
+	cpymo_memory_update(engine);
+	cpymo_memory_report(&engine->memory);
+	#endif
+
 	while (engine->ui) cpymo_ui_exit(engine);
 
 	if (engine->assetloader.gamedir) {
@@ -221,6 +267,12 @@ void cpymo_engine_free(cpymo_engine *engine)
 		err = cpymo_save_config_save(engine);
 		if (err != CPYMO_ERR_SUCC)
 			printf("[Error] Can not save config. %s\n", cpymo_error_message(err));
+
+		#ifdef ENABLE_PROFILER
+		err = cpymo_profiler_dump_csv(engine->profiler, engine->assetloader.gamedir);
+		if (err != CPYMO_ERR_SUCC)
+			printf("[Error] Can not write profiler.csv. %s\n", cpymo_error_message(err));
+		#endif
 	}
 	
 	cpymo_hash_flags_free(&engine->flags);
@@ -238,13 +290,27 @@ void cpymo_engine_free(cpymo_engine *engine)
 		free(engine->interpreter);
 	}
 	cpymo_vars_free(&engine->vars);
+
+	// Streamed BGM reads packages from the decoder thread,
+	// stop it before packages are closed.
+	cpymo_audio_free(&engine->audio);
 	cpymo_assetloader_free(&engine->assetloader);
+	cpymo_arena_free(&engine->arena);
 	if (engine->title) free(engine->title);
-	cpymo_audio_free(&engine->audio);
 
 	#ifdef ENABLE_TEXT_EXTRACT
 	if (engine->text_extract_buffer) free(engine->text_extract_buffer);
 	#endif
+
+	#ifdef ENABLE_PROFILER
+	cpymo_profiler_free(engine->profiler);
+	engine->profiler = NULL;
+	#endif
+
+	#ifdef ENABLE_TRACE
+	if (engine->trace_opened) cpymo_trace_close();
+	engine->trace_opened = false;
+	#endif
 }
 
 bool cpymo_engine_skipping(cpymo_engine *e)
@@ -264,6 +330,73 @@ void cpymo_engine_request_redraw(cpymo_engine *engine)
 	engine->redraw = true;
 }
 
+void cpymo_engine_seed(cpymo_engine *engine, uint32_t seed)
+{
+	// xorshift never leaves zero.
+	engine->rng = seed ? seed : 0x9e3779b9;
+}
+
+int cpymo_engine_rand(cpymo_engine *engine)
+{
+	uint32_t x = engine->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	engine->rng = x;
+	return (int)(x >> 1);
+}
+
+cpymo_replay_config cpymo_engine_replay_config(const cpymo_engine *engine)
+{
+	cpymo_replay_config config;
+	config.fontsize = (uint16_t)engine->gameconfig.fontsize;
+	config.textspeed = (uint16_t)engine->gameconfig.textspeed;
+	config.skip_already_read_only = engine->config_skip_already_read_only;
+	return config;
+}
+
+void cpymo_engine_attach_replay(cpymo_engine *engine, cpymo_replay *replay)
+{
+	cpymo_engine_seed(engine, replay->seed);
+
+	if (replay->mode == cpymo_replay_play) {
+		engine->gameconfig.fontsize = replay->config.fontsize;
+		engine->gameconfig.textspeed = replay->config.textspeed;
+		engine->config_skip_already_read_only = replay->config.skip_already_read_only;
+	}
+
+	engine->replay = replay;
+}
+
+bool cpymo_engine_audio_state(cpymo_engine *engine, bool live)
+{
+	return engine->replay ? cpymo_replay_audio_state(engine->replay, live) : live;
+}
+
+void cpymo_engine_request_deadline(cpymo_engine *engine, float seconds)
+{
+	if (seconds < 0) seconds = 0;
+	if (seconds < engine->deadline) engine->deadline = seconds;
+}
+
+float cpymo_engine_get_deadline(const cpymo_engine *engine)
+{
+	return engine->deadline;
+}
+
+static bool cpymo_engine_input_held(const cpymo_input *input)
+{
+	return input->mouse_button
+		|| input->up
+		|| input->down
+		|| input->left
+		|| input->right
+		|| input->ok
+		|| input->cancel
+		|| input->skip
+		|| input->hide_window;
+}
+
 static error_t cpymo_engine_exit_update(
 	struct cpymo_engine *e, void *ui_data, float d)
 { return CPYMO_ERR_NO_MORE_CONTENT; }
@@ -282,10 +415,28 @@ error_t cpymo_engine_update(cpymo_engine *engine, float delta_time_sec, bool * r
 {
 	error_t err = CPYMO_ERR_SUCC;
 	*redraw |= engine->redraw; engine->redraw = false;
+	engine->deadline = CPYMO_WAIT_NO_DEADLINE;
+	cpymo_arena_reset(&engine->arena);
 
+	#ifdef ENABLE_PROFILER
+	if (cpymo_profiler_frame(engine->profiler, delta_time_sec))
+		cpymo_engine_request_redraw(engine);
+	#endif
+
+	CPYMO_PROFILER_BEGIN(engine, input);
 	engine->prev_input = engine->input;
 	engine->input = cpymo_input_snapshot();
 
+	if (engine->replay) {
+		err = cpymo_replay_frame(engine->replay, &engine->input, &delta_time_sec);
+		CPYMO_THROW(err);
+	}
+
+	cpymo_audio_telemetry_update(&engine->audio, delta_time_sec);
+	CPYMO_PROFILER_END(engine, input);
+
+	cpymo_memory_update(engine);
+
 	if (!engine->prev_input.mouse_button && !engine->input.mouse_button)
 		engine->ignore_next_mouse_button_flag = false;
 
@@ -307,32 +458,42 @@ error_t cpymo_engine_update(cpymo_engine *engine, float delta_time_sec, bool * r
 	if (engine->input.hide_window != engine->prev_input.hide_window)
 		cpymo_engine_request_redraw(engine);
 
-	if (cpymo_ui_enabled(engine))
+	if (cpymo_ui_enabled(engine)) {
+		CPYMO_PROFILER_BEGIN(engine, ui);
 		err = cpymo_ui_update(engine, delta_time_sec);
+		CPYMO_PROFILER_END(engine, ui);
+	}
 	else {
-
+		CPYMO_PROFILER_BEGIN(engine, anime);
 		cpymo_anime_update(
 			engine, 
 			&engine->anime, 
 			delta_time_sec);
+		CPYMO_PROFILER_END(engine, anime);
 
+		CPYMO_PROFILER_BEGIN(engine, select_img);
 		err = cpymo_select_img_update(
 			engine, 
 			&engine->select_img, 
 			delta_time_sec);
+		CPYMO_PROFILER_END(engine, select_img);
 		CPYMO_THROW(err);
 
+		CPYMO_PROFILER_BEGIN(engine, wait);
 		err = cpymo_wait_update(
 			&engine->wait, 
 			engine, 
 			delta_time_sec);
+		CPYMO_PROFILER_END(engine, wait);
 		CPYMO_THROW(err);
 
 		if (!cpymo_wait_is_wating(&engine->wait)) {
+			CPYMO_PROFILER_BEGIN(engine, interpreter);
 			if (engine->interpreter)
 				err = cpymo_interpreter_execute_step(
 					engine->interpreter, engine);
 			else return CPYMO_ERR_NO_MORE_CONTENT;
+			CPYMO_PROFILER_END(engine, interpreter);
 
 			if (cpymo_wait_is_wating(&engine->wait)) {
 				if (err == CPYMO_ERR_NO_MORE_CONTENT) 
@@ -341,37 +502,81 @@ error_t cpymo_engine_update(cpymo_engine *engine, float delta_time_sec, bool * r
 
 			CPYMO_THROW(err);
 		}
+
+		// Script runs on next frame, a wait runs when it asked to.
+		if (cpymo_wait_is_wating(&engine->wait) && engine->wait.deadline >= 0)
+			cpymo_engine_request_deadline(engine, engine->wait.deadline);
+		else cpymo_engine_request_deadline(engine, 0);
 	}
 
 	*redraw |= engine->redraw; engine->redraw = false;
 
+	// UI, animations and held keys are updated every frame.
+	if (cpymo_ui_enabled(engine) 
+		|| *redraw 
+		|| engine->skipping
+		|| cpymo_engine_input_held(&engine->input))
+		cpymo_engine_request_deadline(engine, 0);
+
 	return err;
 }
 
-void cpymo_engine_draw(const cpymo_engine *engine)
+static void cpymo_engine_draw_scene(const cpymo_engine *engine)
 {
-	if (cpymo_ui_enabled(engine)) {
-		cpymo_ui_draw(engine);
-		return;
-	}
-
+	CPYMO_PROFILER_BEGIN(engine, draw_bg);
 	cpymo_bg_draw(engine);
+	CPYMO_PROFILER_END(engine, draw_bg);
+
+	CPYMO_PROFILER_BEGIN(engine, draw_scroll);
 	cpymo_scroll_draw(&engine->scroll);
+	CPYMO_PROFILER_END(engine, draw_scroll);
+
+	CPYMO_PROFILER_BEGIN(engine, draw_charas);
 	cpymo_charas_draw(engine);
+	CPYMO_PROFILER_END(engine, draw_charas);
+
+	CPYMO_PROFILER_BEGIN(engine, draw_anime);
 	cpymo_anime_draw(&engine->anime);
+	CPYMO_PROFILER_END(engine, draw_anime);
+
+	CPYMO_PROFILER_BEGIN(engine, draw_select_img);
 	cpymo_select_img_draw(
 		&engine->select_img, 
 		engine->gameconfig.imagesize_w, 
 		engine->gameconfig.imagesize_h,
 		engine->gameconfig.grayselected);
+	CPYMO_PROFILER_END(engine, draw_select_img);
 
 	cpymo_floating_hint_draw(&engine->floating_hint);
+
+	// Screen effects are counted as fade.
+	CPYMO_PROFILER_BEGIN(engine, draw_fade);
 	cpymo_flash_draw(engine);
 	cpymo_bg_draw_transform_effect(engine);
 	cpymo_fade_draw(engine);
+	CPYMO_PROFILER_END(engine, draw_fade);
 
+	CPYMO_PROFILER_BEGIN(engine, draw_textbox);
 	cpymo_text_draw(engine);
 	cpymo_say_draw(engine);
+	CPYMO_PROFILER_END(engine, draw_textbox);
+}
+
+void cpymo_engine_draw(const cpymo_engine *engine)
+{
+	if (cpymo_ui_enabled(engine)) {
+		CPYMO_PROFILER_BEGIN(engine, draw_ui);
+		cpymo_ui_draw(engine);
+		CPYMO_PROFILER_END(engine, draw_ui);
+	}
+	else cpymo_engine_draw_scene(engine);
+
+	#ifdef ENABLE_PROFILER
+	cpymo_profiler_draw_overlay(
+		engine->profiler,
+		(float)engine->gameconfig.imagesize_w,
+		(float)engine->gameconfig.imagesize_h);
+	#endif
 }
 
 void cpymo_engine_trim_memory(cpymo_engine *e)
@@ -386,6 +591,9 @@ void cpymo_engine_trim_memory(cpymo_engine *e)
 
 	cpymo_audio_se_stop(e);
 	cpymo_audio_vo_stop(e);
+	cpymo_audio_trim(&e->audio);
+
+	cpymo_backlog_trim(&e->backlog);
 
 	#ifdef ENABLE_TEXT_EXTRACT
 	e->text_extract_buffer_size = 0;
@@ -22,6 +22,18 @@
 #include "cpymo_ui.h"
 #include "cpymo_audio.h"
 #include "cpymo_backlog.h"
+#include "cpymo_profiler.h"
+#include "cpymo_memory.h"
+#include "cpymo_arena.h"
+#include "cpymo_replay.h"
+
+// What a playthrough ran into, counted for reports of headless runs.
+typedef struct {
+	size_t commands;
+	size_t script_errors;
+	size_t missing_assets;
+	size_t missing_labels;
+} cpymo_engine_stats;
 
 struct cpymo_engine {
 	cpymo_gameconfig gameconfig;
@@ -44,6 +56,18 @@ struct cpymo_engine {
 	struct cpymo_ui *ui;
 	cpymo_audio_system audio;
 	cpymo_backlog backlog;
+	cpymo_memory memory;
+
+	// Transient allocations, reset when every update begins.
+	cpymo_arena arena;
+
+	cpymo_engine_stats stats;
+
+	// Generator behind #rand, so runs with the same seed draw the same numbers.
+	uint32_t rng;
+
+	// Set by cpymo_engine_attach_replay after init, owned by backend.
+	cpymo_replay *replay;
 
 	bool skipping;
 	char *title;
@@ -51,8 +75,20 @@ struct cpymo_engine {
 	bool redraw;
 	bool ignore_next_mouse_button_flag;
 
+	// Seconds until the next update is needed if no input arrives.
+	float deadline;
+
 	bool config_skip_already_read_only;
 
+#ifdef ENABLE_PROFILER
+	cpymo_profiler *profiler;
+#endif
+
+#ifdef ENABLE_TRACE
+	// Only engines with a game hold a reference to trace.json.
+	bool trace_opened;
+#endif
+
 #ifdef ENABLE_TEXT_EXTRACT
 	char *text_extract_buffer;
 	size_t text_extract_buffer_size, text_extract_buffer_maxsize;
@@ -70,6 +106,25 @@ bool cpymo_engine_skipping(cpymo_engine *engine);
 
 void cpymo_engine_trim_memory(cpymo_engine *e);
 void cpymo_engine_request_redraw(cpymo_engine *engine);
+
+// Engines are seeded from rand() on init, backends may seed them again.
+void cpymo_engine_seed(cpymo_engine *engine, uint32_t seed);
+int cpymo_engine_rand(cpymo_engine *engine);
+
+cpymo_replay_config cpymo_engine_replay_config(const cpymo_engine *engine);
+
+// Seeds the engine from the replay, a played replay also applies its config.
+void cpymo_engine_attach_replay(cpymo_engine *engine, cpymo_replay *replay);
+
+// Audio state which script flow depends on, taken from the replay if any.
+bool cpymo_engine_audio_state(cpymo_engine *engine, bool live);
+
+// For timers outside of cpymo_wait, during cpymo_engine_update.
+void cpymo_engine_request_deadline(cpymo_engine *engine, float seconds);
+
+// Seconds the backend may sleep until it calls cpymo_engine_update again,
+// unless input arrives first. CPYMO_WAIT_NO_DEADLINE if only input can wake it.
+float cpymo_engine_get_deadline(const cpymo_engine *engine);
 void cpymo_engine_exit(cpymo_engine *e);
 
 #define CPYMO_INPUT_JUST_PRESSED(PENGINE, KEY) \
@@ -362,6 +362,10 @@ error_t cpymo_engine_init_with_game_selector(
 	cpymo_game_selector_callback after_reinit,
 	char **last_selected_game_dir_movein)
 {
+	cpymo_memory_init(&e->memory);
+	memset(&e->stats, 0, sizeof(e->stats));
+	cpymo_engine_seed(e, (uint32_t)rand());
+	e->replay = NULL;
 	cpymo_audio_init(&e->audio);
 
 	error_t err = cpymo_gameconfig_parse(&e->gameconfig, "", 0);
@@ -372,13 +376,17 @@ error_t cpymo_engine_init_with_game_selector(
 	e->gameconfig.fontsize = (uint16_t)fontsize_;
 
 	e->assetloader.use_pkg_bg = false;
+	e->assetloader.use_pkg_bgm = false;
 	e->assetloader.use_pkg_chara = false;
 	e->assetloader.use_pkg_se = false;
 	e->assetloader.use_pkg_voice = false;
 	e->assetloader.game_config = &e->gameconfig;
 	e->assetloader.gamedir = NULL;
+
+	cpymo_arena_init(&e->arena, CPYMO_ARENA_SIZE);
+	e->assetloader.arena = &e->arena;
 	
-	cpymo_vars_init(&e->vars);
+	cpymo_vars_init(&e->vars, &e->arena);
 	e->interpreter = NULL;
 	e->title = NULL;
 
@@ -399,6 +407,14 @@ error_t cpymo_engine_init_with_game_selector(
 	e->skipping = false;
 	e->redraw = true;
 
+	#ifdef ENABLE_PROFILER
+	e->profiler = NULL;
+	#endif
+
+	#ifdef ENABLE_TRACE
+	e->trace_opened = false;
+	#endif
+
 	e->input = e->prev_input = cpymo_input_snapshot();
 
 	cpymo_game_selector_lazy_init *d = NULL;
@@ -17,6 +17,11 @@
 
 #define CHARA_BUF_SIZE 64
 
+// Lines after current one searched for a #vo to prepare.
+#ifndef CPYMO_INTERPRETER_VO_LOOKAHEAD
+#define CPYMO_INTERPRETER_VO_LOOKAHEAD 8
+#endif
+
 void cpymo_interpreter_init(
 	cpymo_interpreter *out, 
 	cpymo_script *script, 
@@ -117,7 +122,9 @@ RETRY:
 					cpymo_str_copy(label_name, sizeof(label_name), label);
 					printf("[Error] Can not find label %s in script %s.\n", 
 						label_name, interpreter->script->script_name);
-					return cpymo_interpreter_goto_line(interpreter, cur_line_num);
+					error_t err = cpymo_interpreter_goto_line(interpreter, cur_line_num);
+					CPYMO_THROW(err);
+					return CPYMO_ERR_NOT_FOUND;
 				}
 				else {
 					cpymo_parser_reset(&interpreter->script_parser);
@@ -148,7 +155,10 @@ error_t cpymo_interpreter_execute_step(cpymo_interpreter * interpreter, cpymo_en
 	cpymo_str command =
 		cpymo_parser_curline_pop_command(&interpreter->script_parser);
 
+	engine->stats.commands++;
+	CPYMO_PROFILER_COMMAND_BEGIN(engine, command);
 	error_t err = cpymo_interpreter_dispatch(command, interpreter, engine, cont);
+	CPYMO_PROFILER_COMMAND_END(engine);
 	switch (err) {
 	case CPYMO_ERR_NOT_FOUND:
 	case CPYMO_ERR_CAN_NOT_OPEN_FILE:
@@ -160,6 +170,10 @@ error_t cpymo_interpreter_execute_step(cpymo_interpreter * interpreter, cpymo_en
 			interpreter->script->script_name,
 			(int)interpreter->script_parser.cur_line,
 			cpymo_error_message(err));
+
+		if (err == CPYMO_ERR_NOT_FOUND || err == CPYMO_ERR_CAN_NOT_OPEN_FILE)
+			engine->stats.missing_assets++;
+		else engine->stats.script_errors++;
 		break;
 	default: return err;
 	};
@@ -179,6 +193,30 @@ void cpymo_interpreter_checkpoint(cpymo_interpreter * interpreter)
 	interpreter->checkpoint.cur_line = interpreter->script_parser.cur_line;
 }
 
+void cpymo_interpreter_prepare_next_vo(cpymo_interpreter *interpreter, cpymo_engine *engine)
+{
+	if (cpymo_engine_skipping(engine)) return;
+	if (cpymo_audio_get_channel_volume(CPYMO_AUDIO_CHANNEL_VO, &engine->audio) <= 0) return;
+
+	cpymo_parser parser = interpreter->script_parser;
+	for (size_t i = 0; i < CPYMO_INTERPRETER_VO_LOOKAHEAD; ++i) {
+		cpymo_str command = cpymo_parser_curline_pop_command(&parser);
+
+		if (cpymo_str_equals_str(command, "vo")) {
+			cpymo_str filename = cpymo_parser_curline_pop_commacell(&parser);
+			cpymo_str_trim(&filename);
+			if (!cpymo_str_equals_str(filename, ""))
+				cpymo_audio_vo_prepare(engine, filename);
+			return;
+		}
+
+		// the voice of next text is found before it.
+		if (cpymo_str_equals_str(command, "say")) return;
+
+		if (!cpymo_parser_next_line(&parser)) return;
+	}
+}
+
 #define D(CMD) \
 	else if (cpymo_str_equals_str(command, CMD))
 
@@ -348,10 +386,8 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 				cpymo_charas_kill(engine, chara_ids[i], time);
 			}
 			else {
-				struct cpymo_chara *ch;
 				err = cpymo_charas_new_chara(
 					engine, 
-					&ch, 
 					filenames[i], 
 					chara_ids[i], 
 					layers[i], 
@@ -649,10 +685,8 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 				cpymo_charas_kill(engine, chara_ids[i], time);
 			}
 			else {
-				struct cpymo_chara *ch;
 				err = cpymo_charas_new_chara(
 					engine,
-					&ch,
 					filenames[i],
 					chara_ids[i],
 					layers[i],
@@ -694,10 +728,8 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 			float begin_alpha = 1.0f - (float)cpymo_str_atoi(begin_alpha_str) / 255.0f;
 			float time = (float)cpymo_str_atoi(time_str) / 1000.0f;
 
-			struct cpymo_chara *c = NULL;
 			err = cpymo_charas_new_chara(
 				engine,
-				&c,
 				filename_or_endx,
 				chara_id,
 				layer,
@@ -707,17 +739,21 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 				time);
 			CPYMO_THROW(err);
 
-			err = cpymo_chara_convert_to_mode0_pos(engine, c, coord_mode, &endx, &endy);
-			CPYMO_THROW(err);
+			size_t c;
+			if (cpymo_charas_find(&engine->charas, &c, chara_id) == CPYMO_ERR_SUCC) {
+				err = cpymo_chara_convert_to_mode0_pos(
+					engine, &engine->charas.chara[c], coord_mode, &endx, &endy);
+				CPYMO_THROW(err);
 
-			cpymo_tween_to(&c->pos_x, endx, time);
-			cpymo_tween_to(&c->pos_y, endy, time);
+				cpymo_tween_to(&engine->charas.pos_x[c], endx, time);
+				cpymo_tween_to(&engine->charas.pos_y[c], endy, time);
+			}
 		}
 		else {
 			POS(endx, endy, filename_or_endx, startx_str_or_endy);
 			float time = (float)cpymo_str_atoi(starty_str_or_time) / 1000.0f;
 
-			struct cpymo_chara *c = NULL;
+			size_t c;
 			err = cpymo_charas_find(
 				&engine->charas,
 				&c,
@@ -728,11 +764,12 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 			}
 			else { CPYMO_THROW(err); }
 
-			err = cpymo_chara_convert_to_mode0_pos(engine, c, coord_mode, &endx, &endy);
+			err = cpymo_chara_convert_to_mode0_pos(
+				engine, &engine->charas.chara[c], coord_mode, &endx, &endy);
 			CPYMO_THROW(err);
 
-			cpymo_tween_to(&c->pos_x, endx, time);
-			cpymo_tween_to(&c->pos_y, endy, time);
+			cpymo_tween_to(&engine->charas.pos_x[c], endx, time);
+			cpymo_tween_to(&engine->charas.pos_y[c], endy, time);
 		}
 
 		cpymo_charas_wait(engine);
@@ -764,6 +801,7 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 			cpymo_str_copy(anime_name, sizeof(anime_name), filename);
 			printf("[Warning] Can not load anime %s in script %s(%u).\n", 
 				anime_name, interpreter->script->script_name, (unsigned)interpreter->script_parser.cur_line);
+			engine->stats.missing_assets++;
 		}
 
 		CONT_NEXTLINE;
@@ -820,6 +858,10 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 		POP_ARG(label);
 		ENSURE(label);
 		err = cpymo_interpreter_goto_label(interpreter, label);
+		if (err == CPYMO_ERR_NOT_FOUND) {
+			engine->stats.missing_labels++;
+			CONT_NEXTLINE;
+		}
 		CPYMO_THROW(err);
 		
 		CONT_WITH_CURRENT_CONTEXT;
@@ -946,14 +988,13 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 		CONT_NEXTLINE;
 
 		BAD_EXPRESSION: {
-			char *condition_str = cpymo_str_copy_malloc(condition);
+			char *condition_str = cpymo_arena_str(&engine->arena, condition);
 			if (condition_str == NULL) return CPYMO_ERR_OUT_OF_MEM;
 			printf( 
 				"[Error] Bad if expression \"%s\" in script %s(%u).\n", 
 				condition_str,
 				interpreter->script->script_name,
 				(unsigned)interpreter->script_parser.cur_line);
-			free(condition_str);
 			return CPYMO_ERR_INVALID_ARG;
 		}
 	}
@@ -1284,7 +1325,7 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 	}
 
 	D("wait_se") {
-		if (cpymo_audio_enabled(engine)) {
+		if (cpymo_engine_audio_state(engine, cpymo_audio_enabled(engine))) {
 			cpymo_wait_register(&engine->wait, &cpymo_audio_wait_se);
 			return CPYMO_ERR_SUCC;
 		}
@@ -1310,7 +1351,8 @@ static error_t cpymo_interpreter_dispatch(cpymo_str command, cpymo_interpreter *
 			return CPYMO_ERR_INVALID_ARG;
 		}
 
-		err = cpymo_vars_set(&engine->vars, var_name, min_val + rand() % (max_val - min_val + 1));
+		const int r = cpymo_engine_rand(engine);
+		err = cpymo_vars_set(&engine->vars, var_name, min_val + r % (max_val - min_val + 1));
 		CPYMO_THROW(err);
 
 		CONT_NEXTLINE;
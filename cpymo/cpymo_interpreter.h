@@ -39,11 +39,15 @@ error_t cpymo_interpreter_init_script(
 
 void cpymo_interpreter_free(cpymo_interpreter *interpreter);
 
+// Returns CPYMO_ERR_NOT_FOUND and stays on current line if there is no such label.
 error_t cpymo_interpreter_goto_label(cpymo_interpreter *interpreter, cpymo_str label);
 error_t cpymo_interpreter_execute_step(cpymo_interpreter *interpreter, struct cpymo_engine *engine);
 
 void cpymo_interpreter_checkpoint(cpymo_interpreter *interpreter);
 
+// Looks a few lines ahead for a #vo and opens its voice early.
+void cpymo_interpreter_prepare_next_vo(cpymo_interpreter *interpreter, struct cpymo_engine *engine);
+
 error_t cpymo_interpreter_goto_line(cpymo_interpreter *interpreter, uint64_t line);
 
 #endif
@@ -0,0 +1,147 @@
+﻿#include "cpymo_prelude.h"
+#include "cpymo_memory.h"
+#include "cpymo_engine.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *cpymo_memory_category_names[cpymo_memory_category_count] = {
+	"bg",
+	"chara",
+	"anime",
+	"glyph",
+	"textbox",
+	"backlog",
+	"script",
+	"audio",
+	"ui",
+};
+
+void cpymo_memory_init(cpymo_memory *m)
+{
+	memset(m, 0, sizeof(*m));
+	m->budget[cpymo_memory_bg] = CPYMO_MEMORY_BUDGET_BG;
+	m->budget[cpymo_memory_chara] = CPYMO_MEMORY_BUDGET_CHARA;
+	m->budget[cpymo_memory_backlog] = CPYMO_MEMORY_BUDGET_BACKLOG;
+	m->budget[cpymo_memory_audio] = CPYMO_MEMORY_BUDGET_AUDIO;
+
+	#ifdef ENABLE_MEMORY_REPORT
+	m->track_peaks = true;
+	#endif
+}
+
+const char *cpymo_memory_category_name(enum cpymo_memory_category c)
+{
+	return cpymo_memory_category_names[c];
+}
+
+static size_t cpymo_memory_measure_script(const cpymo_interpreter *interpreter)
+{
+	size_t size = 0;
+	while (interpreter) {
+		size += sizeof(*interpreter);
+		if (interpreter->own_script && interpreter->script)
+			size += sizeof(cpymo_script) + interpreter->script->script_content_len;
+		interpreter = interpreter->caller;
+	}
+
+	return size;
+}
+
+static size_t cpymo_memory_measure(const cpymo_engine *e, enum cpymo_memory_category c)
+{
+	switch (c) {
+	case cpymo_memory_bg: return cpymo_bg_memory_usage(&e->bg);
+	case cpymo_memory_chara: return cpymo_charas_memory_usage(&e->charas);
+	case cpymo_memory_anime: return cpymo_anime_memory_usage(&e->anime);
+	case cpymo_memory_glyph:
+		return cpymo_text_glyph_memory_usage(&e->text) + cpymo_say_glyph_memory_usage(&e->say);
+	case cpymo_memory_textbox:
+		return cpymo_text_memory_usage(&e->text) + cpymo_say_memory_usage(&e->say);
+	case cpymo_memory_backlog: return cpymo_backlog_memory_usage(&e->backlog);
+	case cpymo_memory_script: return cpymo_memory_measure_script(e->interpreter);
+	case cpymo_memory_audio: return cpymo_audio_memory_usage(&e->audio);
+	case cpymo_memory_ui: return cpymo_ui_memory_usage(e);
+	default: return 0;
+	};
+}
+
+static void cpymo_memory_measure_category(cpymo_engine *e, enum cpymo_memory_category c)
+{
+	// Through pointers, GCC 12 -Warray-bounds takes the default case of
+	// cpymo_memory_measure for an index past the arrays.
+	size_t *current = e->memory.current + c, *peak = e->memory.peak + c;
+	*current = cpymo_memory_measure(e, c);
+	if (*current > *peak) *peak = *current;
+}
+
+// Lets go what the category can rebuild or does not need, without changing what is shown.
+static void cpymo_memory_trim(cpymo_engine *e, enum cpymo_memory_category c)
+{
+	switch (c) {
+	case cpymo_memory_chara: {
+		extern void cpymo_charas_gc(cpymo_charas *p, bool trim_memory);
+		cpymo_charas_gc(&e->charas, true);
+		break;
+	}
+	case cpymo_memory_backlog: cpymo_backlog_trim(&e->backlog); break;
+	case cpymo_memory_audio: cpymo_audio_trim(&e->audio); break;
+	default: return;
+	};
+
+	e->memory.trims[c]++;
+}
+
+void cpymo_memory_update(cpymo_engine *e)
+{
+	cpymo_memory *m = &e->memory;
+	for (size_t i = 0; i < cpymo_memory_category_count; ++i) {
+		const enum cpymo_memory_category c = (enum cpymo_memory_category)i;
+		if (!m->track_peaks && m->budget[c] == 0) continue;
+
+		const size_t last = m->current[c];
+		cpymo_memory_measure_category(e, c);
+
+		// Backlog and audio grow without asking for room first,
+		// trimmed once each time they grow over budget.
+		if (m->budget[c] && m->current[c] > m->budget[c] && m->current[c] > last) {
+			cpymo_memory_trim(e, c);
+			cpymo_memory_measure_category(e, c);
+		}
+	}
+}
+
+bool cpymo_memory_reserve(cpymo_engine *e, enum cpymo_memory_category c, size_t size)
+{
+	cpymo_memory *m = &e->memory;
+	if (m->budget[c] == 0) return true;
+
+	cpymo_memory_measure_category(e, c);
+	if (m->current[c] + size <= m->budget[c]) return true;
+
+	cpymo_memory_trim(e, c);
+	cpymo_memory_measure_category(e, c);
+	return m->current[c] + size <= m->budget[c];
+}
+
+void cpymo_memory_set_budget(cpymo_engine *e, enum cpymo_memory_category c, size_t budget)
+{
+	e->memory.budget[c] = budget;
+}
+
+void cpymo_memory_report(const cpymo_memory *m)
+{
+	for (size_t i = 0; i < cpymo_memory_category_count; ++i) {
+		if (m->peak[i] == 0) continue;
+
+		printf("[Memory] %-8s current %7u KiB, peak %7u KiB",
+			cpymo_memory_category_names[i],
+			(unsigned)(m->current[i] / 1024),
+			(unsigned)(m->peak[i] / 1024));
+
+		if (m->budget[i])
+			printf(", budget %7u KiB, trimmed %u times",
+				(unsigned)(m->budget[i] / 1024), (unsigned)m->trims[i]);
+
+		putchar('\n');
+	}
+}
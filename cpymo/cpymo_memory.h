@@ -0,0 +1,71 @@
+#ifndef INCLUDE_CPYMO_MEMORY
+#define INCLUDE_CPYMO_MEMORY
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Bytes held by the engine, by category.
+// Every category is measured from the module owning it, so nothing is lost on a missed free.
+// Images and glyphs live in backends, they are estimated from their pixel size.
+
+enum cpymo_memory_category {
+	cpymo_memory_bg,
+	cpymo_memory_chara,
+	cpymo_memory_anime,
+	cpymo_memory_glyph,
+	cpymo_memory_textbox,
+	cpymo_memory_backlog,
+	cpymo_memory_script,
+	cpymo_memory_audio,
+	cpymo_memory_ui,
+
+	cpymo_memory_category_count
+};
+
+// Budgets in bytes, 0 for no budget.
+#ifndef CPYMO_MEMORY_BUDGET_BG
+#define CPYMO_MEMORY_BUDGET_BG 0
+#endif
+
+#ifndef CPYMO_MEMORY_BUDGET_CHARA
+#define CPYMO_MEMORY_BUDGET_CHARA 0
+#endif
+
+#ifndef CPYMO_MEMORY_BUDGET_BACKLOG
+#define CPYMO_MEMORY_BUDGET_BACKLOG 0
+#endif
+
+#ifndef CPYMO_MEMORY_BUDGET_AUDIO
+#define CPYMO_MEMORY_BUDGET_AUDIO 0
+#endif
+
+typedef struct {
+	size_t current[cpymo_memory_category_count];
+	size_t peak[cpymo_memory_category_count];
+	size_t budget[cpymo_memory_category_count];
+	size_t trims[cpymo_memory_category_count];
+
+	// Measure every category each frame for peaks,
+	// otherwise only categories with a budget are measured.
+	bool track_peaks;
+} cpymo_memory;
+
+void cpymo_memory_init(cpymo_memory *m);
+
+const char *cpymo_memory_category_name(enum cpymo_memory_category c);
+
+struct cpymo_engine;
+
+// Measures categories and updates peaks, once a frame.
+void cpymo_memory_update(struct cpymo_engine *e);
+
+// Called before size more bytes are loaded into category.
+// If that goes over its budget, category is trimmed first, if it has anything to let go.
+// Returns false if it still does not fit, caller may then load in a cheaper way.
+bool cpymo_memory_reserve(struct cpymo_engine *e, enum cpymo_memory_category c, size_t size);
+
+void cpymo_memory_set_budget(struct cpymo_engine *e, enum cpymo_memory_category c, size_t budget);
+
+void cpymo_memory_report(const cpymo_memory *m);
+
+#endif
@@ -13,6 +13,7 @@
 
 #ifndef DISABLE_FFMPEG_MOVIE
 #include <assert.h>
+#include "cpymo_atomic.h"
 #include "../cpymo-backends/include/cpymo_backend_movie.h"
 
 #ifdef __CXX
@@ -26,6 +27,17 @@ extern "C" {
 }
 #endif
 
+// Decoded frames waiting to be shown.
+#ifndef CPYMO_MOVIE_QUEUE_FRAMES
+#define CPYMO_MOVIE_QUEUE_FRAMES 4
+#endif
+
+// When the clock is this far past the last decoded frame,
+// decoder skips non-reference frames until it catches up.
+#ifndef CPYMO_MOVIE_LATE_SECONDS
+#define CPYMO_MOVIE_LATE_SECONDS 0.1f
+#endif
+
 typedef struct {
 	#ifdef DONT_PASS_PATH_TO_FFMPEG
 		cpymo_package_stream_reader stream_reader;
@@ -38,7 +50,16 @@ typedef struct {
 	AVCodecContext *video_codec_context;
 
 	AVPacket *packet;
-	AVFrame *video_frame;
+
+	// Everything above belongs to the decoder once it is started.
+	// Frames are written by decoder and read by cpymo_movie_update,
+	// frame_write and frame_read only grow.
+	AVFrame *frames[CPYMO_MOVIE_QUEUE_FRAMES];
+	float frame_times[CPYMO_MOVIE_QUEUE_FRAMES];
+	volatile size_t frame_read, frame_write;
+	volatile bool decoder_done;
+	volatile bool behind;
+	bool threaded;
 
 	bool no_more_content;
 	bool backend_inited;
@@ -47,6 +68,8 @@ typedef struct {
 	float current_time;
 	float video_current_frame_time;
 
+	size_t decoded, presented, dropped;
+
 	char *current_bgm_name;
 } cpymo_movie;
 
@@ -91,43 +114,11 @@ static error_t cpymo_movie_send_packets(cpymo_movie *m)
 	return CPYMO_ERR_SUCC;
 }
 
-static error_t cpymo_movie_send_video_frame_to_backend(cpymo_movie *m)
+static error_t cpymo_movie_receive_frame(cpymo_movie *m, AVFrame *frame)
 {
 RETRY: {
-	int err = avcodec_receive_frame(m->video_codec_context, m->video_frame);
+	int err = avcodec_receive_frame(m->video_codec_context, frame);
 	if (err == 0) {
-		switch (m->video_frame->format) {
-		case AV_PIX_FMT_YUV420P:
-		case AV_PIX_FMT_YUV422P:
-		case AV_PIX_FMT_YUV420P16:
-		case AV_PIX_FMT_YUV422P16:
-			cpymo_backend_movie_update_yuv_surface(
-				m->video_frame->data[0],
-				(size_t)m->video_frame->linesize[0],
-				m->video_frame->data[1],
-				(size_t)m->video_frame->linesize[1],
-				m->video_frame->data[2],
-				(size_t)m->video_frame->linesize[2]
-			);
-			break;
-		case AV_PIX_FMT_YUYV422:
-			cpymo_backend_movie_update_yuyv_surface(
-				m->video_frame->data[0],
-				(size_t)m->video_frame->linesize[0]
-			);
-		default: assert(false);
-		};
-
-		m->video_current_frame_time =
-			(float)
-			(m->video_frame->best_effort_timestamp
-				* av_q2d(m->format_context->streams[m->video_stream_index]->time_base));
-
-		av_frame_unref(m->video_frame);
-
-		if (m->video_current_frame_time < m->current_time)
-			goto RETRY;
-
 		return CPYMO_ERR_SUCC;
 	}
 	else if (err == AVERROR(EAGAIN)) {
@@ -136,7 +127,7 @@ RETRY: {
 		else if (err == CPYMO_ERR_SUCC) { goto RETRY; }
 		else {
 			printf("[Error] Failed to request more frames.\n");
-			goto RETRY;
+			return err;
 		}
 	}
 	else if (err == AVERROR_EOF) { return CPYMO_ERR_NO_MORE_CONTENT; }
@@ -146,19 +137,111 @@ RETRY: {
 	}
 } }
 
+// Fills the frame queue, on the backend decoder thread if there is one.
+static void cpymo_movie_decode(void *userdata)
+{
+	cpymo_movie *m = (cpymo_movie *)userdata;
+	if (cpymo_atomic_bool_load(&m->decoder_done)) return;
+
+	const double time_base = 
+		av_q2d(m->format_context->streams[m->video_stream_index]->time_base);
+
+	size_t write = m->frame_write;
+	while (write - cpymo_atomic_size_load(&m->frame_read) < CPYMO_MOVIE_QUEUE_FRAMES) {
+		m->video_codec_context->skip_frame = 
+			cpymo_atomic_bool_load(&m->behind) ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+
+		const size_t slot = write % CPYMO_MOVIE_QUEUE_FRAMES;
+		if (cpymo_movie_receive_frame(m, m->frames[slot]) != CPYMO_ERR_SUCC) {
+			cpymo_atomic_bool_store(&m->decoder_done, true);
+			return;
+		}
+
+		m->frame_times[slot] = (float)(m->frames[slot]->best_effort_timestamp * time_base);
+		m->decoded++;
+		cpymo_atomic_size_store(&m->frame_write, ++write);
+	}
+}
+
+static void cpymo_movie_send_frame_to_backend(const AVFrame *frame)
+{
+	switch (frame->format) {
+	case AV_PIX_FMT_YUV420P:
+	case AV_PIX_FMT_YUV422P:
+	case AV_PIX_FMT_YUV420P16:
+	case AV_PIX_FMT_YUV422P16:
+		cpymo_backend_movie_update_yuv_surface(
+			frame->data[0],
+			(size_t)frame->linesize[0],
+			frame->data[1],
+			(size_t)frame->linesize[1],
+			frame->data[2],
+			(size_t)frame->linesize[2]
+		);
+		break;
+	case AV_PIX_FMT_YUYV422:
+		cpymo_backend_movie_update_yuyv_surface(
+			frame->data[0],
+			(size_t)frame->linesize[0]
+		);
+		break;
+	default: assert(false);
+	};
+}
+
+// Shows the newest frame that is due, older due frames are dropped without upload.
+static bool cpymo_movie_present(cpymo_movie *m)
+{
+	const bool done = cpymo_atomic_bool_load(&m->decoder_done);
+	const size_t write = cpymo_atomic_size_load(&m->frame_write);
+	size_t read = m->frame_read;
+	bool presented = false;
+
+	while (read != write 
+		&& m->frame_times[read % CPYMO_MOVIE_QUEUE_FRAMES] <= m->current_time) {
+		AVFrame *frame = m->frames[read % CPYMO_MOVIE_QUEUE_FRAMES];
+		m->video_current_frame_time = m->frame_times[read % CPYMO_MOVIE_QUEUE_FRAMES];
+
+		if (read + 1 != write 
+			&& m->frame_times[(read + 1) % CPYMO_MOVIE_QUEUE_FRAMES] <= m->current_time) {
+			m->dropped++;
+		}
+		else {
+			cpymo_movie_send_frame_to_backend(frame);
+			m->presented++;
+			presented = true;
+		}
+
+		av_frame_unref(frame);
+		read++;
+	}
+
+	cpymo_atomic_size_store(&m->frame_read, read);
+
+	if (read != write)
+		cpymo_atomic_bool_store(&m->behind, false);
+	else if (!done && m->current_time - m->video_current_frame_time > CPYMO_MOVIE_LATE_SECONDS)
+		cpymo_atomic_bool_store(&m->behind, true);
+
+	if (m->threaded) cpymo_backend_movie_decoder_wake();
+
+	return presented;
+}
+
 static error_t cpymo_movie_update(cpymo_engine *e, void *ui_data, float dt)
 {
 	cpymo_movie *m = (cpymo_movie *)ui_data;
 	m->current_time += dt;
 
-	if (m->video_current_frame_time < m->current_time) {
-		error_t err = cpymo_movie_send_video_frame_to_backend(m);
-		if (err == CPYMO_ERR_NO_MORE_CONTENT) {
-			cpymo_ui_exit(e);
-			return CPYMO_ERR_SUCC;
-		}
-		else if (err == CPYMO_ERR_SUCC)
-			cpymo_engine_request_redraw(e);
+	if (!m->threaded) cpymo_movie_decode(m);
+
+	if (cpymo_movie_present(m))
+		cpymo_engine_request_redraw(e);
+
+	if (cpymo_atomic_bool_load(&m->decoder_done)
+		&& m->frame_read == cpymo_atomic_size_load(&m->frame_write)) {
+		cpymo_ui_exit(e);
+		return CPYMO_ERR_SUCC;
 	}
 
 	if (CPYMO_INPUT_JUST_RELEASED(e, skip)) {
@@ -181,6 +264,12 @@ static void cpymo_movie_delete(cpymo_engine *e, void *ui_data)
 {
 	cpymo_movie *m = (cpymo_movie *)ui_data;
 
+	if (m->threaded) cpymo_backend_movie_decoder_stop();
+
+	if (m->decoded)
+		printf("[Info] Movie frames: %u decoded, %u presented, %u dropped.\n",
+			(unsigned)m->decoded, (unsigned)m->presented, (unsigned)m->dropped);
+
 	cpymo_audio_bgm_stop(e);
 
 	if (m->current_bgm_name) {
@@ -191,7 +280,8 @@ static void cpymo_movie_delete(cpymo_engine *e, void *ui_data)
 		free(m->current_bgm_name);
 	}
 
-	if (m->video_frame) av_frame_free(&m->video_frame);
+	for (size_t i = 0; i < CPYMO_MOVIE_QUEUE_FRAMES; ++i)
+		if (m->frames[i]) av_frame_free(&m->frames[i]);
 	if (m->packet) av_packet_free(&m->packet);
 	if (m->video_codec_context) avcodec_free_context(&m->video_codec_context);
 	if (m->format_context) avformat_close_input(&m->format_context);
@@ -255,7 +345,16 @@ error_t cpymo_movie_play(cpymo_engine * e, cpymo_str videoname)
 	m->video_codec_context = NULL;
 	m->no_more_content = false;
 	m->packet = NULL;
-	m->video_frame = NULL;
+	for (size_t i = 0; i < CPYMO_MOVIE_QUEUE_FRAMES; ++i)
+		m->frames[i] = NULL;
+	m->frame_read = 0;
+	m->frame_write = 0;
+	m->decoder_done = false;
+	m->behind = false;
+	m->threaded = false;
+	m->decoded = 0;
+	m->presented = 0;
+	m->dropped = 0;
 	m->current_time = 0;
 	m->backend_inited = false;
 	m->skip_pressed = e->input.skip;
@@ -348,10 +447,11 @@ error_t cpymo_movie_play(cpymo_engine * e, cpymo_str videoname)
 	m->packet = av_packet_alloc();
 	THROW(m->packet == NULL, CPYMO_ERR_OUT_OF_MEM, "[Error] Could not alloc AVPacket");
 
-	m->video_frame = av_frame_alloc();
-	THROW(m->video_frame == NULL, CPYMO_ERR_OUT_OF_MEM, "[Error] Could not alloc AVFrame");
+	for (size_t i = 0; i < CPYMO_MOVIE_QUEUE_FRAMES; ++i) {
+		m->frames[i] = av_frame_alloc();
+		THROW(m->frames[i] == NULL, CPYMO_ERR_OUT_OF_MEM, "[Error] Could not alloc AVFrame");
+	}
 
-	m->video_frame->best_effort_timestamp = 0;
 	m->video_current_frame_time = 0;
 
 	int width = m->format_context->streams[m->video_stream_index]->codecpar->width;
@@ -378,7 +478,9 @@ error_t cpymo_movie_play(cpymo_engine * e, cpymo_str videoname)
 
 	err = cpymo_audio_play_video(e, path);
 	THROW(err != CPYMO_ERR_SUCC, err, "[Error] Can not open audio.");
-	cpymo_movie_send_video_frame_to_backend(m);
+
+	cpymo_movie_decode(m);
+	m->threaded = cpymo_backend_movie_decoder_start(&cpymo_movie_decode, m);
 	
 	free(path);
 
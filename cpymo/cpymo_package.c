@@ -1,6 +1,7 @@
 ﻿#include "cpymo_prelude.h"
 #include "cpymo_package.h"
 #include "cpymo_utils.h"
+#include "cpymo_trace.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -16,6 +17,7 @@ error_t cpymo_package_open(cpymo_package *out_package, const char * path)
 	
 	if (out_package == NULL) return CPYMO_ERR_INVALID_ARG;
 
+	CPYMO_TRACE_BEGIN(trace);
 	out_package->stream = fopen(path, "rb");
 	if (out_package->stream == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
 
@@ -55,6 +57,9 @@ error_t cpymo_package_open(cpymo_package *out_package, const char * path)
 		file->file_offset = end_le32toh(file->file_offset);
 	}
 
+	CPYMO_TRACE_END(trace, "file", "package_open", cpymo_str_pure(path),
+		sizeof(cpymo_package_index) * out_package->file_count);
+
 	return CPYMO_ERR_SUCC;
 }
 
@@ -74,13 +79,16 @@ error_t cpymo_package_find(cpymo_package_index * out_index, const cpymo_package
 		puts("\" is too long!");
 	}
 
+	CPYMO_TRACE_BEGIN(trace);
 	for (uint32_t i = 0; i < package->file_count; ++i) {
 		if (cpymo_str_equals_str_ignore_case(filename, package->files[i].file_name)) {
 			*out_index = package->files[i];
+			CPYMO_TRACE_END(trace, "package", "find", filename, 0);
 			return CPYMO_ERR_SUCC;
 		}
 	}
 
+	CPYMO_TRACE_END(trace, "package", "find_missing", filename, 0);
 	return CPYMO_ERR_NOT_FOUND;
 }
 
@@ -90,8 +98,11 @@ error_t cpymo_package_read_file_from_index(char *out_buffer, const cpymo_package
 	assert(package->has_stream_reader == false);
 	#endif
 	
+	CPYMO_TRACE_BEGIN(trace);
 	fseek(package->stream, index->file_offset, SEEK_SET);
 	const size_t count = fread(out_buffer, index->file_length, 1, package->stream);
+	CPYMO_TRACE_END(trace, "package", "read", 
+		cpymo_str_pure(index->file_name), index->file_length);
 
 	if (count != 1) return CPYMO_ERR_BAD_FILE_FORMAT;
 
@@ -134,6 +145,8 @@ static void cpymo_package_stream_reader_image_skip(void *stream_reader, int n)
 #ifndef DISABLE_STB_IMAGE
 error_t cpymo_package_read_image_from_index(void ** pixels, int * w, int * h, int channels, const cpymo_package * pkg, const cpymo_package_index * index)
 {	
+	CPYMO_TRACE_BEGIN(trace);
+
 #ifdef STREAMING_LOAD_IMAGE
 	stbi_io_callbacks cbs;
 	cbs.eof = &cpymo_package_stream_read_image_eof;
@@ -150,6 +163,8 @@ error_t cpymo_package_read_image_from_index(void ** pixels, int * w, int * h, in
 		return CPYMO_ERR_BAD_FILE_FORMAT;
 	}
 
+	CPYMO_TRACE_END(trace, "image", "decode", 
+		cpymo_str_pure(index->file_name), index->file_length);
 	return CPYMO_ERR_SUCC;
 
 #else
@@ -170,6 +185,8 @@ error_t cpymo_package_read_image_from_index(void ** pixels, int * w, int * h, in
 		return CPYMO_ERR_BAD_FILE_FORMAT;
 	}
 
+	CPYMO_TRACE_END(trace, "image", "decode", 
+		cpymo_str_pure(index->file_name), index->file_length);
 	return CPYMO_ERR_SUCC;
 #endif
 }
@@ -202,7 +219,8 @@ error_t cpymo_package_stream_reader_seek(size_t seek, cpymo_package_stream_reade
 	}
 
 	r->current = seek;
-	fseek(r->stream, (long)(r->file_offset + r->current), SEEK_SET);
+	if (r->memory == NULL)
+		fseek(r->stream, (long)(r->file_offset + r->current), SEEK_SET);
 	
 	return CPYMO_ERR_SUCC;
 }
@@ -214,14 +232,29 @@ size_t cpymo_package_stream_reader_read(char *dst_buf, size_t dst_buf_size, cpym
 
 	if (read_size <= 0) return 0;
 
+	if (r->memory) {
+		memcpy(dst_buf, r->memory + r->current, read_size);
+		r->current += read_size;
+		return read_size;
+	}
+
+	CPYMO_TRACE_BEGIN(trace);
+
+	// Package stream is shared, other readers may have moved it.
+	if (!r->own_stream)
+		fseek(r->stream, (long)(r->file_offset + r->current), SEEK_SET);
+
 	r->current += read_size;
 
-	return fread(dst_buf, read_size, 1, r->stream) * read_size;
+	read_size = fread(dst_buf, read_size, 1, r->stream) * read_size;
+	CPYMO_TRACE_END(trace, "file", "stream_read", cpymo_str_pure(""), read_size);
+	return read_size;
 }
 
 void cpymo_package_stream_reader_close(cpymo_package_stream_reader * r)
 {
 	if (r->own_stream && r->stream) fclose(r->stream);
+	if (r->own_memory && r->memory) free((void *)r->memory);
 #ifdef DEBUG
 	if (r->package) r->package->has_stream_reader = false;
 #endif
@@ -241,6 +274,8 @@ cpymo_package_stream_reader cpymo_package_stream_reader_create(
 	reader.current = 0;
 	reader.stream = package->stream;
 	reader.own_stream = false;
+	reader.memory = NULL;
+	reader.own_memory = false;
 #ifdef DEBUG
 	assert(package->has_stream_reader == false);
 	reader.package = (cpymo_package *)package;
@@ -258,6 +293,7 @@ error_t cpymo_package_stream_reader_from_file(
 	cpymo_package_stream_reader *out,
 	const char *path)
 {
+	CPYMO_TRACE_BEGIN(trace);
 	FILE *file = fopen(path, "rb");
 	if (file == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
 
@@ -282,8 +318,57 @@ error_t cpymo_package_stream_reader_from_file(
 	out->file_offset = 0;
 	out->own_stream = true;
 	out->stream = file;
+	out->memory = NULL;
+	out->own_memory = false;
 
 	fseek(file, 0, SEEK_SET);
 
+	CPYMO_TRACE_END(trace, "file", "open", cpymo_str_pure(path), 0);
+	return CPYMO_ERR_SUCC;
+}
+
+void cpymo_package_stream_reader_from_memory(
+	cpymo_package_stream_reader *out,
+	const void *data,
+	size_t size,
+	bool own)
+{
+#ifdef LEAKCHECK
+	out->leak_mark = malloc(1024);
+	assert(out->leak_mark);
+#endif
+
+#ifdef DEBUG
+	out->package = NULL;
+#endif
+
+	out->current = 0;
+	out->file_length = size;
+	out->file_offset = 0;
+	out->own_stream = false;
+	out->stream = NULL;
+	out->memory = (const uint8_t *)data;
+	out->own_memory = own;
+}
+
+error_t cpymo_package_stream_reader_find_load(
+	cpymo_package_stream_reader *r,
+	const cpymo_package *package,
+	cpymo_str name)
+{
+	cpymo_package_index index;
+	error_t err = cpymo_package_find(&index, package, name);
+	CPYMO_THROW(err);
+
+	char *data = (char *)malloc(index.file_length > 0 ? index.file_length : 1);
+	if (data == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+	err = cpymo_package_read_file_from_index(data, package, &index);
+	if (err != CPYMO_ERR_SUCC) {
+		free(data);
+		return err;
+	}
+
+	cpymo_package_stream_reader_from_memory(r, data, index.file_length, true);
 	return CPYMO_ERR_SUCC;
 }
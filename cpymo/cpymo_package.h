@@ -44,6 +44,10 @@ typedef struct {
 	FILE *stream;
 	bool own_stream;
 
+	// Reads from memory instead of stream when set.
+	const uint8_t *memory;
+	bool own_memory;
+
 #ifdef DEBUG
 	cpymo_package *package;
 #endif
@@ -57,6 +61,13 @@ error_t cpymo_package_stream_reader_from_file(
 	cpymo_package_stream_reader *out,
 	const char *path);
 
+// Takes data if own is true, it is freed on close.
+void cpymo_package_stream_reader_from_memory(
+	cpymo_package_stream_reader *out,
+	const void *data,
+	size_t size,
+	bool own);
+
 cpymo_package_stream_reader cpymo_package_stream_reader_create(
 	const cpymo_package *package, 
 	const cpymo_package_index *index);
@@ -66,6 +77,13 @@ error_t cpymo_package_stream_reader_find_create(
 	const cpymo_package *package,
 	cpymo_str name);
 
+// Reads the whole file into memory, the reader never touches package again,
+// so it can be used on another thread while package is in use.
+error_t cpymo_package_stream_reader_find_load(
+	cpymo_package_stream_reader *r,
+	const cpymo_package *package,
+	cpymo_str name);
+
 error_t cpymo_package_stream_reader_seek(
 	size_t seek,
 	cpymo_package_stream_reader *r);
@@ -0,0 +1,294 @@
+﻿#include "cpymo_prelude.h"
+#include "cpymo_profiler.h"
+#include "cpymo_utils.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../cpymo-backends/include/cpymo_backend_save.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define CPYMO_PROFILER_OVERLAY_REFRESH 0.5f
+
+static const char *cpymo_profiler_scope_names[cpymo_profiler_scope_count] = {
+	"input",
+	"ui",
+	"anime",
+	"select_img",
+	"wait",
+	"interpreter",
+	"command",
+	"draw_ui",
+	"draw_bg",
+	"draw_scroll",
+	"draw_charas",
+	"draw_anime",
+	"draw_select_img",
+	"draw_fade",
+	"draw_textbox",
+};
+
+static double cpymo_profiler_now(void)
+{
+	#ifdef _WIN32
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)freq.QuadPart;
+	#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+	#endif
+}
+
+static void cpymo_profiler_clear_frame(cpymo_profiler *p)
+{
+	for (size_t i = 0; i < cpymo_profiler_scope_count; ++i)
+		p->frames[p->frame][i] = -1;
+
+	p->slowest_command[0] = '\0';
+	p->slowest_command_ms = 0;
+}
+
+static void cpymo_profiler_free_overlay(cpymo_profiler *p)
+{
+	for (size_t i = 0; i < CPYMO_ARR_COUNT(p->overlay_lines); ++i) {
+		if (p->overlay_lines[i]) {
+			cpymo_backend_text_free(p->overlay_lines[i]);
+			p->overlay_lines[i] = NULL;
+		}
+	}
+}
+
+error_t cpymo_profiler_create(cpymo_profiler **out)
+{
+	cpymo_profiler *p = (cpymo_profiler *)malloc(sizeof(cpymo_profiler));
+	if (p == NULL) return CPYMO_ERR_OUT_OF_MEM;
+
+	memset(p, 0, sizeof(*p));
+	cpymo_profiler_clear_frame(p);
+
+	*out = p;
+	return CPYMO_ERR_SUCC;
+}
+
+void cpymo_profiler_free(cpymo_profiler *p)
+{
+	if (p == NULL) return;
+	cpymo_profiler_free_overlay(p);
+	free(p);
+}
+
+bool cpymo_profiler_frame(cpymo_profiler *p, float delta_time)
+{
+	if (p == NULL) return false;
+
+	cpymo_profiler_command_end(p);
+
+	p->frames_total++;
+	if (p->frames_recorded < CPYMO_PROFILER_FRAMES) p->frames_recorded++;
+	p->frame = (p->frame + 1) % CPYMO_PROFILER_FRAMES;
+	cpymo_profiler_clear_frame(p);
+
+	if (!p->overlay) return false;
+
+	p->overlay_timer += delta_time;
+	if (p->overlay_timer < CPYMO_PROFILER_OVERLAY_REFRESH) return false;
+
+	p->overlay_timer = 0;
+	p->overlay_dirty = true;
+	return true;
+}
+
+static void cpymo_profiler_add(cpymo_profiler *p, enum cpymo_profiler_scope scope, float ms)
+{
+	float *t = &p->frames[p->frame][scope];
+	if (*t < 0) *t = 0;
+	*t += ms;
+}
+
+void cpymo_profiler_begin(cpymo_profiler *p, enum cpymo_profiler_scope scope)
+{
+	if (p == NULL) return;
+	p->begin[scope] = cpymo_profiler_now();
+}
+
+void cpymo_profiler_end(cpymo_profiler *p, enum cpymo_profiler_scope scope)
+{
+	if (p == NULL) return;
+	cpymo_profiler_add(p, scope, (float)((cpymo_profiler_now() - p->begin[scope]) * 1000.0));
+}
+
+void cpymo_profiler_command_begin(cpymo_profiler *p, cpymo_str command)
+{
+	if (p == NULL) return;
+	cpymo_profiler_command_end(p);
+
+	cpymo_str_copy(p->command, sizeof(p->command), command);
+	p->command_begin = cpymo_profiler_now();
+	p->command_running = true;
+}
+
+void cpymo_profiler_command_end(cpymo_profiler *p)
+{
+	if (p == NULL || !p->command_running) return;
+	p->command_running = false;
+
+	const float ms = (float)((cpymo_profiler_now() - p->command_begin) * 1000.0);
+	cpymo_profiler_add(p, cpymo_profiler_scope_command, ms);
+
+	if (ms >= p->slowest_command_ms) {
+		p->slowest_command_ms = ms;
+		strcpy(p->slowest_command, p->command);
+	}
+}
+
+static int cpymo_profiler_compare_float(const void *a, const void *b)
+{
+	const float x = *(const float *)a, y = *(const float *)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+cpymo_profiler_stats cpymo_profiler_get_stats(
+	const cpymo_profiler *p, enum cpymo_profiler_scope scope)
+{
+	cpymo_profiler_stats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	// The current frame is still being recorded.
+	float sorted[CPYMO_PROFILER_FRAMES];
+	double sum = 0;
+	for (size_t i = 1; i <= p->frames_recorded; ++i) {
+		const size_t frame = (p->frame + CPYMO_PROFILER_FRAMES - i) % CPYMO_PROFILER_FRAMES;
+		const float t = p->frames[frame][scope];
+		if (t < 0) continue;
+
+		sorted[stats.frames++] = t;
+		sum += t;
+	}
+
+	if (stats.frames == 0) return stats;
+
+	qsort(sorted, stats.frames, sizeof(sorted[0]), &cpymo_profiler_compare_float);
+	stats.min = sorted[0];
+	stats.avg = (float)(sum / stats.frames);
+	stats.p99 = sorted[(stats.frames - 1) * 99 / 100];
+	return stats;
+}
+
+const char *cpymo_profiler_scope_name(enum cpymo_profiler_scope scope)
+{
+	return cpymo_profiler_scope_names[scope];
+}
+
+void cpymo_profiler_toggle_overlay(cpymo_profiler *p)
+{
+	if (p == NULL) return;
+
+	p->overlay = !p->overlay;
+	p->overlay_timer = 0;
+	p->overlay_dirty = p->overlay;
+	if (!p->overlay) cpymo_profiler_free_overlay(p);
+}
+
+static void cpymo_profiler_update_overlay(cpymo_profiler *p, float fontsize)
+{
+	cpymo_profiler_free_overlay(p);
+
+	char line[96];
+	for (size_t i = 0; i < cpymo_profiler_scope_count; ++i) {
+		cpymo_profiler_stats s = cpymo_profiler_get_stats(p, (enum cpymo_profiler_scope)i);
+		snprintf(line, sizeof(line), "%-16s min %6.2f avg %6.2f p99 %6.2f ms",
+			cpymo_profiler_scope_names[i], s.min, s.avg, s.p99);
+
+		float w;
+		if (cpymo_backend_text_create(
+			&p->overlay_lines[i], &w, cpymo_str_pure(line), fontsize) != CPYMO_ERR_SUCC)
+			p->overlay_lines[i] = NULL;
+	}
+
+	// Slowest command of current frame.
+	snprintf(line, sizeof(line), "frame %u, command %s %.2f ms",
+		(unsigned)p->frames_total, p->slowest_command, p->slowest_command_ms);
+
+	float w;
+	if (cpymo_backend_text_create(
+		&p->overlay_lines[cpymo_profiler_scope_count], &w,
+		cpymo_str_pure(line), fontsize) != CPYMO_ERR_SUCC)
+		p->overlay_lines[cpymo_profiler_scope_count] = NULL;
+}
+
+void cpymo_profiler_draw_overlay(cpymo_profiler *p, float screen_w, float screen_h)
+{
+	if (p == NULL || !p->overlay) return;
+
+	const size_t lines = CPYMO_ARR_COUNT(p->overlay_lines);
+	const float fontsize = screen_h / (float)(lines + 2);
+
+	if (p->overlay_dirty) {
+		cpymo_profiler_update_overlay(p, fontsize);
+		p->overlay_dirty = false;
+	}
+
+	const float xywh[] = { 0, 0, screen_w, fontsize * (lines + 0.5f) };
+	cpymo_backend_image_fill_rects(
+		xywh, 1, cpymo_color_black, 0.6f,
+		cpymo_backend_image_draw_type_ui_element_bg);
+
+	for (size_t i = 0; i < lines; ++i) {
+		if (p->overlay_lines[i] == NULL) continue;
+		cpymo_backend_text_draw(
+			p->overlay_lines[i],
+			0, fontsize * (i + 1),
+			cpymo_color_white, 1.0f,
+			cpymo_backend_image_draw_type_ui_element);
+	}
+}
+
+error_t cpymo_profiler_dump_csv(const cpymo_profiler *p, const char *gamedir)
+{
+	if (p == NULL || p->frames_recorded == 0) return CPYMO_ERR_SUCC;
+
+	FILE *csv = cpymo_backend_write_save(gamedir, "profiler.csv");
+	if (csv == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+
+	fputs("frame", csv);
+	for (size_t i = 0; i < cpymo_profiler_scope_count; ++i)
+		fprintf(csv, ",%s", cpymo_profiler_scope_names[i]);
+	fputs("\n", csv);
+
+	for (size_t i = p->frames_recorded; i >= 1; --i) {
+		const size_t frame = (p->frame + CPYMO_PROFILER_FRAMES - i) % CPYMO_PROFILER_FRAMES;
+		fprintf(csv, "%u", (unsigned)(p->frames_total - i));
+
+		for (size_t j = 0; j < cpymo_profiler_scope_count; ++j) {
+			const float t = p->frames[frame][j];
+			if (t < 0) fputs(",", csv);
+			else fprintf(csv, ",%.4f", t);
+		}
+
+		fputs("\n", csv);
+	}
+
+	fclose(csv);
+
+	printf("[Profiler] Last %u frames, in ms:\n", (unsigned)p->frames_recorded);
+	for (size_t i = 0; i < cpymo_profiler_scope_count; ++i) {
+		cpymo_profiler_stats s = cpymo_profiler_get_stats(p, (enum cpymo_profiler_scope)i);
+		if (s.frames == 0) continue;
+		printf("[Profiler] %-16s min %.3f avg %.3f p99 %.3f (%u frames)\n",
+			cpymo_profiler_scope_names[i], s.min, s.avg, s.p99, (unsigned)s.frames);
+	}
+
+	return CPYMO_ERR_SUCC;
+}
+
+#endif
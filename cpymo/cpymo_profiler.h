@@ -0,0 +1,112 @@
+#ifndef INCLUDE_CPYMO_PROFILER
+#define INCLUDE_CPYMO_PROFILER
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Per-frame timings of engine update and draw phases.
+// Everything here compiles to nothing unless ENABLE_PROFILER is defined.
+
+#ifdef ENABLE_PROFILER
+
+#include "cpymo_error.h"
+#include "cpymo_str.h"
+#include "../cpymo-backends/include/cpymo_backend_text.h"
+
+#ifndef CPYMO_PROFILER_FRAMES
+#define CPYMO_PROFILER_FRAMES 240
+#endif
+
+enum cpymo_profiler_scope {
+	cpymo_profiler_scope_input,
+	cpymo_profiler_scope_ui,
+	cpymo_profiler_scope_anime,
+	cpymo_profiler_scope_select_img,
+	cpymo_profiler_scope_wait,
+	cpymo_profiler_scope_interpreter,
+	cpymo_profiler_scope_command,
+
+	cpymo_profiler_scope_draw_ui,
+	cpymo_profiler_scope_draw_bg,
+	cpymo_profiler_scope_draw_scroll,
+	cpymo_profiler_scope_draw_charas,
+	cpymo_profiler_scope_draw_anime,
+	cpymo_profiler_scope_draw_select_img,
+	cpymo_profiler_scope_draw_fade,
+	cpymo_profiler_scope_draw_textbox,
+
+	cpymo_profiler_scope_count
+};
+
+typedef struct {
+	float min, avg, p99;
+	size_t frames;
+} cpymo_profiler_stats;
+
+typedef struct {
+	// Milliseconds of every scope in last CPYMO_PROFILER_FRAMES frames,
+	// negative if the scope did not run in that frame.
+	float frames[CPYMO_PROFILER_FRAMES][cpymo_profiler_scope_count];
+	size_t frame, frames_recorded, frames_total;
+
+	double begin[cpymo_profiler_scope_count];
+
+	// Slowest command dispatched in current frame.
+	char command[16], slowest_command[16];
+	float slowest_command_ms;
+	double command_begin;
+	bool command_running;
+
+	bool overlay, overlay_dirty;
+	float overlay_timer;
+	cpymo_backend_text overlay_lines[cpymo_profiler_scope_count + 1];
+} cpymo_profiler;
+
+error_t cpymo_profiler_create(cpymo_profiler **out);
+void cpymo_profiler_free(cpymo_profiler *p);
+
+// Commits timings of last frame and starts a new one.
+// Returns true if the overlay needs to be redrawn.
+bool cpymo_profiler_frame(cpymo_profiler *p, float delta_time);
+
+void cpymo_profiler_begin(cpymo_profiler *p, enum cpymo_profiler_scope scope);
+void cpymo_profiler_end(cpymo_profiler *p, enum cpymo_profiler_scope scope);
+
+// Ends timing of the previous command, if any, and starts the given one.
+// Dispatch continues into next command with longjmp, so only the last one is ended explicitly.
+void cpymo_profiler_command_begin(cpymo_profiler *p, cpymo_str command);
+void cpymo_profiler_command_end(cpymo_profiler *p);
+
+cpymo_profiler_stats cpymo_profiler_get_stats(
+	const cpymo_profiler *p, enum cpymo_profiler_scope scope);
+
+const char *cpymo_profiler_scope_name(enum cpymo_profiler_scope scope);
+
+void cpymo_profiler_toggle_overlay(cpymo_profiler *p);
+void cpymo_profiler_draw_overlay(cpymo_profiler *p, float screen_w, float screen_h);
+
+// Recorded frames as one row per frame, then a summary on stdout.
+error_t cpymo_profiler_dump_csv(const cpymo_profiler *p, const char *gamedir);
+
+#define CPYMO_PROFILER_BEGIN(PENGINE, SCOPE) \
+	cpymo_profiler_begin((PENGINE)->profiler, cpymo_profiler_scope_##SCOPE)
+
+#define CPYMO_PROFILER_END(PENGINE, SCOPE) \
+	cpymo_profiler_end((PENGINE)->profiler, cpymo_profiler_scope_##SCOPE)
+
+#define CPYMO_PROFILER_COMMAND_BEGIN(PENGINE, COMMAND) \
+	cpymo_profiler_command_begin((PENGINE)->profiler, COMMAND)
+
+#define CPYMO_PROFILER_COMMAND_END(PENGINE) \
+	cpymo_profiler_command_end((PENGINE)->profiler)
+
+#else
+
+#define CPYMO_PROFILER_BEGIN(PENGINE, SCOPE)
+#define CPYMO_PROFILER_END(PENGINE, SCOPE)
+#define CPYMO_PROFILER_COMMAND_BEGIN(PENGINE, COMMAND)
+#define CPYMO_PROFILER_COMMAND_END(PENGINE)
+
+#endif
+
+#endif
@@ -0,0 +1,290 @@
+﻿#include "cpymo_prelude.h"
+#include "cpymo_replay.h"
+#include "../endianness.h/endianness.h"
+#include <string.h>
+
+#define CPYMO_REPLAY_MAGIC "CPYMOREP"
+#define CPYMO_REPLAY_VERSION 2
+
+enum {
+	// First flag byte
+	cpymo_replay_mouse_position_useable = 1 << 0,
+	cpymo_replay_mouse_button = 1 << 1,
+	cpymo_replay_up = 1 << 2,
+	cpymo_replay_down = 1 << 3,
+	cpymo_replay_left = 1 << 4,
+	cpymo_replay_right = 1 << 5,
+	cpymo_replay_ok = 1 << 6,
+	cpymo_replay_cancel = 1 << 7,
+
+	// Second flag byte
+	cpymo_replay_skip = 1 << 0,
+	cpymo_replay_hide_window = 1 << 1,
+	cpymo_replay_has_delta_time = 1 << 2,
+	cpymo_replay_has_mouse_position = 1 << 3,
+	cpymo_replay_has_mouse_wheel = 1 << 4,
+	cpymo_replay_has_audio_states = 1 << 5,
+
+	// Config flags
+	cpymo_replay_config_skip_already_read_only = 1 << 0,
+};
+
+static bool cpymo_replay_write_u32(FILE *f, uint32_t x)
+{
+	x = end_htole32(x);
+	return fwrite(&x, sizeof(x), 1, f) == 1;
+}
+
+static bool cpymo_replay_read_u32(FILE *f, uint32_t *x)
+{
+	if (fread(x, sizeof(*x), 1, f) != 1) return false;
+	*x = end_le32toh(*x);
+	return true;
+}
+
+static bool cpymo_replay_write_float(FILE *f, float x)
+{
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return cpymo_replay_write_u32(f, bits);
+}
+
+static bool cpymo_replay_read_float(FILE *f, float *x)
+{
+	uint32_t bits;
+	if (!cpymo_replay_read_u32(f, &bits)) return false;
+	memcpy(x, &bits, sizeof(bits));
+	return true;
+}
+
+static void cpymo_replay_init(
+	cpymo_replay *r, FILE *file, enum cpymo_replay_mode mode,
+	uint32_t seed, const cpymo_replay_config *config)
+{
+	memset(r, 0, sizeof(*r));
+	r->file = file;
+	r->mode = mode;
+	r->seed = seed;
+	r->config = *config;
+	r->prev_delta_time = -1;
+}
+
+error_t cpymo_replay_open_record(
+	cpymo_replay *r, const char *path, uint32_t seed, const cpymo_replay_config *config)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+
+	uint32_t flags = 0;
+	if (config->skip_already_read_only) flags |= cpymo_replay_config_skip_already_read_only;
+
+	if (fwrite(CPYMO_REPLAY_MAGIC, 8, 1, file) != 1
+		|| !cpymo_replay_write_u32(file, CPYMO_REPLAY_VERSION)
+		|| !cpymo_replay_write_u32(file, seed)
+		|| !cpymo_replay_write_u32(file, config->fontsize)
+		|| !cpymo_replay_write_u32(file, config->textspeed)
+		|| !cpymo_replay_write_u32(file, flags)) {
+		fclose(file);
+		return CPYMO_ERR_UNKNOWN;
+	}
+
+	cpymo_replay_init(r, file, cpymo_replay_record, seed, config);
+	return CPYMO_ERR_SUCC;
+}
+
+error_t cpymo_replay_open_play(cpymo_replay *r, const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+
+	char magic[8];
+	uint32_t version, seed;
+	if (fread(magic, sizeof(magic), 1, file) != 1
+		|| memcmp(magic, CPYMO_REPLAY_MAGIC, sizeof(magic))
+		|| !cpymo_replay_read_u32(file, &version)) {
+		fclose(file);
+		return CPYMO_ERR_BAD_FILE_FORMAT;
+	}
+
+	if (version != CPYMO_REPLAY_VERSION) {
+		fclose(file);
+		return CPYMO_ERR_UNSUPPORTED;
+	}
+
+	uint32_t fontsize, textspeed, flags;
+	if (!cpymo_replay_read_u32(file, &seed)
+		|| !cpymo_replay_read_u32(file, &fontsize)
+		|| !cpymo_replay_read_u32(file, &textspeed)
+		|| !cpymo_replay_read_u32(file, &flags)) {
+		fclose(file);
+		return CPYMO_ERR_BAD_FILE_FORMAT;
+	}
+
+	cpymo_replay_config config;
+	config.fontsize = (uint16_t)fontsize;
+	config.textspeed = (uint16_t)textspeed;
+	config.skip_already_read_only = (flags & cpymo_replay_config_skip_already_read_only) != 0;
+
+	cpymo_replay_init(r, file, cpymo_replay_play, seed, &config);
+	return CPYMO_ERR_SUCC;
+}
+
+static void cpymo_replay_flush(cpymo_replay *r);
+
+void cpymo_replay_close(cpymo_replay *r)
+{
+	if (r->file && r->mode == cpymo_replay_record) cpymo_replay_flush(r);
+	if (r->file) fclose(r->file);
+	r->file = NULL;
+}
+
+static error_t cpymo_replay_record_frame(cpymo_replay *r, const cpymo_input *in, float delta_time)
+{
+	uint8_t flags[2] = { 0, 0 };
+	if (in->mouse_position_useable) flags[0] |= cpymo_replay_mouse_position_useable;
+	if (in->mouse_button) flags[0] |= cpymo_replay_mouse_button;
+	if (in->up) flags[0] |= cpymo_replay_up;
+	if (in->down) flags[0] |= cpymo_replay_down;
+	if (in->left) flags[0] |= cpymo_replay_left;
+	if (in->right) flags[0] |= cpymo_replay_right;
+	if (in->ok) flags[0] |= cpymo_replay_ok;
+	if (in->cancel) flags[0] |= cpymo_replay_cancel;
+	if (in->skip) flags[1] |= cpymo_replay_skip;
+	if (in->hide_window) flags[1] |= cpymo_replay_hide_window;
+
+	const bool has_delta_time = delta_time != r->prev_delta_time;
+	const bool has_mouse_position =
+		in->mouse_x != r->prev_input.mouse_x || in->mouse_y != r->prev_input.mouse_y;
+	const bool has_mouse_wheel = in->mouse_wheel_delta != 0;
+
+	if (has_delta_time) flags[1] |= cpymo_replay_has_delta_time;
+	if (has_mouse_position) flags[1] |= cpymo_replay_has_mouse_position;
+	if (has_mouse_wheel) flags[1] |= cpymo_replay_has_mouse_wheel;
+	if (r->audio_states) flags[1] |= cpymo_replay_has_audio_states;
+
+	bool ok = fwrite(flags, sizeof(flags), 1, r->file) == 1;
+	if (has_delta_time) ok = ok && cpymo_replay_write_float(r->file, delta_time);
+	if (has_mouse_position) {
+		ok = ok && cpymo_replay_write_float(r->file, in->mouse_x);
+		ok = ok && cpymo_replay_write_float(r->file, in->mouse_y);
+	}
+	if (has_mouse_wheel) ok = ok && cpymo_replay_write_float(r->file, in->mouse_wheel_delta);
+	if (r->audio_states) {
+		const uint8_t count = (uint8_t)r->audio_states;
+		ok = ok && fwrite(&count, sizeof(count), 1, r->file) == 1;
+		ok = ok && fwrite(r->audio_state_bits, (count + 7) / 8, 1, r->file) == 1;
+	}
+
+	return ok ? CPYMO_ERR_SUCC : CPYMO_ERR_UNKNOWN;
+}
+
+static void cpymo_replay_flush(cpymo_replay *r)
+{
+	if (!r->pending) return;
+	r->pending = false;
+
+	// A failed recording must not stop the game.
+	if (cpymo_replay_record_frame(r, &r->pending_input, r->pending_delta_time) != CPYMO_ERR_SUCC) {
+		printf("[Warning] Can not write replay, recording stopped.\n");
+		fclose(r->file);
+		r->file = NULL;
+		return;
+	}
+
+	r->prev_input = r->pending_input;
+	r->prev_delta_time = r->pending_delta_time;
+}
+
+static error_t cpymo_replay_play_frame(cpymo_replay *r, cpymo_input *out, float *delta_time)
+{
+	uint8_t flags[2];
+	if (fread(flags, sizeof(flags), 1, r->file) != 1)
+		return CPYMO_ERR_NO_MORE_CONTENT;
+
+	cpymo_input in;
+	memset(&in, 0, sizeof(in));
+	in.mouse_position_useable = (flags[0] & cpymo_replay_mouse_position_useable) != 0;
+	in.mouse_button = (flags[0] & cpymo_replay_mouse_button) != 0;
+	in.up = (flags[0] & cpymo_replay_up) != 0;
+	in.down = (flags[0] & cpymo_replay_down) != 0;
+	in.left = (flags[0] & cpymo_replay_left) != 0;
+	in.right = (flags[0] & cpymo_replay_right) != 0;
+	in.ok = (flags[0] & cpymo_replay_ok) != 0;
+	in.cancel = (flags[0] & cpymo_replay_cancel) != 0;
+	in.skip = (flags[1] & cpymo_replay_skip) != 0;
+	in.hide_window = (flags[1] & cpymo_replay_hide_window) != 0;
+	in.mouse_x = r->prev_input.mouse_x;
+	in.mouse_y = r->prev_input.mouse_y;
+
+	float dt = r->prev_delta_time;
+	bool ok = true;
+	if (flags[1] & cpymo_replay_has_delta_time) ok = ok && cpymo_replay_read_float(r->file, &dt);
+	if (flags[1] & cpymo_replay_has_mouse_position) {
+		ok = ok && cpymo_replay_read_float(r->file, &in.mouse_x);
+		ok = ok && cpymo_replay_read_float(r->file, &in.mouse_y);
+	}
+	if (flags[1] & cpymo_replay_has_mouse_wheel)
+		ok = ok && cpymo_replay_read_float(r->file, &in.mouse_wheel_delta);
+
+	r->audio_states = 0;
+	r->audio_states_read = 0;
+	if (ok && (flags[1] & cpymo_replay_has_audio_states)) {
+		uint8_t count;
+		ok = fread(&count, sizeof(count), 1, r->file) == 1
+			&& count > 0
+			&& fread(r->audio_state_bits, (count + 7) / 8, 1, r->file) == 1;
+		if (ok) r->audio_states = count;
+	}
+
+	if (!ok || dt < 0) return CPYMO_ERR_BAD_FILE_FORMAT;
+
+	*out = in;
+	*delta_time = dt;
+	return CPYMO_ERR_SUCC;
+}
+
+error_t cpymo_replay_frame(cpymo_replay *r, cpymo_input *input, float *delta_time)
+{
+	if (r->file == NULL)
+		return r->mode == cpymo_replay_play ? CPYMO_ERR_NO_MORE_CONTENT : CPYMO_ERR_SUCC;
+
+	if (r->mode == cpymo_replay_record) {
+		cpymo_replay_flush(r);
+		if (r->file == NULL) return CPYMO_ERR_SUCC;
+
+		r->pending = true;
+		r->pending_input = *input;
+		r->pending_delta_time = *delta_time;
+		r->audio_states = 0;
+	}
+	else {
+		error_t err = cpymo_replay_play_frame(r, input, delta_time);
+		CPYMO_THROW(err);
+
+		r->prev_input = *input;
+		r->prev_delta_time = *delta_time;
+	}
+
+	r->frames++;
+	return CPYMO_ERR_SUCC;
+}
+
+bool cpymo_replay_audio_state(cpymo_replay *r, bool live)
+{
+	if (r->mode == cpymo_replay_record) {
+		if (r->pending && r->audio_states < CPYMO_REPLAY_MAX_AUDIO_STATES) {
+			const size_t i = r->audio_states++;
+			const uint8_t bit = (uint8_t)(1 << (i % 8));
+			if (live) r->audio_state_bits[i / 8] |= bit;
+			else r->audio_state_bits[i / 8] &= (uint8_t)~bit;
+		}
+
+		return live;
+	}
+
+	// Past the recorded answers the replay has diverged anyway.
+	if (r->audio_states_read >= r->audio_states) return live;
+
+	const size_t i = r->audio_states_read++;
+	return (r->audio_state_bits[i / 8] & (1 << (i % 8))) != 0;
+}
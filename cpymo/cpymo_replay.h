@@ -0,0 +1,74 @@
+#ifndef INCLUDE_CPYMO_REPLAY
+#define INCLUDE_CPYMO_REPLAY
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpymo_error.h"
+#include "../cpymo-backends/include/cpymo_backend_input.h"
+
+// Input snapshot and delta time of every frame in a compact binary file.
+// A replay feeds them back to the engine instead of live input and wall clock,
+// seeds #rand and applies the settings of the recording,
+// so the same game with the same save data runs through the same frames.
+//
+// Audio can not be replayed: it may be disabled, missing or decoded at
+// another pace. Everything script flow asks about audio (wait_se, auto mode)
+// goes through cpymo_replay_audio_state, which records the answers
+// and returns the recorded ones on replay.
+//
+// File: "CPYMOREP", u32 version, u32 seed, u32 fontsize, u32 textspeed,
+// u32 config flags, then one record per frame.
+// A record is two flag bytes, followed by delta time, mouse position
+// and mouse wheel, each only when it changed since the previous frame,
+// then the audio answers of the frame: a count byte and one bit per answer.
+// Everything is little endian, floats are stored by their bits.
+
+enum cpymo_replay_mode {
+	cpymo_replay_record,
+	cpymo_replay_play,
+};
+
+#define CPYMO_REPLAY_MAX_AUDIO_STATES 255
+
+// Settings of the engine which change how a game runs.
+typedef struct {
+	uint16_t fontsize, textspeed;
+	bool skip_already_read_only;
+} cpymo_replay_config;
+
+typedef struct {
+	FILE *file;
+	enum cpymo_replay_mode mode;
+	uint32_t seed;
+	cpymo_replay_config config;
+	size_t frames;
+
+	cpymo_input prev_input;
+	float prev_delta_time;
+
+	// Recording writes a frame on the next one,
+	// after the audio answers of its update are known.
+	bool pending;
+	cpymo_input pending_input;
+	float pending_delta_time;
+
+	size_t audio_states, audio_states_read;
+	uint8_t audio_state_bits[(CPYMO_REPLAY_MAX_AUDIO_STATES + 7) / 8];
+} cpymo_replay;
+
+error_t cpymo_replay_open_record(
+	cpymo_replay *r, const char *path, uint32_t seed, const cpymo_replay_config *config);
+
+// Seed and config of the recording are in r->seed and r->config.
+error_t cpymo_replay_open_play(cpymo_replay *r, const char *path);
+void cpymo_replay_close(cpymo_replay *r);
+
+// Records input and delta time, or replaces them with the recorded ones.
+// Returns CPYMO_ERR_NO_MORE_CONTENT when a replay has no more frames.
+error_t cpymo_replay_frame(cpymo_replay *r, cpymo_input *input, float *delta_time);
+
+// Records the live answer, or returns the recorded one.
+bool cpymo_replay_audio_state(cpymo_replay *r, bool live);
+
+#endif
@@ -113,15 +113,15 @@ error_t cpymo_save_write(cpymo_engine * e, unsigned short save_id)
 
 	// CHARA
 	{
-		struct cpymo_chara *chara = e->charas.chara;
-		while (chara) {
+		for (size_t i = 0; i < e->charas.count; ++i) {
+			const struct cpymo_chara *chara = &e->charas.chara[i];
 			if (chara->alive) {
 				WRITE_STR(chara->chara_name);
 
 				int32_t cid = (int32_t)chara->chara_id;
 				int32_t layer = (int32_t)chara->layer;
-				int32_t x = (int32_t)(chara->pos_x.end_value / e->gameconfig.imagesize_w * (1 << 16));
-				int32_t y = (int32_t)(chara->pos_y.end_value / e->gameconfig.imagesize_h * (1 << 16));
+				int32_t x = (int32_t)(e->charas.pos_x[i].end_value / e->gameconfig.imagesize_w * (1 << 16));
+				int32_t y = (int32_t)(e->charas.pos_y[i].end_value / e->gameconfig.imagesize_h * (1 << 16));
 
 				uint32_t chara_params[] = {
 					PACK32(cid),
@@ -135,7 +135,6 @@ error_t cpymo_save_write(cpymo_engine * e, unsigned short save_id)
 					return CPYMO_ERR_UNKNOWN;
 				}
 			}
-			chara = chara->next;
 		}
 
 		WRITE_STR(empty);
@@ -440,10 +439,8 @@ error_t cpymo_save_load_savedata(cpymo_engine *e, FILE *save)
 		int32_t x = CAST(int32_t, chara_params[2]);
 		int32_t y = CAST(int32_t, chara_params[3]);
 
-		struct cpymo_chara *c = NULL;
 		cpymo_charas_new_chara(
 			e,
-			&c,
 			cpymo_str_pure(strbuf),
 			cid,
 			layer,
@@ -76,6 +76,21 @@ void cpymo_say_free(cpymo_say *say)
 	if (say->current_text) free(say->current_text);
 }
 
+size_t cpymo_say_memory_usage(const cpymo_say *say)
+{
+	size_t size = 0;
+	if (say->msgbox) size += (size_t)say->msgbox_w * say->msgbox_h * 4;
+	if (say->namebox) size += (size_t)say->namebox_w * say->namebox_h * 4;
+	if (say->msg_cursor) size += (size_t)say->msg_cursor_w * say->msg_cursor_h * 4;
+	if (say->textbox_usable) size += cpymo_textbox_memory_usage(&say->textbox);
+	return size;
+}
+
+size_t cpymo_say_glyph_memory_usage(const cpymo_say *say)
+{
+	return say->textbox_usable ? cpymo_textbox_glyph_memory_usage(&say->textbox) : 0;
+}
+
 void cpymo_say_draw(const struct cpymo_engine *e)
 {
 	if (e->say.active && !e->input.hide_window && !e->say.hide_window) {
@@ -284,11 +299,17 @@ bool cpymo_say_wait_process_auto_mode(cpymo_engine *e, float dt, bool prev_wait_
 
 	if (e->say.auto_mode_timer < 0) e->say.auto_mode_timer = auto_mode_time;
 	
-	if (!cpymo_audio_channel_is_playing(CPYMO_AUDIO_CHANNEL_VO, &e->audio) &&
+	const bool audio_done = cpymo_engine_audio_state(e,
+		!cpymo_audio_channel_is_playing(CPYMO_AUDIO_CHANNEL_VO, &e->audio) &&
 		(!cpymo_audio_channel_is_playing(CPYMO_AUDIO_CHANNEL_SE, &e->audio) || 
-			cpymo_audio_channel_is_looping(CPYMO_AUDIO_CHANNEL_SE, &e->audio)) &&
-		!e->input.hide_window && !e->input.hide_window)
+			cpymo_audio_channel_is_looping(CPYMO_AUDIO_CHANNEL_SE, &e->audio)));
+
+	if (audio_done && !e->input.hide_window && !e->input.hide_window) {
 		e->say.auto_mode_timer -= dt;
+		cpymo_wait_set_deadline(&e->wait, e->say.auto_mode_timer);
+	}
+	// voice and SE end without notice, check them a few times a second.
+	else cpymo_wait_set_deadline(&e->wait, 0.1f);
 
 	return e->say.auto_mode_timer < 0;
 }
@@ -321,6 +342,7 @@ static bool cpymo_say_wait_text_reading(cpymo_engine *e, float dt)
 				e->say.hide_window = false;
 				cpymo_engine_request_redraw(e);
 			}
+			cpymo_wait_set_deadline(&e->wait, CPYMO_WAIT_NO_DEADLINE);
 			return false;
 		}
 	}
@@ -369,6 +391,7 @@ static bool cpymo_say_wait_text_fadein(cpymo_engine *e, float dt)
 			e->say.hide_window = false;
 			cpymo_engine_request_redraw(e);
 		}
+		cpymo_wait_set_deadline(&e->wait, CPYMO_WAIT_NO_DEADLINE);
 		return false;
 	}
 
@@ -404,6 +427,7 @@ static error_t cpymo_say_wait_text_read_callback(cpymo_engine *e)
 static error_t cpymo_say_autosave_and_next(cpymo_engine *e)
 {
 	cpymo_save_autosave(e);
+	cpymo_interpreter_prepare_next_vo(e->interpreter, e);
 	cpymo_wait_register_with_callback(
 		&e->wait,
 		&cpymo_say_wait_text_reading,
@@ -37,6 +37,10 @@ typedef struct {
 void cpymo_say_init(cpymo_say *);
 void cpymo_say_free(cpymo_say *);
 
+// Message box images and textbox, glyphs are counted apart.
+size_t cpymo_say_memory_usage(const cpymo_say *);
+size_t cpymo_say_glyph_memory_usage(const cpymo_say *);
+
 void cpymo_say_draw(const struct cpymo_engine *);
 
 error_t cpymo_say_load_msgbox_and_namebox_image(
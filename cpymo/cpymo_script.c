@@ -1,5 +1,6 @@
 #include "cpymo_prelude.h"
 #include "cpymo_script.h"
+#include "cpymo_trace.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -14,6 +15,7 @@ error_t cpymo_script_load(
 
     cpymo_str_copy(script->script_name, script_name.len + 1, script_name);
 
+    CPYMO_TRACE_BEGIN(trace);
     script->script_content = NULL;
     error_t err = cpymo_assetloader_load_script(
         &script->script_content, 
@@ -26,6 +28,8 @@ error_t cpymo_script_load(
         return err;
     }
 
+    CPYMO_TRACE_END(trace, "script", "load", script_name, script->script_content_len);
+
     *out = script;
     return CPYMO_ERR_SUCC;
 }
@@ -181,7 +181,10 @@ static bool cpymo_select_img_wait(struct cpymo_engine *e, float dt)
 			e->select_img.hint_tiktok = !e->select_img.hint_tiktok;
 			cpymo_engine_request_redraw(e);
 		}
+
+		cpymo_wait_set_deadline(&e->wait, 1.0f - e->select_img.hint_timer);
 	}
+	else cpymo_wait_set_deadline(&e->wait, CPYMO_WAIT_NO_DEADLINE);
 
 	enum cpymo_key_hold_result mouse_button_state =
 		cpymo_key_hold_update(e, &e->select_img.key_mouse_button, dt, e->input.mouse_button);
@@ -302,6 +305,9 @@ void cpymo_select_img_configuare_end(cpymo_select_img *sel, cpymo_wait *wait, st
 	cpymo_engine_request_redraw(e);
 }
 
+static inline bool cpymo_select_img_choosable(const cpymo_select_img_selection *s)
+{ return s->enabled && (s->image || s->or_text); }
+
 static void cpymo_select_img_move(cpymo_select_img *o, int move) {
 	assert(move == 1 || move == -1);
 	
@@ -313,6 +319,25 @@ static void cpymo_select_img_move(cpymo_select_img *o, int move) {
 		cpymo_select_img_move(o, move);
 }
 
+int cpymo_select_img_nth_choosable(const cpymo_select_img *o, size_t nth)
+{
+	assert(o->selections);
+
+	size_t choosable = 0;
+	for (size_t i = 0; i < o->all_selections; ++i)
+		if (cpymo_select_img_choosable(o->selections + i)) choosable++;
+
+	if (choosable == 0) return o->current_selection;
+
+	nth %= choosable;
+	for (size_t i = 0; i < o->all_selections; ++i) {
+		if (!cpymo_select_img_choosable(o->selections + i)) continue;
+		if (nth-- == 0) return (int)i;
+	}
+
+	return o->current_selection;
+}
+
 static error_t cpymo_select_img_ok(cpymo_engine *e, int sel, uint64_t hash, cpymo_select_img *o)
 {
 	bool save_enabled = o->save_enabled;
@@ -559,7 +584,8 @@ void cpymo_select_img_configuare_select_text_hint_pic(cpymo_engine * engine, cpy
 	engine->select_img.hint_timer = 0;
 	engine->select_img.hint_tiktok = false;
 
-	char *hint_pic_name = (char *)malloc(hint.len + 2);
+	const cpymo_arena_mark mark = cpymo_arena_get_mark(&engine->arena);
+	char *hint_pic_name = (char *)cpymo_arena_alloc(&engine->arena, hint.len + 2);
 	if (hint_pic_name == NULL) return;
 
 	bool is_all_succ = true;
@@ -583,7 +609,7 @@ void cpymo_select_img_configuare_select_text_hint_pic(cpymo_engine * engine, cpy
 		}
 	}
 
-	free(hint_pic_name);
+	cpymo_arena_release(&engine->arena, mark);
 
 	if (is_all_succ) return;
 	else {
@@ -81,6 +81,10 @@ void cpymo_select_img_configuare_end(
 	struct cpymo_engine *engine, int init_position);
 
 error_t cpymo_select_img_update(struct cpymo_engine *engine, cpymo_select_img *o, float dt);
+
+// Index of the nth selection which can be chosen, wrapping around,
+// for scripted playthroughs to move the cursor to.
+int cpymo_select_img_nth_choosable(const cpymo_select_img *o, size_t nth);
 void cpymo_select_img_draw(const cpymo_select_img *, int logical_screen_w, int logical_screen_h, bool gray_selected);
 
 static inline void cpymo_select_img_init(cpymo_select_img *select_img)
@@ -139,3 +139,18 @@ void cpymo_text_clear(cpymo_text *t)
 	t->ls = NULL;
 }
 
+size_t cpymo_text_memory_usage(const cpymo_text *t)
+{
+	size_t size = 0;
+	for (const struct cpymo_textbox_list *ls = t->ls; ls; ls = ls->next)
+		size += sizeof(*ls) - sizeof(ls->box) + cpymo_textbox_memory_usage(&ls->box);
+	return size;
+}
+
+size_t cpymo_text_glyph_memory_usage(const cpymo_text *t)
+{
+	size_t size = 0;
+	for (const struct cpymo_textbox_list *ls = t->ls; ls; ls = ls->next)
+		size += cpymo_textbox_glyph_memory_usage(&ls->box);
+	return size;
+}
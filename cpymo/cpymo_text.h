@@ -26,4 +26,7 @@ error_t cpymo_text_new(
 
 void cpymo_text_clear(cpymo_text *);
 
+size_t cpymo_text_memory_usage(const cpymo_text *);
+size_t cpymo_text_glyph_memory_usage(const cpymo_text *);
+
 #endif
@@ -9,7 +9,6 @@
 #endif
 
 typedef struct cpymo_textbox_line {
-    size_t begin_pool_index, pool_slice_size;
     float y;
 } cpymo_textbox_line;
 
@@ -25,8 +24,8 @@ error_t cpymo_textbox_init(
     o->max_lines = (size_t)(height / character_size);
     if (o->max_lines < 1) o->max_lines = 1;
 
-    o->chars_pool_max_size = text.len;
-    o->chars_pool_size = 0;
+    o->chars_max_count = text.len;
+    o->chars_count = 0;
 
     o->backlog_buf_size = 0;
     o->backlog_buf_max_size = 0;
@@ -38,24 +37,25 @@ error_t cpymo_textbox_init(
         if (o->backlog_buf == NULL) return CPYMO_ERR_OUT_OF_MEM;
     }
 
-    uint8_t *mem = (uint8_t *)malloc(
-        o->max_lines * sizeof(cpymo_textbox_line) +
-        o->chars_pool_max_size * (sizeof(cpymo_backend_text) + sizeof(float)));
-    if (mem == NULL) {
+    o->lines = (cpymo_textbox_line *)malloc(
+        o->max_lines * sizeof(cpymo_textbox_line));
+    if (o->lines == NULL) {
         if (o->backlog_buf) free(o->backlog_buf);
         return CPYMO_ERR_OUT_OF_MEM;
     }
 
-    o->chars_pool = (cpymo_backend_text *)mem;
-    o->chars_x_pool = (float *)
-        (mem + o->chars_pool_max_size * sizeof(cpymo_backend_text));
-
-    o->lines = (cpymo_textbox_line *)
-        (mem + o->chars_pool_max_size * (sizeof(cpymo_backend_text) + sizeof(float)));
-
     if (width < character_size * 1.5f)
         width = character_size * 1.5f;
 
+    error_t err = cpymo_backend_text_run_create(
+        &o->chars, o->chars_max_count, 
+        x, y, width, height, character_size);
+    if (err != CPYMO_ERR_SUCC) {
+        free(o->lines);
+        if (o->backlog_buf) free(o->backlog_buf);
+        return err;
+    }
+
     o->active_line = 0;
     o->x = x;
     o->y = y;
@@ -67,9 +67,6 @@ error_t cpymo_textbox_init(
     o->col = col;
     o->remain_text = text;
     o->backlog = backlog;
-
-    o->lines[0].begin_pool_index = 0;
-    o->lines[0].pool_slice_size = 0;
     
     for (size_t i = 0; i < o->max_lines; ++i) {
         o->lines[i].y = o->y + o->char_size * (i + 1);
@@ -85,30 +82,39 @@ error_t cpymo_textbox_init(
     return CPYMO_ERR_SUCC;
 }
 
-static void cpymo_textbox_clear_chars_pool_and_lines(cpymo_textbox *tb)
+static void cpymo_textbox_clear_chars_and_lines(cpymo_textbox *tb)
 {
-    for (size_t i = 0; i < tb->chars_pool_size; ++i)
-        if (tb->chars_pool[i])
-            cpymo_backend_text_free(tb->chars_pool[i]);
-    tb->chars_pool_size = 0;
+    if (tb->chars) cpymo_backend_text_run_clear(tb->chars);
+    tb->chars_count = 0;
 
     tb->active_line = 0;
-    if (tb->lines) {
-        tb->lines[0].begin_pool_index = 0;
-        tb->lines[0].pool_slice_size = 0;
-    }
     tb->typing_x = tb->x;
 }
 
 void cpymo_textbox_free(cpymo_textbox *tb, cpymo_backlog *write_to_backlog)
 {
-    cpymo_textbox_clear_chars_pool_and_lines(tb);
-    if (tb->chars_pool) free((void *)tb->chars_pool);
+    cpymo_textbox_clear_chars_and_lines(tb);
+    if (tb->chars) cpymo_backend_text_run_free(tb->chars);
+    if (tb->lines) free(tb->lines);
     if (tb->backlog_buf) free(tb->backlog_buf);
     tb->backlog_buf = NULL;
     tb->lines = NULL;
-    tb->chars_pool = NULL;
-    tb->chars_x_pool = NULL;
+    tb->chars = NULL;
+}
+
+size_t cpymo_textbox_memory_usage(const cpymo_textbox *tb)
+{
+    size_t size = sizeof(*tb);
+    if (tb->lines) size += tb->max_lines * sizeof(cpymo_textbox_line);
+    if (tb->backlog_buf) size += tb->backlog_buf_max_size;
+    return size;
+}
+
+size_t cpymo_textbox_glyph_memory_usage(const cpymo_textbox *tb)
+{
+    if (tb->chars == NULL) return 0;
+    const size_t char_size = (size_t)(tb->char_size + 0.5f);
+    return tb->chars_count * char_size * char_size;
 }
 
 void cpymo_textbox_draw(
@@ -116,7 +122,7 @@ void cpymo_textbox_draw(
     const cpymo_textbox *tb, 
     enum cpymo_backend_image_draw_type drawtype)
 {
-    if (tb->lines == NULL || tb->chars_pool == NULL || tb->chars_x_pool == NULL) 
+    if (tb->lines == NULL || tb->chars == NULL) 
         return;
 
     if (tb->draw_cursor && e->say.msg_cursor && !e->say.auto_mode) {
@@ -146,33 +152,20 @@ void cpymo_textbox_draw(
             1.0f, drawtype);
     }
 
-    for (size_t line_id = 0; line_id <= tb->active_line; ++line_id) {
-        const cpymo_textbox_line *line = tb->lines + line_id;
-        for (size_t char_id = 0; char_id < line->pool_slice_size; ++char_id) {
-            size_t char_index = char_id + line->begin_pool_index;
-            assert(char_index < tb->chars_pool_size);
-            float x_pos = tb->chars_x_pool[char_index];
-            cpymo_backend_text ch = tb->chars_pool[char_index];
-            cpymo_backend_text_draw(
-                ch, x_pos, line->y, tb->col, tb->alpha, drawtype);
-        }
-    }
+    cpymo_backend_text_run_draw(
+        tb->chars, tb->chars_count, tb->col, tb->alpha, drawtype);
 }
 
 error_t cpymo_textbox_clear_page(cpymo_textbox *tb, cpymo_backlog *write_to_backlog)
 {
-    cpymo_textbox_clear_chars_pool_and_lines(tb);
+    cpymo_textbox_clear_chars_and_lines(tb);
     return CPYMO_ERR_SUCC;
 }
 
 static bool cpymo_textbox_nextline(cpymo_textbox *tb)
 {
     if (tb->active_line >= tb->max_lines - 1) return false;
-    const cpymo_textbox_line *last_line = tb->lines + tb->active_line;
     tb->active_line++;
-    tb->lines[tb->active_line].begin_pool_index = 
-        last_line->begin_pool_index + last_line->pool_slice_size;
-    tb->lines[tb->active_line].pool_slice_size = 0;
     tb->typing_x = tb->x;
 
     if (tb->backlog_buf) {
@@ -211,8 +204,7 @@ static char *cpymo_textbox_get_backlog_text(cpymo_textbox *tb)
 static error_t cpymo_textbox_add_char(cpymo_textbox *tb)
 {
     assert(tb->lines);
-    assert(tb->chars_pool);
-    assert(tb->chars_x_pool);
+    assert(tb->chars);
     if (tb->remain_text.len == 0) goto TEXT_FADEIN_FINISHED;
 
     #define EAT_NEWLINE(NEW_LINE_HEADER) \
@@ -253,14 +245,12 @@ static error_t cpymo_textbox_add_char(cpymo_textbox *tb)
             tb->backlog_buf_size = tb->backlog_buf_max_size;
     }
 
-    assert(tb->chars_pool_size < tb->chars_pool_max_size);
-    error_t err = cpymo_backend_text_create(
-        tb->chars_pool + tb->chars_pool_size, &ch_w, ch, tb->char_size);
+    assert(tb->chars_count < tb->chars_max_count);
+    error_t err = cpymo_backend_text_run_append(
+        tb->chars, &ch_w, ch, tb->typing_x, tb->lines[tb->active_line].y);
     CPYMO_THROW(err);
 
-    tb->chars_x_pool[tb->chars_pool_size] = tb->typing_x;
-    tb->chars_pool_size++;
-    tb->lines[tb->active_line].pool_slice_size++;
+    tb->chars_count++;
     tb->typing_x += ch_w;
     tb->remain_text = remain_text;
     return CPYMO_ERR_SUCC;
@@ -318,6 +308,8 @@ bool cpymo_textbox_wait_text_fadein(cpymo_engine *e, float dt, cpymo_textbox *wh
         cpymo_engine_request_redraw(e);
     }
 
+    cpymo_wait_set_deadline(&e->wait, speed - which_textbox->timer);
+
     if (cpymo_input_foward_key_just_released(e)) {
         cpymo_engine_request_redraw(e);
         cpymo_say_stop_auto_mode(e);
@@ -353,7 +345,11 @@ bool cpymo_textbox_wait_text_reading(cpymo_engine *e, float dt, cpymo_textbox *t
             tb->draw_cursor = !tb->draw_cursor;
             cpymo_engine_request_redraw(e);
         }
+
+        cpymo_wait_set_deadline(&e->wait, 0.5f - tb->timer);
     }
+#else
+    if (!e->say.auto_mode) cpymo_wait_set_deadline(&e->wait, CPYMO_WAIT_NO_DEADLINE);
 #endif
 
     if (go) {
@@ -9,9 +9,8 @@ struct cpymo_engine;
 struct cpymo_textbox_line;
 
 typedef struct {
-	size_t chars_pool_max_size, chars_pool_size, max_lines;
-	cpymo_backend_text *chars_pool;
-	float *chars_x_pool;
+	size_t chars_max_count, chars_count, max_lines;
+	cpymo_backend_text_run chars;
 	struct cpymo_textbox_line *lines;
 	size_t active_line;
 	float x, y, w, h, char_size, alpha, typing_x;
@@ -40,6 +39,11 @@ error_t cpymo_textbox_init(
 void cpymo_textbox_free(
 	cpymo_textbox *, cpymo_backlog *write_to_backlog);
 
+size_t cpymo_textbox_memory_usage(const cpymo_textbox *);
+
+// Glyphs are cached by backends, estimated as a byte per pixel of every shown character.
+size_t cpymo_textbox_glyph_memory_usage(const cpymo_textbox *);
+
 void cpymo_textbox_draw(
 	const struct cpymo_engine *,
 	const cpymo_textbox *, 
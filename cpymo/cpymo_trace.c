@@ -0,0 +1,104 @@
+#include "cpymo_prelude.h"
+#include "cpymo_trace.h"
+
+#ifdef ENABLE_TRACE
+
+#include <stdio.h>
+#include "cpymo_atomic.h"
+#include "../cpymo-backends/include/cpymo_backend_save.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Every event is one fprintf, which stdio does not interleave between threads.
+// Engines running side by side share one trace, opened by the first of them
+// and closed by the last.
+static FILE * volatile cpymo_trace_file = NULL;
+static double cpymo_trace_start;
+static volatile long cpymo_trace_engines = 0;
+
+static volatile long cpymo_trace_threads = 0;
+static CPYMO_THREAD_LOCAL long cpymo_trace_tid = 0;
+
+double cpymo_trace_now(void)
+{
+	#ifdef _WIN32
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)freq.QuadPart;
+	#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+	#endif
+}
+
+error_t cpymo_trace_open(const char *gamedir)
+{
+	if (cpymo_atomic_long_increment(&cpymo_trace_engines) != 1)
+		return CPYMO_ERR_SUCC;
+
+	FILE *file = cpymo_backend_write_save(gamedir, "trace.json");
+	if (file == NULL) return CPYMO_ERR_CAN_NOT_OPEN_FILE;
+
+	fputs("[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+		"\"args\":{\"name\":\"cpymo\"}}", file);
+
+	cpymo_trace_start = cpymo_trace_now();
+	cpymo_trace_file = file;
+	return CPYMO_ERR_SUCC;
+}
+
+void cpymo_trace_close(void)
+{
+	if (cpymo_atomic_long_decrement(&cpymo_trace_engines) != 0) return;
+
+	FILE *file = cpymo_trace_file;
+	if (file == NULL) return;
+
+	cpymo_trace_file = NULL;
+	fputs("\n]\n", file);
+	fclose(file);
+}
+
+static void cpymo_trace_escape(char *dst, size_t size, cpymo_str s)
+{
+	size_t j = 0;
+	for (size_t i = 0; i < s.len && j + 2 < size; ++i) {
+		char ch = s.begin[i];
+		if (ch == '\"' || ch == '\\') dst[j++] = '\\';
+		else if ((unsigned char)ch < 0x20) ch = ' ';
+		dst[j++] = ch;
+	}
+
+	dst[j] = '\0';
+}
+
+void cpymo_trace_event(
+	const char *category, const char *name,
+	double begin, cpymo_str detail, size_t bytes)
+{
+	FILE *file = cpymo_trace_file;
+	if (file == NULL) return;
+
+	const double end = cpymo_trace_now();
+
+	if (cpymo_trace_tid == 0)
+		cpymo_trace_tid = cpymo_atomic_long_increment(&cpymo_trace_threads);
+
+	char detail_escaped[256];
+	cpymo_trace_escape(detail_escaped, sizeof(detail_escaped), detail);
+
+	fprintf(file,
+		",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+		"\"pid\":1,\"tid\":%ld,\"args\":{\"detail\":\"%s\",\"bytes\":%lu}}",
+		name, category,
+		(begin - cpymo_trace_start) * 1e6, (end - begin) * 1e6,
+		cpymo_trace_tid, detail_escaped, (unsigned long)bytes);
+}
+
+#endif
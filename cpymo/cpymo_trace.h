@@ -0,0 +1,42 @@
+#ifndef INCLUDE_CPYMO_TRACE
+#define INCLUDE_CPYMO_TRACE
+
+#include <stddef.h>
+
+// Asset I/O events in Chrome trace_event JSON,
+// open trace.json from save directory in chrome://tracing or ui.perfetto.dev.
+// Everything here compiles to nothing unless ENABLE_TRACE is defined.
+
+#ifdef ENABLE_TRACE
+
+#include "cpymo_error.h"
+#include "cpymo_str.h"
+
+// Starts trace.json in save directory of gamedir.
+// Every open is paired with a close, only the first open creates the file
+// and only the last close finishes it.
+error_t cpymo_trace_open(const char *gamedir);
+void cpymo_trace_close(void);
+
+double cpymo_trace_now(void);
+
+// Records a complete event from begin to now on current thread.
+// Any thread may call it, events are dropped while no trace is open.
+void cpymo_trace_event(
+	const char *category, const char *name,
+	double begin, cpymo_str detail, size_t bytes);
+
+#define CPYMO_TRACE_BEGIN(VAR) \
+	const double VAR = cpymo_trace_now()
+
+#define CPYMO_TRACE_END(VAR, CATEGORY, NAME, DETAIL, BYTES) \
+	cpymo_trace_event(CATEGORY, NAME, VAR, DETAIL, BYTES)
+
+#else
+
+#define CPYMO_TRACE_BEGIN(VAR)
+#define CPYMO_TRACE_END(VAR, CATEGORY, NAME, DETAIL, BYTES)
+
+#endif
+
+#endif
@@ -9,6 +9,7 @@ typedef struct cpymo_ui {
 	cpymo_ui_drawer draw;
 	cpymo_ui_deleter deleter;
 	struct cpymo_ui *prev_ui;
+	size_t size;
 } cpymo_ui;
 
 error_t cpymo_ui_enter(void ** out_uidata, cpymo_engine *e, size_t ui_data_size, cpymo_ui_updater u, cpymo_ui_drawer d, cpymo_ui_deleter deleter)
@@ -20,6 +21,7 @@ error_t cpymo_ui_enter(void ** out_uidata, cpymo_engine *e, size_t ui_data_size,
 	ui->draw = d;
 	ui->deleter = deleter;
 	ui->prev_ui = e->ui;
+	ui->size = sizeof(cpymo_ui) + ui_data_size;
 
 	assert(*out_uidata == NULL);
 	*out_uidata = ui + 1;
@@ -44,6 +46,14 @@ void cpymo_ui_exit(cpymo_engine *e)
 	cpymo_engine_request_redraw(e);
 }
 
+size_t cpymo_ui_memory_usage(const cpymo_engine *e)
+{
+	size_t size = 0;
+	for (const cpymo_ui *ui = e->ui; ui; ui = ui->prev_ui)
+		size += ui->size;
+	return size;
+}
+
 void *cpymo_ui_data(cpymo_engine *e)
 {
 	return e->ui + 1;
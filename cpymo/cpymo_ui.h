@@ -33,6 +33,9 @@ void cpymo_ui_draw(const struct cpymo_engine *);
 
 bool cpymo_ui_enabled(const struct cpymo_engine *);
 
+// UI data of every UI entered, not what they load by themselves.
+size_t cpymo_ui_memory_usage(const struct cpymo_engine *);
+
 void cpymo_ui_empty_drawer(const struct cpymo_engine *e, const void *ui_data);
 void cpymo_ui_empty_deleter(struct cpymo_engine *e, void *ui_data);
 
@@ -10,7 +10,7 @@ struct cpymo_var {
     cpymo_val value;
 };
 
-void cpymo_vars_init(cpymo_vars *out)
+void cpymo_vars_init(cpymo_vars *out, cpymo_arena *arena)
 {
     struct cpymo_var *p = NULL;
     sh_new_arena(p);
@@ -21,6 +21,7 @@ void cpymo_vars_init(cpymo_vars *out)
     out->globals = (void *)p;
 
     out->globals_dirty = false;
+    out->arena = arena;
 }
 
 void cpymo_vars_free(cpymo_vars *to_free)
@@ -52,11 +53,13 @@ static cpymo_val *cpymo_vars_access_cstr(
 
 const cpymo_val *cpymo_vars_access(cpymo_vars *vars, cpymo_str name)
 {
-    char *cstr = cpymo_str_copy_malloc(name);
+    // Scripts may loop many times before a frame ends.
+    const cpymo_arena_mark mark = cpymo_arena_get_mark(vars->arena);
+    char *cstr = cpymo_arena_str(vars->arena, name);
     if (cstr == NULL) return NULL;
 
     cpymo_val *r = cpymo_vars_access_cstr(vars, cstr);
-    free(cstr);
+    cpymo_arena_release(vars->arena, mark);
     return r;
 }
 
@@ -90,11 +93,12 @@ static error_t cpymo_vars_set_cstr(
 
 error_t cpymo_vars_set(cpymo_vars *vars, cpymo_str name, cpymo_val v)
 {
-    char *name_cstr = cpymo_str_copy_malloc(name);
+    const cpymo_arena_mark mark = cpymo_arena_get_mark(vars->arena);
+    char *name_cstr = cpymo_arena_str(vars->arena, name);
     if (name_cstr == NULL) return CPYMO_ERR_OUT_OF_MEM;
 
     error_t err = cpymo_vars_set_cstr(vars, name_cstr, v);
-    free(name_cstr);
+    cpymo_arena_release(vars->arena, mark);
 
     return err;
 }
@@ -108,7 +112,8 @@ cpymo_val cpymo_vars_get(cpymo_vars *vars, cpymo_str name)
 error_t cpymo_vars_add(cpymo_vars *vars, cpymo_str name, cpymo_val v)
 {
     error_t err = CPYMO_ERR_SUCC;
-    char *name_cstr = cpymo_str_copy_malloc(name);
+    const cpymo_arena_mark mark = cpymo_arena_get_mark(vars->arena);
+    char *name_cstr = cpymo_arena_str(vars->arena, name);
     if (name_cstr == NULL) return CPYMO_ERR_OUT_OF_MEM;
 
     cpymo_val *p = cpymo_vars_access_cstr(vars, name_cstr);
@@ -119,7 +124,7 @@ error_t cpymo_vars_add(cpymo_vars *vars, cpymo_str name, cpymo_val v)
     if (cpymo_vars_is_global(name_cstr))
         vars->globals_dirty = true;
 
-    free(name_cstr);
+    cpymo_arena_release(vars->arena, mark);
 
     return err;
 }
@@ -3,15 +3,19 @@
 
 #include "cpymo_error.h"
 #include "cpymo_parser.h"
+#include "cpymo_arena.h"
 
 typedef int32_t cpymo_val;
 
 typedef struct {
 	void *locals, *globals;
 	bool globals_dirty;
+
+	// Names are copied here to look them up.
+	cpymo_arena *arena;
 } cpymo_vars;
 
-void cpymo_vars_init(cpymo_vars *out);
+void cpymo_vars_init(cpymo_vars *out, cpymo_arena *arena);
 void cpymo_vars_free(cpymo_vars *to_free);
 
 const cpymo_val *cpymo_vars_access(cpymo_vars * vars, cpymo_str name);
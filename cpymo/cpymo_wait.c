@@ -10,12 +10,14 @@ void cpymo_wait_register_with_callback(cpymo_wait * wait, cpymo_wait_for wait_fo
 
 	wait->wating_for = wait_for;
 	wait->callback = cb;
+	wait->deadline = -1;
 }
 
 error_t cpymo_wait_update(cpymo_wait *wait, cpymo_engine * engine, float delta_time)
 {
 	error_t err = CPYMO_ERR_SUCC;
 	if (cpymo_wait_is_wating(wait)) {
+		wait->deadline = -1;
 		if (wait->wating_for(engine, delta_time)) {
 			cpymo_wait_over_callback cb = wait->callback;
 			cpymo_wait_reset(wait);
@@ -33,6 +35,7 @@ static bool cpymo_wait_second_waiter(struct cpymo_engine *e, float delta_time)
 		e->wait.wait_for_seconds = -1;
 
 	e->wait.wait_for_seconds -= delta_time;
+	cpymo_wait_set_deadline(&e->wait, e->wait.wait_for_seconds);
 	return e->wait.wait_for_seconds <= 0;
 }
 
@@ -10,17 +10,32 @@ struct cpymo_engine;
 typedef bool (*cpymo_wait_for)(struct cpymo_engine *, float);	// wait until it's returns true.
 typedef error_t (*cpymo_wait_over_callback)(struct cpymo_engine *);	// You can register next wait operation in callback.
 
+// Deadline of a wait that only input can finish.
+#define CPYMO_WAIT_NO_DEADLINE 1e9f
+
 typedef struct {
 	cpymo_wait_for wating_for;
 	cpymo_wait_over_callback callback;
 
 	float wait_for_seconds;
+
+	// Seconds until wating_for needs to run again without input,
+	// negative if it did not tell, then it runs every frame.
+	float deadline;
 } cpymo_wait;
 
 static inline void cpymo_wait_reset(cpymo_wait *wait)
 {
 	wait->callback = NULL;
 	wait->wating_for = NULL;
+	wait->deadline = -1;
+}
+
+// Called by wating_for, the earliest deadline wins.
+static inline void cpymo_wait_set_deadline(cpymo_wait *wait, float seconds)
+{
+	if (seconds < 0) seconds = 0;
+	if (wait->deadline < 0 || seconds < wait->deadline) wait->deadline = seconds;
 }
 
 static inline bool cpymo_wait_is_wating(cpymo_wait *wait)